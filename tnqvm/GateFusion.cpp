@@ -0,0 +1,279 @@
+/***********************************************************************************
+ * Copyright (c) 2020, UT-Battelle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the xacc nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ **********************************************************************************/
+#include "GateFusion.hpp"
+#include "FusedUnitary.hpp"
+#include "InstructionTape.hpp"
+#include <algorithm>
+#include <cassert>
+#include <complex>
+#include <vector>
+
+namespace tnqvm {
+namespace {
+// Matrices are row-major, the first qubit being the most significant bit, i.e.
+// the same convention as the gate matrices in Gates.hpp.
+using Matrix = std::vector<std::complex<double>>;
+
+// A gate of the input sequence.
+struct GateOp {
+  std::vector<size_t> qubits;
+  // Gate matrix (2x2 or 4x4). Empty for operations that can't be fused (e.g.
+  // measurement or unknown gates): these act as barriers on their qubits.
+  Matrix matrix;
+};
+
+// An operation of the fused sequence.
+struct FusedOp {
+  std::vector<size_t> qubits;
+  // Fused matrix; empty for a barrier (which is a single source operation).
+  Matrix matrix;
+  // Indices of the source operations, in an order in which they can be
+  // replayed (equivalent to the fused matrix).
+  std::vector<size_t> sourceIndices;
+};
+
+Matrix identity(size_t in_dim) {
+  Matrix result(in_dim * in_dim, 0.0);
+  for (size_t i = 0; i < in_dim; ++i) {
+    result[i * in_dim + i] = 1.0;
+  }
+  return result;
+}
+
+// A * B (square matrices)
+Matrix multiply(const Matrix &in_a, const Matrix &in_b) {
+  assert(in_a.size() == in_b.size());
+  const size_t dim = (in_a.size() == 4) ? 2 : 4;
+  assert(in_a.size() == dim * dim);
+  Matrix result(dim * dim, 0.0);
+  for (size_t i = 0; i < dim; ++i) {
+    for (size_t k = 0; k < dim; ++k) {
+      const auto aik = in_a[i * dim + k];
+      for (size_t j = 0; j < dim; ++j) {
+        result[i * dim + j] += aik * in_b[k * dim + j];
+      }
+    }
+  }
+  return result;
+}
+
+// Kronecker product of two 2x2 matrices: A acts on the first (MSB) qubit.
+Matrix kron(const Matrix &in_a, const Matrix &in_b) {
+  assert(in_a.size() == 4 && in_b.size() == 4);
+  Matrix result(16);
+  for (size_t i = 0; i < 2; ++i) {
+    for (size_t j = 0; j < 2; ++j) {
+      for (size_t k = 0; k < 2; ++k) {
+        for (size_t l = 0; l < 2; ++l) {
+          result[(2 * i + j) * 4 + (2 * k + l)] =
+              in_a[i * 2 + k] * in_b[j * 2 + l];
+        }
+      }
+    }
+  }
+  return result;
+}
+
+// Two-qubit matrix with the order of its qubits swapped, i.e. SWAP * M * SWAP.
+Matrix swapQubitOrder(const Matrix &in_matrix) {
+  assert(in_matrix.size() == 16);
+  static const size_t PERM[4] = {0, 2, 1, 3};
+  Matrix result(16);
+  for (size_t r = 0; r < 4; ++r) {
+    for (size_t c = 0; c < 4; ++c) {
+      result[PERM[r] * 4 + PERM[c]] = in_matrix[r * 4 + c];
+    }
+  }
+  return result;
+}
+
+// Fuse the gate sequence:
+//  - consecutive single-qubit gates on a qubit are multiplied together;
+//  - single-qubit gates are absorbed into a neighboring (preceding or
+//  following) two-qubit gate on that qubit;
+//  - consecutive two-qubit gates on the same pair of qubits are multiplied
+//  together.
+// Operations of the result are in a valid execution order.
+std::vector<FusedOp> fuseGateOps(const std::vector<GateOp> &in_ops) {
+  constexpr int NONE = -1;
+  std::vector<FusedOp> result;
+  size_t nbQubits = 0;
+  for (const auto &op : in_ops) {
+    for (const auto &qubit : op.qubits) {
+      nbQubits = std::max(nbQubits, qubit + 1);
+    }
+  }
+  // Pending (not yet emitted) single-qubit product on each qubit.
+  std::vector<FusedOp> pending(nbQubits);
+  // Last emitted operation (index into the result) acting on each qubit.
+  std::vector<int> lastOp(nbQubits, NONE);
+
+  const auto isTwoQubitBlock = [&](int in_opIdx) {
+    return in_opIdx != NONE && result[in_opIdx].qubits.size() == 2 &&
+           !result[in_opIdx].matrix.empty();
+  };
+
+  // Emit the pending single-qubit product on a qubit: absorb it into the
+  // two-qubit block which is the last operation on that qubit if any.
+  const auto flush = [&](size_t in_qubit) {
+    auto &op = pending[in_qubit];
+    if (op.sourceIndices.empty()) {
+      return;
+    }
+    const int lastIdx = lastOp[in_qubit];
+    if (isTwoQubitBlock(lastIdx)) {
+      auto &block = result[lastIdx];
+      const auto gate = (block.qubits[0] == in_qubit)
+                            ? kron(op.matrix, identity(2))
+                            : kron(identity(2), op.matrix);
+      block.matrix = multiply(gate, block.matrix);
+      block.sourceIndices.insert(block.sourceIndices.end(),
+                                 op.sourceIndices.begin(),
+                                 op.sourceIndices.end());
+    } else {
+      op.qubits = {in_qubit};
+      lastOp[in_qubit] = result.size();
+      result.emplace_back(std::move(op));
+    }
+    op = FusedOp();
+  };
+
+  for (size_t opIdx = 0; opIdx < in_ops.size(); ++opIdx) {
+    const auto &op = in_ops[opIdx];
+    const bool isFusable =
+        !op.matrix.empty() && (op.qubits.size() == 1 || op.qubits.size() == 2);
+    if (!isFusable) {
+      for (const auto &qubit : op.qubits) {
+        flush(qubit);
+      }
+      FusedOp barrier;
+      barrier.qubits = op.qubits;
+      barrier.sourceIndices = {opIdx};
+      for (const auto &qubit : op.qubits) {
+        lastOp[qubit] = result.size();
+      }
+      result.emplace_back(std::move(barrier));
+      continue;
+    }
+
+    if (op.qubits.size() == 1) {
+      auto &product = pending[op.qubits[0]];
+      product.matrix = product.sourceIndices.empty()
+                           ? op.matrix
+                           : multiply(op.matrix, product.matrix);
+      product.sourceIndices.emplace_back(opIdx);
+      continue;
+    }
+
+    const size_t q0 = op.qubits[0];
+    const size_t q1 = op.qubits[1];
+    assert(q0 != q1);
+    // Absorb the pending single-qubit gates on both qubits.
+    std::vector<size_t> sources;
+    Matrix matrix = op.matrix;
+    if (!pending[q0].sourceIndices.empty() ||
+        !pending[q1].sourceIndices.empty()) {
+      const auto m0 = pending[q0].sourceIndices.empty() ? identity(2)
+                                                        : pending[q0].matrix;
+      const auto m1 = pending[q1].sourceIndices.empty() ? identity(2)
+                                                        : pending[q1].matrix;
+      matrix = multiply(matrix, kron(m0, m1));
+      for (const auto &qubit : {q0, q1}) {
+        sources.insert(sources.end(), pending[qubit].sourceIndices.begin(),
+                       pending[qubit].sourceIndices.end());
+        pending[qubit] = FusedOp();
+      }
+    }
+    sources.emplace_back(opIdx);
+
+    const int lastIdx = lastOp[q0];
+    if (lastIdx == lastOp[q1] && isTwoQubitBlock(lastIdx)) {
+      // Same pair as the previous two-qubit block, with nothing in between.
+      auto &block = result[lastIdx];
+      const auto blockMatrix = (block.qubits[0] == q0)
+                                   ? block.matrix
+                                   : swapQubitOrder(block.matrix);
+      block.matrix = multiply(matrix, blockMatrix);
+      block.qubits = op.qubits;
+      block.sourceIndices.insert(block.sourceIndices.end(), sources.begin(),
+                                 sources.end());
+      continue;
+    }
+
+    FusedOp block;
+    block.qubits = op.qubits;
+    block.matrix = std::move(matrix);
+    block.sourceIndices = std::move(sources);
+    lastOp[q0] = lastOp[q1] = result.size();
+    result.emplace_back(std::move(block));
+  }
+
+  for (size_t qubit = 0; qubit < nbQubits; ++qubit) {
+    flush(qubit);
+  }
+  return result;
+}
+} // namespace
+
+std::shared_ptr<xacc::CompositeInstruction>
+fuseGates(std::shared_ptr<xacc::CompositeInstruction> in_kernel) {
+  std::vector<std::shared_ptr<xacc::Instruction>> instructions;
+  std::vector<GateOp> ops;
+  xacc::InstructionIterator it(in_kernel);
+  while (it.hasNext()) {
+    auto nextInst = it.next();
+    if (!nextInst->isEnabled() || nextInst->isComposite()) {
+      continue;
+    }
+    GateOp op;
+    op.qubits = nextInst->bits();
+    // Only one- and two-qubit unitaries with known matrices can be fused.
+    if (op.qubits.size() <= 2) {
+      op.matrix = getFlatGateMatrix(*nextInst);
+    }
+    instructions.emplace_back(nextInst);
+    ops.emplace_back(std::move(op));
+  }
+
+  auto result = xacc::getIRProvider("quantum")->createComposite(
+      in_kernel->name(), in_kernel->getVariables());
+  for (auto &fusedOp : fuseGateOps(ops)) {
+    if (fusedOp.sourceIndices.size() == 1) {
+      result->addInstruction(instructions[fusedOp.sourceIndices[0]]->clone());
+      continue;
+    }
+    std::vector<std::shared_ptr<xacc::Instruction>> sourceGates;
+    for (const auto &idx : fusedOp.sourceIndices) {
+      sourceGates.emplace_back(instructions[idx]->clone());
+    }
+    result->addInstruction(std::make_shared<FusedUnitary>(
+        fusedOp.qubits, std::move(fusedOp.matrix), std::move(sourceGates)));
+  }
+  return result;
+}
+} // namespace tnqvm
@@ -0,0 +1,190 @@
+/***********************************************************************************
+ * Copyright (c) 2020, UT-Battelle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the xacc nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ **********************************************************************************/
+#include "ObservableGrouping.hpp"
+#include <algorithm>
+#include <cassert>
+#include <map>
+#include <numeric>
+
+namespace {
+// Change of basis of an observed sub-circuit:
+// qubit index -> ordered list of single-qubit gates on that qubit.
+using BasisChangeMap =
+    std::map<size_t, std::vector<std::shared_ptr<xacc::Instruction>>>;
+
+// Returns false if this is not a single-qubit change of basis.
+bool getBasisChange(std::shared_ptr<xacc::CompositeInstruction> in_function,
+                    BasisChangeMap &out_basisChange) {
+  xacc::InstructionIterator it(in_function);
+  while (it.hasNext()) {
+    auto nextInst = it.next();
+    if (!nextInst->isEnabled() || nextInst->isComposite()) {
+      continue;
+    }
+    if (nextInst->bits().size() != 1) {
+      return false;
+    }
+    // Measured qubits without any basis-change gates are in the Z basis,
+    // i.e. an empty gate list.
+    auto &qubitGates = out_basisChange[nextInst->bits()[0]];
+    if (nextInst->name() != "Measure") {
+      qubitGates.emplace_back(nextInst);
+    }
+  }
+  return true;
+}
+
+// Key to compare the change of basis on a single qubit.
+std::string
+getQubitBasisKey(const std::vector<std::shared_ptr<xacc::Instruction>> &in_gates) {
+  std::string key;
+  for (const auto &gate : in_gates) {
+    key.append(gate->name());
+    for (const auto &param : gate->getParameters()) {
+      key.append("_" + param.toString());
+    }
+    key.append(";");
+  }
+  return key;
+}
+} // namespace
+
+namespace tnqvm {
+std::vector<std::vector<size_t>> computeQwcGroups(
+    const std::vector<std::shared_ptr<xacc::CompositeInstruction>>
+        &in_observedCircuits) {
+  struct QwcGroup {
+    // Qubit -> basis key of the group
+    std::map<size_t, std::string> qubitBases;
+    std::vector<size_t> members;
+  };
+
+  std::vector<std::map<size_t, std::string>> circuitBases(
+      in_observedCircuits.size());
+  std::vector<bool> isGroupable(in_observedCircuits.size(), true);
+  for (size_t i = 0; i < in_observedCircuits.size(); ++i) {
+    BasisChangeMap basisChange;
+    isGroupable[i] = getBasisChange(in_observedCircuits[i], basisChange);
+    for (const auto &[qubitIdx, gates] : basisChange) {
+      circuitBases[i].emplace(qubitIdx, getQubitBasisKey(gates));
+    }
+  }
+
+  // Greedy (largest first) assignment: terms acting on more qubits are the
+  // most constraining, assign them first.
+  std::vector<size_t> order(in_observedCircuits.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) {
+    return circuitBases[lhs].size() > circuitBases[rhs].size();
+  });
+
+  std::vector<QwcGroup> groups;
+  for (const auto &circuitIdx : order) {
+    if (!isGroupable[circuitIdx]) {
+      QwcGroup singleton;
+      singleton.members.emplace_back(circuitIdx);
+      groups.emplace_back(std::move(singleton));
+      continue;
+    }
+    const auto &bases = circuitBases[circuitIdx];
+    const auto isCompatible = [&bases](const QwcGroup &in_group) {
+      for (const auto &[qubitIdx, basisKey] : bases) {
+        const auto iter = in_group.qubitBases.find(qubitIdx);
+        if (iter != in_group.qubitBases.end() && iter->second != basisKey) {
+          return false;
+        }
+      }
+      return true;
+    };
+
+    auto groupIter = std::find_if(groups.begin(), groups.end(),
+                                  [&](const QwcGroup &in_group) {
+                                    // Don't merge into a singleton group.
+                                    return !in_group.qubitBases.empty() &&
+                                           isCompatible(in_group);
+                                  });
+    if (groupIter == groups.end() || bases.empty()) {
+      groups.emplace_back();
+      groupIter = std::prev(groups.end());
+    }
+    groupIter->qubitBases.insert(bases.begin(), bases.end());
+    groupIter->members.emplace_back(circuitIdx);
+  }
+
+  std::vector<std::vector<size_t>> result;
+  result.reserve(groups.size());
+  for (auto &group : groups) {
+    std::sort(group.members.begin(), group.members.end());
+    result.emplace_back(std::move(group.members));
+  }
+  return result;
+}
+
+std::vector<std::shared_ptr<xacc::CompositeInstruction>> applyQwcGroups(
+    const std::vector<std::shared_ptr<xacc::CompositeInstruction>>
+        &in_observedCircuits,
+    const std::vector<std::vector<size_t>> &in_groups) {
+  auto gateRegistry = xacc::getIRProvider("quantum");
+  std::vector<std::shared_ptr<xacc::CompositeInstruction>> result(
+      in_observedCircuits);
+  for (const auto &group : in_groups) {
+    if (group.size() < 2) {
+      continue;
+    }
+    // Merged change of basis of the group:
+    BasisChangeMap groupBasisChange;
+    for (const auto &circuitIdx : group) {
+      BasisChangeMap basisChange;
+      const bool isGroupable =
+          getBasisChange(in_observedCircuits[circuitIdx], basisChange);
+      assert(isGroupable);
+      // By construction, the change of basis on common qubits is the same.
+      groupBasisChange.insert(basisChange.begin(), basisChange.end());
+    }
+
+    for (const auto &circuitIdx : group) {
+      const auto &observedCircuit = in_observedCircuits[circuitIdx];
+      auto rewritten = gateRegistry->createComposite(observedCircuit->name());
+      for (const auto &[qubitIdx, gates] : groupBasisChange) {
+        for (const auto &gate : gates) {
+          rewritten->addInstruction(gate->clone());
+        }
+      }
+      xacc::InstructionIterator it(observedCircuit);
+      while (it.hasNext()) {
+        auto nextInst = it.next();
+        if (nextInst->isEnabled() && nextInst->name() == "Measure") {
+          rewritten->addInstruction(nextInst->clone());
+        }
+      }
+      result[circuitIdx] = rewritten;
+    }
+  }
+  return result;
+}
+} // namespace tnqvm
@@ -0,0 +1,54 @@
+/***********************************************************************************
+ * Copyright (c) 2020, UT-Battelle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the xacc nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ **********************************************************************************/
+#pragma once
+
+#include "xacc.hpp"
+
+namespace tnqvm {
+// Qubit-wise commuting (QWC) grouping of VQE observed sub-circuits.
+// Each observed sub-circuit is a change of basis (single-qubit gates, e.g. H
+// for X, Rx(pi/2) for Y) followed by Z measurements. Two sub-circuits are
+// qubit-wise commuting if they apply the same change of basis on every qubit
+// they both act on, hence they can be read off the same measurement
+// distribution.
+//
+// Returns the list of groups (indices into the input list).
+// Sub-circuits whose change of basis is not made of single-qubit gates are
+// placed in their own (singleton) group.
+std::vector<std::vector<size_t>> computeQwcGroups(
+    const std::vector<std::shared_ptr<xacc::CompositeInstruction>>
+        &in_observedCircuits);
+
+// Rewrite the observed sub-circuits so that all members of a QWC group use the
+// same (merged) change of basis followed by their own measurements.
+// The returned list is in the same order as the input (same kernel names).
+std::vector<std::shared_ptr<xacc::CompositeInstruction>> applyQwcGroups(
+    const std::vector<std::shared_ptr<xacc::CompositeInstruction>>
+        &in_observedCircuits,
+    const std::vector<std::vector<size_t>> &in_groups);
+} // namespace tnqvm
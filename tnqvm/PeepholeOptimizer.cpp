@@ -0,0 +1,235 @@
+/***********************************************************************************
+ * Copyright (c) 2020, UT-Battelle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the xacc nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ **********************************************************************************/
+#include "PeepholeOptimizer.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace tnqvm {
+namespace {
+struct GateInfo {
+  std::string name;
+  std::vector<size_t> qubits;
+  // Numerical parameters (rotation angles)
+  std::vector<double> params;
+  // False if some parameters are symbolic (not bound).
+  bool isBound = true;
+  // Index of the gate in the input sequence
+  size_t sourceIdx = 0;
+};
+
+bool isSelfInverse(const std::string &in_name) {
+  static const std::vector<std::string> GATES{"H",  "X",    "Y",  "Z", "CNOT",
+                                              "CZ", "Swap", "CY", "CH"};
+  return std::find(GATES.begin(), GATES.end(), in_name) != GATES.end();
+}
+
+// Two-qubit gates which are invariant under swapping their qubits.
+bool isSymmetric(const std::string &in_name) {
+  return in_name == "CZ" || in_name == "Swap" || in_name == "CPhase";
+}
+
+// Diagonal gates in the computational basis.
+bool isDiagonal(const std::string &in_name) {
+  static const std::vector<std::string> GATES{
+      "I", "Z", "S", "Sdg", "T", "Tdg", "Rz", "CZ", "CPhase", "CRZ"};
+  return std::find(GATES.begin(), GATES.end(), in_name) != GATES.end();
+}
+
+// Period of the rotation angle of a rotation gate (the rotation with this
+// angle is the identity, including the global phase); 0.0 if not a rotation.
+double getRotationPeriod(const std::string &in_name) {
+  if (in_name == "Rx" || in_name == "Ry" || in_name == "Rz" ||
+      in_name == "CRZ") {
+    return 4.0 * M_PI;
+  }
+  if (in_name == "CPhase") {
+    return 2.0 * M_PI;
+  }
+  return 0.0;
+}
+
+bool isInversePair(const std::string &in_first,
+                          const std::string &in_second) {
+  return (in_first == "S" && in_second == "Sdg") ||
+         (in_first == "Sdg" && in_second == "S") ||
+         (in_first == "T" && in_second == "Tdg") ||
+         (in_first == "Tdg" && in_second == "T");
+}
+
+// Simplify the gate sequence:
+//  - cancel adjacent inverse pairs (e.g. H.H, CNOT.CNOT, Swap.Swap, S.Sdg),
+//  cascading (e.g. H.X.X.H);
+//  - merge adjacent rotations of the same kind (dropped if the merged angle
+//  is a multiple of the period);
+//  - drop diagonal gates (e.g. Rz, CZ, CPhase) whose qubits are only measured
+//  afterward (in the computational basis).
+// Returns the remaining gates in order (with merged parameters).
+std::vector<GateInfo> simplify(const std::vector<GateInfo> &in_gates) {
+  constexpr double TOLERANCE = 1e-12;
+  size_t nbQubits = 0;
+  for (const auto &gate : in_gates) {
+    for (const auto &qubit : gate.qubits) {
+      nbQubits = std::max(nbQubits, qubit + 1);
+    }
+  }
+
+  std::vector<GateInfo> ops;
+  std::vector<bool> isRemoved;
+  // Stack of the (remaining) operations on each qubit.
+  std::vector<std::vector<size_t>> qubitStacks(nbQubits);
+  const auto removeOp = [&](size_t in_opIdx) {
+    isRemoved[in_opIdx] = true;
+    for (const auto &qubit : ops[in_opIdx].qubits) {
+      assert(qubitStacks[qubit].back() == in_opIdx);
+      qubitStacks[qubit].pop_back();
+    }
+  };
+
+  for (const auto &gate : in_gates) {
+    const bool isMatchable =
+        !gate.qubits.empty() && gate.isBound && gate.name != "Measure";
+    if (isMatchable && !qubitStacks[gate.qubits[0]].empty()) {
+      const size_t prevIdx = qubitStacks[gate.qubits[0]].back();
+      auto &prev = ops[prevIdx];
+      // The previous operation must act on the same set of qubits, with no
+      // operation in between on any of them.
+      const bool isAdjacent =
+          prev.isBound && prev.qubits.size() == gate.qubits.size() &&
+          std::all_of(gate.qubits.begin(), gate.qubits.end(),
+                      [&](size_t in_qubit) {
+                        return !qubitStacks[in_qubit].empty() &&
+                               qubitStacks[in_qubit].back() == prevIdx;
+                      });
+      const bool isSameOrder =
+          isAdjacent && (prev.qubits == gate.qubits || isSymmetric(gate.name));
+      if (isSameOrder) {
+        if ((prev.name == gate.name && isSelfInverse(gate.name)) ||
+            isInversePair(prev.name, gate.name)) {
+          removeOp(prevIdx);
+          continue;
+        }
+        const double period = getRotationPeriod(gate.name);
+        if (prev.name == gate.name && period > 0.0) {
+          prev.params[0] += gate.params[0];
+          if (std::abs(std::remainder(prev.params[0], period)) < TOLERANCE) {
+            removeOp(prevIdx);
+          }
+          continue;
+        }
+      }
+    }
+
+    for (const auto &qubit : gate.qubits) {
+      qubitStacks[qubit].emplace_back(ops.size());
+    }
+    ops.emplace_back(gate);
+    isRemoved.emplace_back(false);
+  }
+
+  // Backward scan: is the qubit only measured from this point on?
+  std::vector<bool> isOnlyMeasured(nbQubits, false);
+  std::vector<bool> hasOtherOps(nbQubits, false);
+  for (size_t i = ops.size(); i-- > 0;) {
+    if (isRemoved[i]) {
+      continue;
+    }
+    const auto &op = ops[i];
+    if (op.name == "Measure" && op.qubits.size() == 1) {
+      isOnlyMeasured[op.qubits[0]] = !hasOtherOps[op.qubits[0]];
+      continue;
+    }
+    const bool isDroppable =
+        isDiagonal(op.name) &&
+        std::all_of(op.qubits.begin(), op.qubits.end(),
+                    [&](size_t in_qubit) { return isOnlyMeasured[in_qubit]; });
+    if (isDroppable) {
+      isRemoved[i] = true;
+      continue;
+    }
+    for (const auto &qubit : op.qubits) {
+      hasOtherOps[qubit] = true;
+      isOnlyMeasured[qubit] = false;
+    }
+  }
+
+  std::vector<GateInfo> result;
+  for (size_t i = 0; i < ops.size(); ++i) {
+    if (!isRemoved[i]) {
+      result.emplace_back(std::move(ops[i]));
+    }
+  }
+  return result;
+}
+} // namespace
+
+std::shared_ptr<xacc::CompositeInstruction>
+simplifyCircuit(std::shared_ptr<xacc::CompositeInstruction> in_kernel) {
+  std::vector<std::shared_ptr<xacc::Instruction>> instructions;
+  std::vector<GateInfo> gates;
+  xacc::InstructionIterator it(in_kernel);
+  while (it.hasNext()) {
+    auto nextInst = it.next();
+    if (!nextInst->isEnabled() || nextInst->isComposite()) {
+      continue;
+    }
+    GateInfo gate;
+    gate.name = nextInst->name();
+    gate.qubits = nextInst->bits();
+    gate.sourceIdx = instructions.size();
+    for (const auto &param : nextInst->getParameters()) {
+      if (param.which() == 0) {
+        gate.params.emplace_back(param.as<int>());
+      } else if (param.which() == 1) {
+        gate.params.emplace_back(param.as<double>());
+      } else {
+        // Symbolic parameter
+        gate.isBound = false;
+      }
+    }
+    instructions.emplace_back(nextInst);
+    gates.emplace_back(std::move(gate));
+  }
+
+  auto result = xacc::getIRProvider("quantum")->createComposite(
+      in_kernel->name(), in_kernel->getVariables());
+  for (const auto &gate : simplify(gates)) {
+    auto inst = instructions[gate.sourceIdx]->clone();
+    // Merged rotation angles
+    for (size_t i = 0; i < gate.params.size(); ++i) {
+      if (gate.params[i] != gates[gate.sourceIdx].params[i]) {
+        inst->setParameter(i, gate.params[i]);
+      }
+    }
+    result->addInstruction(inst);
+  }
+  return result;
+}
+} // namespace tnqvm
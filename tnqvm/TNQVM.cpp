@@ -30,6 +30,19 @@
  **********************************************************************************/
 #include "TNQVM.hpp"
 #include "IRUtils.hpp"
+#include "NoiseModel.hpp"
+#include "GateFusion.hpp"
+#include "PeepholeOptimizer.hpp"
+#include "ObservableGrouping.hpp"
+#include "utils/CircuitAnalysis.hpp"
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <map>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <unistd.h>
 
 namespace {
 inline int getShotCountOption(const xacc::HeterogeneousMap &in_options) {
@@ -39,6 +52,78 @@ inline int getShotCountOption(const xacc::HeterogeneousMap &in_options) {
   }
   return result;
 }
+
+// Serializes executions using visitors which are not thread-safe (e.g. sharing
+// the process-wide ExaTN runtime) across all TNQVM instances.
+std::mutex &getVisitorExecutionMutex() {
+  static std::mutex visitorExecutionMutex;
+  return visitorExecutionMutex;
+}
+
+// Number of (enabled) gates in the flattened kernel.
+inline int getGateCount(std::shared_ptr<xacc::CompositeInstruction> in_kernel) {
+  int count = 0;
+  xacc::InstructionIterator it(in_kernel);
+  while (it.hasNext()) {
+    auto nextInst = it.next();
+    if (nextInst->isEnabled() && !nextInst->isComposite()) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+// Light-cone pruning of a kernel whose measurements are terminal: gates outside
+// the backward light cone of the measured qubits don't change the measurement
+// statistics. Returns a new kernel (measurements last), or null if nothing can
+// be pruned (no measurement, mid-circuit measurement or conditional).
+std::shared_ptr<xacc::CompositeInstruction>
+pruneToMeasuredLightCone(std::shared_ptr<xacc::CompositeInstruction> in_kernel) {
+  std::vector<std::shared_ptr<xacc::Instruction>> gates;
+  std::vector<std::vector<size_t>> gateQubits;
+  std::vector<std::shared_ptr<xacc::Instruction>> measures;
+  std::vector<size_t> measuredQubits;
+  xacc::InstructionIterator it(in_kernel);
+  while (it.hasNext()) {
+    auto nextInst = it.next();
+    if (nextInst->name() == "ifstmt") {
+      return nullptr;
+    }
+    if (!nextInst->isEnabled() || nextInst->isComposite()) {
+      continue;
+    }
+    const auto bits = nextInst->bits();
+    if (nextInst->name() == "Measure") {
+      measures.emplace_back(nextInst);
+      measuredQubits.emplace_back(bits[0]);
+      continue;
+    }
+    for (const auto &bit : bits) {
+      if (std::find(measuredQubits.begin(), measuredQubits.end(), bit) !=
+          measuredQubits.end()) {
+        return nullptr;
+      }
+    }
+    gates.emplace_back(nextInst);
+    gateQubits.emplace_back(bits);
+  }
+  if (measures.empty()) {
+    return nullptr;
+  }
+  const auto cone = tnqvm::lightcone::computeLightCone(gateQubits, measuredQubits);
+  if (cone.size() == gates.size()) {
+    return nullptr;
+  }
+  auto result = xacc::getIRProvider("quantum")->createComposite(
+      in_kernel->name(), in_kernel->getVariables());
+  for (const auto &idx : cone) {
+    result->addInstruction(gates[idx]->clone());
+  }
+  for (const auto &measure : measures) {
+    result->addInstruction(measure->clone());
+  }
+  return result;
+}
 } // namespace
 namespace tnqvm {
 
@@ -47,88 +132,991 @@ const std::string TNQVM::DEFAULT_VISITOR_BACKEND = "itensor-mps";
 void TNQVM::execute(
     std::shared_ptr<AcceleratorBuffer> buffer,
     const std::vector<std::shared_ptr<xacc::CompositeInstruction>> functions) {
-  visitor = xacc::getService<TNQVMVisitor>(getVisitorName())->clone();
+  std::unique_lock<std::mutex> lock(executionMutex, std::try_to_lock);
+  if (!lock.owns_lock()) {
+    // Another execution is in progress on this instance.
+    executeInContext([&](TNQVM &in_context) {
+      in_context.execute(buffer, functions);
+    });
+    return;
+  }
+  executionInfo.clear();
+  executionConfig = getConfiguration();
+  if (executionConfig.autoVisitor) {
+    executionConfig.backendName = selectVisitorBackend(functions);
+  }
+  auto visitorLock = lockVisitorExecution();
+  setVisitor(getVisitor(true));
   // If in VQE mode and there are more than one kernels
-  if (vqeMode && functions.size() > 1 && visitor->supportVqeMode()) {
+  if (executionConfig.vqeMode && functions.size() > 1 &&
+      visitor->supportVqeMode()) {
     auto kernelDecomposed = ObservedAnsatz::fromObservedComposites(functions);
     // Always validate kernel decomposition in DEBUG
     assert(kernelDecomposed.validate(functions));
-    visitor->setOptions(options);
+    visitor->setOptions(executionConfig.options);
 
-    // Initialize the visitor
-    visitor->initialize(buffer, getShotCountOption(options));
-    visitor->setKernelName(kernelDecomposed.getBase()->name());
-    // Walk the base IR tree, and visit each node
-    InstructionIterator it(kernelDecomposed.getBase());
-    while (it.hasNext()) {
-      auto nextInst = it.next();
-      if (nextInst->isEnabled() && !nextInst->isComposite()) {
-        nextInst->accept(visitor);
-      }
+    // Observable sub-circuits (change of basis + measurements)
+    auto obsCircuits = kernelDecomposed.getObservedSubCircuits();
+    // Partition the terms into qubit-wise commuting groups: all members of a
+    // group are rewritten to use the same (merged) change of basis, hence only
+    // one basis-change circuit is simulated per group.
+    auto evalCircuits = obsCircuits;
+    if (executionConfig.qwcGrouping) {
+      const auto qwcGroups = computeQwcGroups(obsCircuits);
+      evalCircuits = applyQwcGroups(obsCircuits, qwcGroups);
+      executionInfo.insert("vqe-num-terms", (int)obsCircuits.size());
+      executionInfo.insert("vqe-num-qwc-groups", (int)qwcGroups.size());
     }
 
-    // Now we have a wavefunction that represents execution of the ansatz.
-    // Run the observable sub-circuits (change of basis + measurements)
-    auto obsCircuits = kernelDecomposed.getObservedSubCircuits();
+    std::vector<double> expVals;
+    if (executionConfig.lightCone) {
+      expVals = getExpectationValuesByLightCone(
+          buffer, kernelDecomposed.getBase(), evalCircuits);
+    } else {
+      // Initialize the visitor
+      visitor->initialize(buffer, getShotCountOption(executionConfig.options));
+      visitor->setKernelName(kernelDecomposed.getBase()->name());
+      auto baseKernel =
+          applyOptimizationPasses(buffer, kernelDecomposed.getBase());
+      // Walk the base IR tree, and visit each node
+      InstructionIterator it(baseKernel);
+      while (it.hasNext()) {
+        auto nextInst = it.next();
+        if (nextInst->isEnabled() && !nextInst->isComposite()) {
+          nextInst->accept(visitor);
+        }
+      }
+      // Now we have a wavefunction that represents execution of the ansatz.
+      // Let the visitor evaluate all terms at once (sharing work between
+      // terms which have the same change of basis).
+      expVals = visitor->getExpectationValueZBatch(evalCircuits);
+      // Finalize the visitor
+      visitor->finalize();
+    }
+    assert(expVals.size() == obsCircuits.size());
     for (int i = 0; i < obsCircuits.size(); ++i) {
       auto tmpBuffer = std::make_shared<xacc::AcceleratorBuffer>(
           obsCircuits[i]->name(), buffer->size());
-      double e = visitor->getExpectationValueZ(obsCircuits[i]);
-      tmpBuffer->addExtraInfo("exp-val-z", e);
+      tmpBuffer->addExtraInfo("exp-val-z", expVals[i]);
       buffer->appendChild(obsCircuits[i]->name(), tmpBuffer);
     }
-    // Finalize the visitor
-    visitor->finalize();
   }
   // Normal execution mode
   else {
-    for (auto f : functions) {
-      auto tmpBuffer =
-          std::make_shared<xacc::AcceleratorBuffer>(f->name(), buffer->size());
-      execute(tmpBuffer, f);
-      buffer->appendChild(f->name(), tmpBuffer);
+    const size_t nbWorkers = getNumberOfKernelWorkers(functions.size());
+    if (executionConfig.sharedPrefix && functions.size() > 1 &&
+        canShareKernelPrefixes()) {
+      executeWithSharedPrefix(buffer, functions);
+    } else if (nbWorkers > 1) {
+      executeInParallel(buffer, functions, nbWorkers);
+    } else {
+      for (auto f : functions) {
+        auto tmpBuffer = std::make_shared<xacc::AcceleratorBuffer>(
+            f->name(), buffer->size());
+        setVisitor(getVisitor(false));
+        if (!executionConfig.clusterFactorization ||
+            !executeByClusters(tmpBuffer, f)) {
+          executeKernel(visitor, tmpBuffer, f);
+        }
+        buffer->appendChild(f->name(), tmpBuffer);
+      }
     }
   }
 
-  return;
+  recordExecutionInfo();
 }
 
 void TNQVM::execute(std::shared_ptr<xacc::AcceleratorBuffer> buffer,
                     const std::shared_ptr<xacc::CompositeInstruction> kernel) {
+  std::unique_lock<std::mutex> lock(executionMutex, std::try_to_lock);
+  if (!lock.owns_lock()) {
+    // Another execution is in progress on this instance.
+    executeInContext(
+        [&](TNQVM &in_context) { in_context.execute(buffer, kernel); });
+    return;
+  }
+  executionInfo.clear();
+  executionConfig = getConfiguration();
+  if (executionConfig.autoVisitor) {
+    executionConfig.backendName = selectVisitorBackend({kernel});
+  }
+  auto visitorLock = lockVisitorExecution();
+  // Get the visitor backend
+  setVisitor(getVisitor(false));
+  if (!executionConfig.clusterFactorization ||
+      !executeByClusters(buffer, kernel)) {
+    executeKernel(visitor, buffer, kernel);
+  }
+  recordExecutionInfo();
+}
+
+HeterogeneousMap TNQVM::getExecutionInfo() const {
+  {
+    std::lock_guard<std::mutex> lock(executionInfoMutex);
+    const auto iter = threadExecutionInfo.find(std::this_thread::get_id());
+    if (iter != threadExecutionInfo.end()) {
+      return iter->second;
+    }
+  }
+  return getCurrentExecutionInfo();
+}
+
+HeterogeneousMap TNQVM::getCurrentExecutionInfo() const {
+  std::shared_ptr<TNQVMVisitor> currentVisitor;
+  {
+    std::lock_guard<std::mutex> lock(configurationMutex);
+    currentVisitor = visitor;
+  }
+  auto result = currentVisitor->getExecutionInfo();
+  result.insert("visitor", currentVisitor->name());
+  // Accelerator-level info
+  result.merge(executionInfo);
+  return result;
+}
+
+void TNQVM::recordExecutionInfo() {
+  auto currentExecutionInfo = getCurrentExecutionInfo();
+  std::lock_guard<std::mutex> lock(executionInfoMutex);
+  threadExecutionInfo[std::this_thread::get_id()] =
+      std::move(currentExecutionInfo);
+}
+
+TNQVM::Configuration TNQVM::getConfiguration() const {
+  std::lock_guard<std::mutex> lock(configurationMutex);
+  return configuration;
+}
+
+void TNQVM::setVisitor(std::shared_ptr<TNQVMVisitor> in_visitor) {
+  std::lock_guard<std::mutex> lock(configurationMutex);
+  visitor = std::move(in_visitor);
+}
+
+std::shared_ptr<TNQVM> TNQVM::createExecutionContext() const {
+  auto context = std::make_shared<TNQVM>();
+  context->configuration = getConfiguration();
+  context->__verbose = __verbose;
+  context->isExecutionContext = true;
+  return context;
+}
+
+void TNQVM::executeInContext(const std::function<void(TNQVM &)> &in_execute) {
+  auto context = createExecutionContext();
+  in_execute(*context);
+  // The execution info of this call (for the calling thread)
+  auto contextExecutionInfo = context->getExecutionInfo();
+  std::lock_guard<std::mutex> lock(executionInfoMutex);
+  threadExecutionInfo[std::this_thread::get_id()] =
+      std::move(contextExecutionInfo);
+}
+
+std::unique_lock<std::mutex> TNQVM::lockVisitorExecution() const {
+  std::unique_lock<std::mutex> lock(getVisitorExecutionMutex(),
+                                    std::defer_lock);
+  if (!xacc::getService<TNQVMVisitor>(executionConfig.backendName)
+           ->isThreadSafe()) {
+    lock.lock();
+  }
+  return lock;
+}
+
+std::future<HeterogeneousMap> TNQVM::executeAsync(
+    std::shared_ptr<AcceleratorBuffer> buffer,
+    const std::vector<std::shared_ptr<xacc::CompositeInstruction>> functions,
+    CompletionCallback callback) {
+  return submitAsync(
+      [buffer, functions](TNQVM &in_submission) {
+        in_submission.execute(buffer, functions);
+      },
+      buffer, callback);
+}
+
+std::future<HeterogeneousMap>
+TNQVM::executeAsync(std::shared_ptr<AcceleratorBuffer> buffer,
+                    const std::shared_ptr<xacc::CompositeInstruction> kernel,
+                    CompletionCallback callback) {
+  return submitAsync(
+      [buffer, kernel](TNQVM &in_submission) {
+        in_submission.execute(buffer, kernel);
+      },
+      buffer, callback);
+}
+
+std::future<HeterogeneousMap>
+TNQVM::submitAsync(std::function<void(TNQVM &)> in_execute,
+                   std::shared_ptr<AcceleratorBuffer> buffer,
+                   CompletionCallback callback) {
+  // Snapshot of the configuration: later configuration updates of this
+  // instance don't affect in-flight submissions.
+  auto submission = createExecutionContext();
+  auto promise = std::make_shared<std::promise<HeterogeneousMap>>();
+  auto result = promise->get_future();
+  auto isDone = std::make_shared<std::atomic<bool>>(false);
+  std::thread worker(
+      [submission, in_execute, buffer, callback, promise, isDone]() {
+        try {
+          in_execute(*submission);
+          auto executionInfo = submission->getExecutionInfo();
+          if (callback) {
+            callback(buffer, executionInfo);
+          }
+          promise->set_value(std::move(executionInfo));
+        } catch (...) {
+          promise->set_exception(std::current_exception());
+        }
+        *isDone = true;
+      });
+  std::lock_guard<std::mutex> lock(asyncWorkersMutex);
+  // Join the finished workers.
+  for (auto iter = asyncWorkers.begin(); iter != asyncWorkers.end();) {
+    if (*iter->isDone) {
+      iter->thread.join();
+      iter = asyncWorkers.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+  asyncWorkers.emplace_back(AsyncWorker{std::move(worker), isDone});
+  return result;
+}
+
+TNQVM::~TNQVM() {
+  std::lock_guard<std::mutex> lock(asyncWorkersMutex);
+  for (auto &worker : asyncWorkers) {
+    // The last reference may be released by a completion callback (on the
+    // worker thread itself).
+    if (worker.thread.get_id() == std::this_thread::get_id()) {
+      worker.thread.detach();
+    } else {
+      worker.thread.join();
+    }
+  }
+}
+
+void TNQVM::executeKernel(std::shared_ptr<TNQVMVisitor> in_visitor,
+                          std::shared_ptr<xacc::AcceleratorBuffer> buffer,
+                          std::shared_ptr<xacc::CompositeInstruction> kernel) {
+  visitKernel(in_visitor, buffer, prepareKernel(buffer, kernel),
+              executionConfig.options);
+}
+
+std::shared_ptr<xacc::CompositeInstruction>
+TNQVM::prepareKernel(std::shared_ptr<xacc::AcceleratorBuffer> buffer,
+                     std::shared_ptr<xacc::CompositeInstruction> kernel) {
+  if (executionConfig.lightCone) {
+    if (auto coneKernel = pruneToMeasuredLightCone(kernel)) {
+      buffer->addExtraInfo("light-cone-gates-before", getGateCount(kernel));
+      buffer->addExtraInfo("light-cone-gates-after", getGateCount(coneKernel));
+      kernel = coneKernel;
+    }
+  }
+  applyVisitorTransformations(kernel);
+  return applyOptimizationPasses(buffer, kernel);
+}
+
+void TNQVM::visitKernel(std::shared_ptr<TNQVMVisitor> in_visitor,
+                        std::shared_ptr<xacc::AcceleratorBuffer> buffer,
+                        std::shared_ptr<xacc::CompositeInstruction> kernel,
+                        const HeterogeneousMap &in_options) {
+  in_visitor->setOptions(in_options);
+
+  // Initialize the visitor
+  in_visitor->initialize(buffer, getShotCountOption(in_options));
+  in_visitor->setKernelName(kernel->name());
+
+  // Walk the IR tree, and visit each node
+  InstructionIterator it(kernel);
+  while (it.hasNext()) {
+    auto nextInst = it.next();
+    if (nextInst->isEnabled()) {
+      nextInst->accept(in_visitor);
+    }
+  }
+
+  // Finalize the visitor
+  in_visitor->finalize();
+}
+
+void TNQVM::executeWithSharedPrefix(
+    std::shared_ptr<AcceleratorBuffer> buffer,
+    const std::vector<std::shared_ptr<xacc::CompositeInstruction>> &functions) {
+  // Flattened (prepared) kernels: the shareable prefix is the sequence of
+  // gates before the first measurement. The prefixes are compared after the
+  // kernel transformations and optimization passes, i.e. on the gates which
+  // are actually simulated.
+  struct FlatKernel {
+    std::vector<std::shared_ptr<xacc::Instruction>> instructions;
+    std::vector<std::string> prefixKeys;
+  };
+  std::vector<FlatKernel> flatKernels(functions.size());
+  std::vector<std::shared_ptr<AcceleratorBuffer>> childBuffers;
+  for (size_t i = 0; i < functions.size(); ++i) {
+    childBuffers.emplace_back(std::make_shared<xacc::AcceleratorBuffer>(
+        functions[i]->name(), buffer->size()));
+    auto kernel = prepareKernel(childBuffers[i], functions[i]);
+    InstructionIterator it(kernel);
+    bool isPrefix = true;
+    while (it.hasNext()) {
+      auto nextInst = it.next();
+      if (!nextInst->isEnabled() || nextInst->isComposite()) {
+        continue;
+      }
+      isPrefix = isPrefix && nextInst->name() != "Measure";
+      if (isPrefix) {
+        flatKernels[i].prefixKeys.emplace_back(nextInst->toString());
+      }
+      flatKernels[i].instructions.emplace_back(nextInst);
+    }
+  }
+
+  const auto commonPrefixLength = [&flatKernels](size_t lhs, size_t rhs) {
+    const auto &lhsKeys = flatKernels[lhs].prefixKeys;
+    const auto &rhsKeys = flatKernels[rhs].prefixKeys;
+    return (size_t)(std::mismatch(lhsKeys.begin(), lhsKeys.end(),
+                                  rhsKeys.begin(), rhsKeys.end())
+                        .first -
+                    lhsKeys.begin());
+  };
+
+  // Depth-first traversal of the prefix trie: in lexicographic order of the
+  // prefixes, kernels sharing a prefix are adjacent, and the longest prefix
+  // shared with any previous kernel is the one shared with the preceding
+  // kernel.
+  std::vector<size_t> order(functions.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) {
+    return flatKernels[lhs].prefixKeys < flatKernels[rhs].prefixKeys;
+  });
+
+  setVisitor(getVisitor(false));
+  // Snapshots (depth in the trie, state) along the current trie path.
+  std::vector<std::pair<size_t, std::shared_ptr<TNQVMVisitorSnapshot>>>
+      snapshots;
+  int nbTotalGates = 0;
+  int nbSimulatedGates = 0;
+  bool isSnapshotMissing = false;
+  for (size_t pos = 0; pos < order.size(); ++pos) {
+    const size_t kernelIdx = order[pos];
+    const auto &instructions = flatKernels[kernelIdx].instructions;
+    // Drop the snapshots which are not on this kernel's path.
+    const size_t sharedWithPrev =
+        pos > 0 ? commonPrefixLength(order[pos - 1], kernelIdx) : 0;
+    while (!snapshots.empty() && snapshots.back().first > sharedWithPrev) {
+      snapshots.pop_back();
+    }
+    // Branch point with the next kernel: snapshot the state there.
+    const size_t branchDepth =
+        pos + 1 < order.size() ? commonPrefixLength(kernelIdx, order[pos + 1])
+                               : 0;
+
+    visitor->setOptions(executionConfig.options);
+    visitor->initialize(childBuffers[kernelIdx],
+                        getShotCountOption(executionConfig.options));
+    visitor->setKernelName(functions[kernelIdx]->name());
+    size_t startDepth = 0;
+    if (!snapshots.empty()) {
+      visitor->restoreState(snapshots.back().second);
+      startDepth = snapshots.back().first;
+    }
+    for (size_t depth = startDepth; depth <= instructions.size(); ++depth) {
+      if (depth == branchDepth && depth > startDepth) {
+        auto snapshot = visitor->snapshotState();
+        if (snapshot) {
+          snapshots.emplace_back(depth, snapshot);
+        } else if (!isSnapshotMissing) {
+          isSnapshotMissing = true;
+          xacc::warning("The '" + executionConfig.backendName +
+                        "' visitor cannot snapshot this state (e.g. too many "
+                        "qubits). The shared prefixes will be re-simulated.");
+        }
+      }
+      if (depth < instructions.size()) {
+        instructions[depth]->accept(visitor);
+        ++nbSimulatedGates;
+      }
+    }
+    visitor->finalize();
+    nbTotalGates += instructions.size();
+  }
+
+  for (size_t i = 0; i < functions.size(); ++i) {
+    buffer->appendChild(functions[i]->name(), childBuffers[i]);
+  }
+  executionInfo.insert("shared-prefix-total-gates", nbTotalGates);
+  executionInfo.insert("shared-prefix-simulated-gates", nbSimulatedGates);
+}
+
+bool TNQVM::canShareKernelPrefixes() const {
+  if (!xacc::getService<TNQVMVisitor>(executionConfig.backendName)
+           ->supportsStateSnapshot()) {
+    xacc::warning("The '" + executionConfig.backendName +
+                  "' visitor doesn't support state snapshots. "
+                  "The 'shared-prefix' option will be ignored.");
+    return false;
+  }
+  if (executionConfig.clusterFactorization) {
+    xacc::warning("The 'shared-prefix' option cannot be combined with "
+                  "'cluster-factorization'. "
+                  "The 'shared-prefix' option will be ignored.");
+    return false;
+  }
+  return true;
+}
+
+size_t TNQVM::getNumberOfKernelWorkers(size_t in_nbKernels) const {
+  size_t nbWorkers =
+      std::min<size_t>(executionConfig.nbParallelKernels, in_nbKernels);
+  if (nbWorkers < 2) {
+    return 1;
+  }
+  if (!xacc::getService<TNQVMVisitor>(executionConfig.backendName)
+           ->isThreadSafe()) {
+    xacc::warning("The '" + executionConfig.backendName +
+                  "' visitor doesn't support parallel kernel execution. "
+                  "The 'parallel-kernels' option will be ignored.");
+    return 1;
+  }
+  // Limit the number of concurrent workers so that their combined memory
+  // budget fits in the physical memory.
+  if (executionConfig.workerMemoryBudgetMb > 0) {
+    const int64_t physMemBytes =
+        (int64_t)sysconf(_SC_PHYS_PAGES) * sysconf(_SC_PAGE_SIZE);
+    const int64_t budgetBytes =
+        executionConfig.workerMemoryBudgetMb * (1LL << 20);
+    if (physMemBytes > 0) {
+      nbWorkers = std::min<size_t>(
+          nbWorkers, std::max<int64_t>(1, physMemBytes / budgetBytes));
+    }
+  }
+  return nbWorkers;
+}
+
+void TNQVM::executeInParallel(
+    std::shared_ptr<AcceleratorBuffer> buffer,
+    const std::vector<std::shared_ptr<xacc::CompositeInstruction>> &functions,
+    size_t in_nbWorkers) {
+  std::vector<std::shared_ptr<AcceleratorBuffer>> childBuffers;
+  childBuffers.reserve(functions.size());
+  for (const auto &f : functions) {
+    childBuffers.emplace_back(
+        std::make_shared<xacc::AcceleratorBuffer>(f->name(), buffer->size()));
+  }
+  executeOnWorkers(childBuffers, functions, in_nbWorkers);
+
+  // Merge the results in submission order.
+  for (size_t i = 0; i < functions.size(); ++i) {
+    buffer->appendChild(functions[i]->name(), childBuffers[i]);
+  }
+  executionInfo.insert("parallel-kernels-workers", (int)in_nbWorkers);
+}
+
+void TNQVM::executeOnWorkers(
+    const std::vector<std::shared_ptr<AcceleratorBuffer>> &buffers,
+    const std::vector<std::shared_ptr<xacc::CompositeInstruction>> &functions,
+    size_t in_nbWorkers) {
+  assert(buffers.size() == functions.size());
+  // One visitor clone per worker and the kernel transformations (which use
+  // IR providers and services) are done here: the service registry is not
+  // meant to be accessed concurrently.
+  std::vector<std::shared_ptr<TNQVMVisitor>> workerVisitors;
+  for (size_t i = 0; i < in_nbWorkers; ++i) {
+    workerVisitors.emplace_back(
+        xacc::getService<TNQVMVisitor>(executionConfig.backendName)->clone());
+  }
+  // The per-worker memory budget is also the memory budget of the worker
+  // visitors (unless set explicitly).
+  auto workerOptions = executionConfig.options;
+  if (executionConfig.workerMemoryBudgetMb > 0 &&
+      !workerOptions.keyExists<int>("memory-budget")) {
+    workerOptions.insert("memory-budget", executionConfig.workerMemoryBudgetMb);
+  }
+  std::vector<std::shared_ptr<xacc::CompositeInstruction>> preparedKernels;
+  preparedKernels.reserve(functions.size());
+  for (size_t i = 0; i < functions.size(); ++i) {
+    preparedKernels.emplace_back(prepareKernel(buffers[i], functions[i]));
+  }
+
+  // Workers pick the next kernel to execute (kernels may have very different
+  // costs, hence no static partitioning).
+  std::atomic<size_t> nextKernelIdx(0);
+  std::vector<std::exception_ptr> workerErrors(in_nbWorkers);
+  std::vector<std::thread> workers;
+  for (size_t workerIdx = 0; workerIdx < in_nbWorkers; ++workerIdx) {
+    workers.emplace_back([&, workerIdx]() {
+      try {
+        for (size_t kernelIdx = nextKernelIdx++; kernelIdx < functions.size();
+             kernelIdx = nextKernelIdx++) {
+          visitKernel(workerVisitors[workerIdx], buffers[kernelIdx],
+                      preparedKernels[kernelIdx], workerOptions);
+        }
+      } catch (...) {
+        workerErrors[workerIdx] = std::current_exception();
+      }
+    });
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  for (const auto &error : workerErrors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  setVisitor(workerVisitors.front());
+}
+
+bool TNQVM::executeByClusters(std::shared_ptr<AcceleratorBuffer> buffer,
+                              std::shared_ptr<CompositeInstruction> kernel) {
+  // The noise model (e.g. readout errors) refers to the qubits of the whole
+  // register.
+  if (executionConfig.options.pointerLikeExists<xacc::NoiseModel>("noise-model")) {
+    return false;
+  }
+  std::vector<std::shared_ptr<xacc::Instruction>> gates;
+  std::vector<std::vector<size_t>> gateQubits;
+  bool hasMeasurement = false;
+  InstructionIterator it(kernel);
+  while (it.hasNext()) {
+    auto nextInst = it.next();
+    if (!nextInst->isEnabled() || nextInst->isComposite()) {
+      continue;
+    }
+    const bool isMeasurement = (nextInst->name() == "Measure");
+    // Gates after a measurement may be conditioned on its result (across
+    // clusters): only terminal measurements are supported.
+    if (hasMeasurement && !isMeasurement) {
+      return false;
+    }
+    hasMeasurement = hasMeasurement || isMeasurement;
+    gates.emplace_back(nextInst);
+    gateQubits.emplace_back(nextInst->bits());
+  }
+  // Without measurements, the result is the state of the whole register.
+  if (!hasMeasurement) {
+    return false;
+  }
+  const auto qubitClusters =
+      clusters::computeQubitClusters(buffer->size(), gateQubits);
+  if (qubitClusters.size() < 2) {
+    return false;
+  }
+
+  // Qubit -> (cluster, qubit index in the cluster register)
+  std::vector<std::pair<size_t, size_t>> qubitMap(buffer->size());
+  for (size_t clusterIdx = 0; clusterIdx < qubitClusters.size(); ++clusterIdx) {
+    for (size_t i = 0; i < qubitClusters[clusterIdx].size(); ++i) {
+      qubitMap[qubitClusters[clusterIdx][i]] = std::make_pair(clusterIdx, i);
+    }
+  }
+  // Cluster kernels (gate order is preserved within each cluster)
+  auto provider = xacc::getIRProvider("quantum");
+  std::vector<std::shared_ptr<CompositeInstruction>> clusterKernels;
+  for (size_t clusterIdx = 0; clusterIdx < qubitClusters.size(); ++clusterIdx) {
+    clusterKernels.emplace_back(provider->createComposite(kernel->name()));
+  }
+  // Bit strings are in measurement order: source (cluster, bit position) of
+  // each bit of the combined bit strings.
+  std::vector<std::pair<size_t, size_t>> bitSources;
+  std::vector<size_t> nbClusterMeasurements(qubitClusters.size(), 0);
+  for (const auto &gate : gates) {
+    const size_t clusterIdx = qubitMap[gate->bits()[0]].first;
+    auto clusterGate = gate->clone();
+    auto bits = clusterGate->bits();
+    for (auto &bit : bits) {
+      bit = qubitMap[bit].second;
+    }
+    clusterGate->setBits(bits);
+    clusterKernels[clusterIdx]->addInstruction(clusterGate);
+    if (gate->name() == "Measure") {
+      bitSources.emplace_back(clusterIdx,
+                              nbClusterMeasurements[clusterIdx]++);
+    }
+  }
+
+  // Clusters without measurements don't contribute to the result.
+  std::vector<size_t> measuredClusters;
+  std::vector<std::shared_ptr<AcceleratorBuffer>> clusterBuffers(
+      qubitClusters.size());
+  std::vector<std::shared_ptr<CompositeInstruction>> kernelsToExecute;
+  std::vector<std::shared_ptr<AcceleratorBuffer>> buffersToExecute;
+  int maxClusterQubits = 0;
+  for (size_t clusterIdx = 0; clusterIdx < qubitClusters.size(); ++clusterIdx) {
+    if (nbClusterMeasurements[clusterIdx] == 0) {
+      continue;
+    }
+    clusterBuffers[clusterIdx] = std::make_shared<xacc::AcceleratorBuffer>(
+        buffer->name(), qubitClusters[clusterIdx].size());
+    measuredClusters.emplace_back(clusterIdx);
+    kernelsToExecute.emplace_back(clusterKernels[clusterIdx]);
+    buffersToExecute.emplace_back(clusterBuffers[clusterIdx]);
+    maxClusterQubits =
+        std::max(maxClusterQubits, (int)qubitClusters[clusterIdx].size());
+  }
+  const size_t nbWorkers = getNumberOfKernelWorkers(kernelsToExecute.size());
+  if (nbWorkers > 1) {
+    executeOnWorkers(buffersToExecute, kernelsToExecute, nbWorkers);
+  } else {
+    for (size_t i = 0; i < kernelsToExecute.size(); ++i) {
+      executeKernel(visitor, buffersToExecute[i], kernelsToExecute[i]);
+    }
+  }
+
+  // The Z-string on all measured qubits is a product over the clusters.
+  const bool hasExpValZ = std::all_of(
+      buffersToExecute.begin(), buffersToExecute.end(),
+      [](const auto &in_buffer) { return in_buffer->hasExtraInfoKey("exp-val-z"); });
+  if (hasExpValZ) {
+    double expValZ = 1.0;
+    for (const auto &clusterBuffer : buffersToExecute) {
+      expValZ *= clusterBuffer->getExpectationValueZ();
+    }
+    buffer->addExtraInfo("exp-val-z", expValZ);
+  }
+  // Samples: the clusters are independent, hence pairing the shots of each
+  // cluster at random gives samples of the product distribution.
+  static thread_local std::mt19937 randomGenerator(std::random_device{}());
+  std::vector<std::vector<std::string>> clusterSamples(qubitClusters.size());
+  size_t nbSamples = std::numeric_limits<size_t>::max();
+  for (const auto &clusterIdx : measuredClusters) {
+    auto &samples = clusterSamples[clusterIdx];
+    for (const auto &[bitString, count] :
+         clusterBuffers[clusterIdx]->getMeasurementCounts()) {
+      samples.insert(samples.end(), count, bitString);
+    }
+    std::shuffle(samples.begin(), samples.end(), randomGenerator);
+    nbSamples = std::min(nbSamples, samples.size());
+  }
+  if (nbSamples > 0) {
+    for (const auto &clusterIdx : measuredClusters) {
+      clusterSamples[clusterIdx].resize(nbSamples);
+    }
+    for (const auto &bitString :
+         clusters::combineSamples(clusterSamples, bitSources)) {
+      buffer->appendMeasurement(bitString);
+    }
+  }
+
+  buffer->addExtraInfo("cluster-count", (int)qubitClusters.size());
+  buffer->addExtraInfo("cluster-max-qubits", maxClusterQubits);
+  // Largest simulated register over all kernels of this execution
+  std::lock_guard<std::mutex> lock(executionInfoMutex);
+  if (executionInfo.keyExists<int>("cluster-max-qubits")) {
+    maxClusterQubits = std::max(maxClusterQubits,
+                                executionInfo.get<int>("cluster-max-qubits"));
+  }
+  executionInfo.insert("cluster-max-qubits", maxClusterQubits);
+  return true;
+}
+
+std::shared_ptr<InstructionTape>
+TNQVM::compile(std::shared_ptr<xacc::CompositeInstruction> kernel) {
+  // Prepared (visitor transformations and optimization passes) with the
+  // current configuration, on a copy of the kernel. An execution context is
+  // used since this instance may be executing.
+  auto context = createExecutionContext();
+  context->executionConfig = context->configuration;
+  auto kernelCopy =
+      std::dynamic_pointer_cast<xacc::CompositeInstruction>(kernel->clone());
+  auto statsBuffer =
+      std::make_shared<xacc::AcceleratorBuffer>(kernel->name(), 1);
+  return InstructionTape::compile(
+      context->prepareKernel(statsBuffer, kernelCopy));
+}
+
+void TNQVM::execute(std::shared_ptr<xacc::AcceleratorBuffer> buffer,
+                    std::shared_ptr<InstructionTape> tape,
+                    const std::vector<double> &params) {
+  std::unique_lock<std::mutex> lock(executionMutex, std::try_to_lock);
+  if (!lock.owns_lock()) {
+    // Another execution is in progress on this instance.
+    executeInContext([&](TNQVM &in_context) {
+      in_context.execute(buffer, tape, params);
+    });
+    return;
+  }
+  executionInfo.clear();
+  executionConfig = getConfiguration();
+  if (executionConfig.clusterFactorization) {
+    xacc::warning("The 'cluster-factorization' option doesn't apply to "
+                  "compiled tapes and will be ignored.");
+  }
+  // The caller's tape is never modified: it may be replayed concurrently with
+  // different parameters.
+  auto boundTape = tape;
+  if (!params.empty() || !tape->variables().empty()) {
+    boundTape = tape->bindCopy(params);
+  }
+  assert(boundTape->isBound());
+  auto visitorLock = lockVisitorExecution();
   // Get the visitor backend
-  visitor = xacc::getService<TNQVMVisitor>(getVisitorName());
-  visitor->setOptions(options);
+  setVisitor(getVisitor(true));
+  visitor->setOptions(executionConfig.options);
 
   // Initialize the visitor
-  visitor->initialize(buffer, getShotCountOption(options));
-  visitor->setKernelName(kernel->name());
+  visitor->initialize(buffer, getShotCountOption(executionConfig.options));
+  visitor->setKernelName(boundTape->name());
+  // Replay the tape: no IR traversal, the visitor can directly use the
+  // precomputed gate matrices.
+  for (const auto &entry : boundTape->entries()) {
+    if (!visitor->visitTapeEntry(entry)) {
+      entry.gate->accept(visitor);
+    }
+  }
+
+  // Finalize the visitor
+  visitor->finalize();
+  recordExecutionInfo();
+}
+
+std::shared_ptr<TNQVMVisitor> TNQVM::getVisitor(bool in_clone) {
+  // Execution contexts never share the (service) visitor instance.
+  in_clone = in_clone || isExecutionContext;
+  if (executionConfig.warmMode) {
+    // The warm visitors are cleared by configuration updates.
+    std::lock_guard<std::mutex> lock(configurationMutex);
+    auto &warmVisitor = warmVisitors[executionConfig.backendName];
+    if (!warmVisitor) {
+      warmVisitor =
+          xacc::getService<TNQVMVisitor>(executionConfig.backendName)->clone();
+    }
+    return warmVisitor;
+  }
+  auto service = xacc::getService<TNQVMVisitor>(executionConfig.backendName);
+  return in_clone ? service->clone() : service;
+}
+
+std::string TNQVM::selectVisitorBackend(
+    const std::vector<std::shared_ptr<xacc::CompositeInstruction>> &functions) {
+  // Profile the largest kernel (e.g. the ansatz + basis change in VQE mode)
+  selection::CircuitProfile profile;
+  for (const auto &f : functions) {
+    std::vector<std::vector<size_t>> gateQubits;
+    size_t nbQubits = 0;
+    InstructionIterator it(f);
+    while (it.hasNext()) {
+      auto nextInst = it.next();
+      if (nextInst->isEnabled() && !nextInst->isComposite() &&
+          nextInst->name() != "Measure") {
+        gateQubits.emplace_back(nextInst->bits());
+        for (const auto &bit : nextInst->bits()) {
+          nbQubits = std::max<size_t>(nbQubits, bit + 1);
+        }
+      }
+    }
+    if (gateQubits.size() >= profile.nbGates) {
+      profile = selection::profileCircuit(gateQubits, nbQubits);
+    }
+  }
+  profile.nbKernels = functions.size();
+  profile.hasNoiseModel = executionConfig.options.pointerLikeExists<xacc::NoiseModel>("noise-model");
+  profile.needsSampling = getShotCountOption(executionConfig.options) > 1;
+  profile.isVqe = executionConfig.vqeMode && functions.size() > 1;
+
+  std::vector<std::string> backends;
+  for (const auto &service : xacc::getServices<TNQVMVisitor>()) {
+    if (std::find(backends.begin(), backends.end(), service->name()) ==
+        backends.end()) {
+      backends.emplace_back(service->name());
+    }
+  }
+  const double physMemBytes =
+      (double)sysconf(_SC_PHYS_PAGES) * sysconf(_SC_PAGE_SIZE);
+  const auto decision =
+      selection::selectBackend(profile, backends, physMemBytes);
+  std::string selectedBackend = decision.backend;
+  if (selectedBackend.empty()) {
+    selectedBackend = DEFAULT_VISITOR_BACKEND;
+    xacc::warning("No TNQVM visitor backend is applicable to this circuit. "
+                  "The default visitor backend of type '" +
+                  DEFAULT_VISITOR_BACKEND + "' will be used.");
+  }
+
+  std::map<std::string, double> log2Costs;
+  for (const auto &estimate : decision.estimates) {
+    log2Costs.emplace(estimate.backend, estimate.log2Cost);
+    if (estimate.backend == selectedBackend) {
+      executionInfo.insert("auto-visitor-log2-cost", estimate.log2Cost);
+      executionInfo.insert("auto-visitor-log2-memory", estimate.log2Memory);
+      executionInfo.insert("auto-visitor-feasible", estimate.isFeasible);
+    }
+  }
+  executionInfo.insert("auto-visitor", selectedBackend);
+  executionInfo.insert("auto-visitor-estimates", log2Costs);
+  return selectedBackend;
+}
+
+void TNQVM::applyVisitorTransformations(
+    std::shared_ptr<xacc::CompositeInstruction> kernel) {
   // If this is an Exatn-MPS visitor, transform the kernel to nearest-neighbor
   // Note: currently, we don't support MPS aggregated blocks (multiple qubit MPS
   // tensors in one block). Hence, the circuit must always be transformed into
   // *nearest* neighbor only (distance = 1 for two-qubit gates).
-  if (visitor->name() == "exatn-mps" || visitor->name() == "exatn-pmps") {
+  if (executionConfig.backendName == "exatn-mps" ||
+      executionConfig.backendName == "exatn-pmps") {
     auto opt = xacc::getService<xacc::IRTransformation>("lnn-transform");
     opt->apply(kernel, nullptr, {std::make_pair("max-distance", 1)});
     // std::cout << "After LNN transform: \n" << kernel->toString() << "\n";
   }
+}
 
-  // Walk the IR tree, and visit each node
-  InstructionIterator it(kernel);
-  while (it.hasNext()) {
-    auto nextInst = it.next();
-    if (nextInst->isEnabled()) {
-      nextInst->accept(visitor);
+std::vector<double> TNQVM::getExpectationValuesByLightCone(
+    std::shared_ptr<AcceleratorBuffer> buffer,
+    std::shared_ptr<CompositeInstruction> ansatz,
+    const std::vector<std::shared_ptr<CompositeInstruction>> &obsCircuits) {
+  const auto getGates = [](std::shared_ptr<CompositeInstruction> in_kernel) {
+    std::vector<std::shared_ptr<xacc::Instruction>> gates;
+    xacc::InstructionIterator it(in_kernel);
+    while (it.hasNext()) {
+      auto nextInst = it.next();
+      if (nextInst->isEnabled() && !nextInst->isComposite()) {
+        gates.emplace_back(nextInst);
+      }
+    }
+    return gates;
+  };
+  const auto getGateQubits =
+      [](const std::vector<std::shared_ptr<xacc::Instruction>> &in_gates) {
+        std::vector<std::vector<size_t>> qubits;
+        for (const auto &gate : in_gates) {
+          qubits.emplace_back(gate->bits());
+        }
+        return qubits;
+      };
+
+  const auto ansatzGates = getGates(ansatz);
+  const auto ansatzQubits = getGateQubits(ansatzGates);
+  // Terms whose measured qubits have the same backward light cone (in the
+  // ansatz) share the same reduced ansatz circuit.
+  struct ConeGroup {
+    std::vector<size_t> ansatzGates;
+    std::set<size_t> qubits;
+    std::vector<size_t> members;
+  };
+  std::vector<ConeGroup> groups;
+  std::map<std::vector<size_t>, size_t> coneToGroup;
+  // Gates of each observed sub-circuit in the light cone of its measurements.
+  std::vector<std::vector<std::shared_ptr<xacc::Instruction>>> termGates(
+      obsCircuits.size());
+  for (size_t i = 0; i < obsCircuits.size(); ++i) {
+    const auto obsGates = getGates(obsCircuits[i]);
+    std::vector<size_t> measuredQubits;
+    for (const auto &gate : obsGates) {
+      if (gate->name() == "Measure") {
+        measuredQubits.emplace_back(gate->bits()[0]);
+      }
+    }
+    std::set<size_t> basisChangeQubits;
+    for (const auto &idx : lightcone::computeLightCone(
+             getGateQubits(obsGates), measuredQubits, &basisChangeQubits)) {
+      termGates[i].emplace_back(obsGates[idx]);
     }
+    std::set<size_t> coneQubits;
+    auto cone = lightcone::computeLightCone(
+        ansatzQubits,
+        std::vector<size_t>(basisChangeQubits.begin(), basisChangeQubits.end()),
+        &coneQubits);
+    const auto [iter, isNewCone] = coneToGroup.emplace(cone, groups.size());
+    if (isNewCone) {
+      groups.emplace_back();
+      groups.back().ansatzGates = std::move(cone);
+    }
+    auto &group = groups[iter->second];
+    group.qubits.insert(coneQubits.begin(), coneQubits.end());
+    group.members.emplace_back(i);
   }
 
-  // Finalize the visitor
-  visitor->finalize();
+  auto provider = xacc::getIRProvider("quantum");
+  std::vector<double> result(obsCircuits.size(), 0.0);
+  int maxConeQubits = 0;
+  for (const auto &group : groups) {
+    // Compact the qubits of the light cone.
+    std::map<size_t, size_t> qubitMap;
+    for (const auto &qubit : group.qubits) {
+      qubitMap.emplace(qubit, qubitMap.size());
+    }
+    const auto remapGate = [&qubitMap](std::shared_ptr<xacc::Instruction> in_gate) {
+      auto gate = in_gate->clone();
+      auto bits = gate->bits();
+      for (auto &bit : bits) {
+        bit = qubitMap.at(bit);
+      }
+      gate->setBits(bits);
+      return gate;
+    };
+    auto reducedAnsatz = provider->createComposite(ansatz->name());
+    for (const auto &idx : group.ansatzGates) {
+      reducedAnsatz->addInstruction(remapGate(ansatzGates[idx]));
+    }
+    std::vector<std::shared_ptr<CompositeInstruction>> reducedObsCircuits;
+    for (const auto &termIdx : group.members) {
+      auto reducedObs = provider->createComposite(obsCircuits[termIdx]->name());
+      for (const auto &gate : termGates[termIdx]) {
+        reducedObs->addInstruction(remapGate(gate));
+      }
+      reducedObsCircuits.emplace_back(reducedObs);
+    }
+
+    auto coneBuffer =
+        std::make_shared<xacc::AcceleratorBuffer>(buffer->name(), qubitMap.size());
+    maxConeQubits = std::max(maxConeQubits, (int)qubitMap.size());
+    visitor->initialize(coneBuffer, getShotCountOption(executionConfig.options));
+    visitor->setKernelName(reducedAnsatz->name());
+    auto coneKernel = applyOptimizationPasses(coneBuffer, reducedAnsatz);
+    InstructionIterator it(coneKernel);
+    while (it.hasNext()) {
+      auto nextInst = it.next();
+      if (nextInst->isEnabled() && !nextInst->isComposite()) {
+        nextInst->accept(visitor);
+      }
+    }
+    const auto expVals = visitor->getExpectationValueZBatch(reducedObsCircuits);
+    visitor->finalize();
+    assert(expVals.size() == group.members.size());
+    for (size_t i = 0; i < group.members.size(); ++i) {
+      result[group.members[i]] = expVals[i];
+    }
+  }
+
+  executionInfo.insert("light-cone-groups", (int)groups.size());
+  executionInfo.insert("light-cone-max-qubits", maxConeQubits);
+  return result;
+}
+
+std::shared_ptr<xacc::CompositeInstruction>
+TNQVM::applyOptimizationPasses(
+    std::shared_ptr<xacc::AcceleratorBuffer> buffer,
+    std::shared_ptr<xacc::CompositeInstruction> kernel) {
+  if (executionConfig.peephole) {
+    const int nbGatesBefore = getGateCount(kernel);
+    kernel = simplifyCircuit(kernel);
+    const int nbGatesAfter = getGateCount(kernel);
+    buffer->addExtraInfo("peephole-gates-before", nbGatesBefore);
+    buffer->addExtraInfo("peephole-gates-after", nbGatesAfter);
+    // Totals over all kernels of this execution
+    std::lock_guard<std::mutex> lock(executionInfoMutex);
+    const auto addCount = [this](const std::string &in_key, int in_count) {
+      if (executionInfo.keyExists<int>(in_key)) {
+        in_count += executionInfo.get<int>(in_key);
+      }
+      executionInfo.insert(in_key, in_count);
+    };
+    addCount("peephole-gates-before", nbGatesBefore);
+    addCount("peephole-gates-after", nbGatesAfter);
+  }
+  if (executionConfig.gateFusion) {
+    const int nbGatesBefore = getGateCount(kernel);
+    kernel = fuseGates(kernel);
+    buffer->addExtraInfo("gate-fusion-gates-before", nbGatesBefore);
+    buffer->addExtraInfo("gate-fusion-gates-after", getGateCount(kernel));
+  }
+  return kernel;
 }
 
 const std::vector<std::complex<double>>
 TNQVM::getAcceleratorState(std::shared_ptr<CompositeInstruction> program) {
+  executionConfig = getConfiguration();
   // Get the visitor backend
-  visitor = xacc::getService<TNQVMVisitor>(getVisitorName());
+  setVisitor(xacc::getService<TNQVMVisitor>(executionConfig.backendName));
 
   int maxBit = 0;
   if (!xacc::optionExists("n-qubits")) {
@@ -152,7 +1140,7 @@ TNQVM::getAcceleratorState(std::shared_ptr<CompositeInstruction> program) {
   auto buffer = std::make_shared<xacc::AcceleratorBuffer>("q", maxBit + 1);
 
   // Initialize the visitor
-  visitor->initialize(buffer, getShotCountOption(options));
+  visitor->initialize(buffer, getShotCountOption(executionConfig.options));
 
   // Walk the IR tree, and visit each node
   InstructionIterator it(program);
@@ -34,7 +34,14 @@
 #include "xacc.hpp"
 #include "xacc_service.hpp"
 #include "TNQVMVisitor.hpp"
+#include <atomic>
 #include <cassert>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 // Documentation: https://xacc.readthedocs.io/en/latest/extensions.html#tnqvm
 
@@ -49,7 +56,10 @@ public:
       __verbose = 0;
     }    
     // Clear the cached configs on TNQVM initialize.
-    options.clear();
+    {
+      std::lock_guard<std::mutex> lock(configurationMutex);
+      configuration.options.clear();
+    }
     // Force a configuration update,
     // which will update the cache appropriately.
     updateConfiguration(params);
@@ -58,11 +68,47 @@ public:
   // Update TNQVM configurations:
   // This is called post-initialize to add/update configurations.
   void updateConfiguration(const HeterogeneousMap &config) override {
+    // May be called while this instance is executing (or creating an
+    // execution context) on another thread.
+    std::lock_guard<std::mutex> lock(configurationMutex);
     if (config.keyExists<bool>("verbose") && config.get<bool>("verbose")) {
       __verbose = 1;
     }
     if (config.keyExists<bool>("vqe-mode")) {
-      vqeMode = config.get<bool>("vqe-mode");
+      configuration.vqeMode = config.get<bool>("vqe-mode");
+    }
+    if (config.keyExists<bool>("warm-mode")) {
+      configuration.warmMode = config.get<bool>("warm-mode");
+      if (!configuration.warmMode) {
+        warmVisitors.clear();
+      }
+    }
+    if (config.keyExists<int>("parallel-kernels")) {
+      configuration.nbParallelKernels = config.get<int>("parallel-kernels");
+      if (configuration.nbParallelKernels < 1) {
+        xacc::error("Invalid 'parallel-kernels' parameter.");
+      }
+    }
+    if (config.keyExists<int>("parallel-kernels-memory-mb")) {
+      configuration.workerMemoryBudgetMb = config.get<int>("parallel-kernels-memory-mb");
+    }
+    if (config.keyExists<bool>("shared-prefix")) {
+      configuration.sharedPrefix = config.get<bool>("shared-prefix");
+    }
+    if (config.keyExists<bool>("qwc-grouping")) {
+      configuration.qwcGrouping = config.get<bool>("qwc-grouping");
+    }
+    if (config.keyExists<bool>("light-cone")) {
+      configuration.lightCone = config.get<bool>("light-cone");
+    }
+    if (config.keyExists<bool>("peephole")) {
+      configuration.peephole = config.get<bool>("peephole");
+    }
+    if (config.keyExists<bool>("gate-fusion")) {
+      configuration.gateFusion = config.get<bool>("gate-fusion");
+    }
+    if (config.keyExists<bool>("cluster-factorization")) {
+      configuration.clusterFactorization = config.get<bool>("cluster-factorization");
     }
 
     if (config.stringExists("tnqvm-visitor") ||
@@ -74,6 +120,8 @@ public:
       const auto requestedBackend = config.stringExists("tnqvm-visitor")
                                         ? config.getString("tnqvm-visitor")
                                         : config.getString("backend");
+      // "auto": the backend is selected for each execution (cost model).
+      configuration.autoVisitor = (requestedBackend == "auto");
       const auto &allVisitorServices = xacc::getServices<TNQVMVisitor>();
       // We must have at least one TNQVM service registered.
       assert(!allVisitorServices.empty());
@@ -84,28 +132,28 @@ public:
         if (registeredService->name() == requestedBackend)
         {
           // Found it, use that service name.
-          backendName = registeredService->name();
+          configuration.backendName = registeredService->name();
           foundRequestedBackend = true;
           break;
         }
       }
       // A visitor backend was explicitly specified but the corresponding service cannot be found,
       // e.g. the service name was misspelled.
-      if (!foundRequestedBackend)
+      if (!foundRequestedBackend && !configuration.autoVisitor)
       {
-        backendName = DEFAULT_VISITOR_BACKEND;
+        configuration.backendName = DEFAULT_VISITOR_BACKEND;
         xacc::warning("The requested TNQVM visitor backend '" + requestedBackend + "' cannot be found in the service registry. Please make sure the name is correct and the service is installed.\n"
           "The default visitor backend of type '" + DEFAULT_VISITOR_BACKEND + "' will be used.");
       }
     }
 
     if (config.keyExists<int>("shots")) {
-      nbShots = config.get<int>("shots");
-      if (nbShots < 1) {
+      configuration.nbShots = config.get<int>("shots");
+      if (configuration.nbShots < 1) {
         xacc::error("Invalid 'shots' parameter.");
       }
 
-      if (nbShots > 1 && backendName == "itensor-mps") {
+      if (configuration.nbShots > 1 && configuration.backendName == "itensor-mps" && !configuration.autoVisitor) {
         xacc::warning("Multi-shot simulation is not available for 'itensor-mps' backend. This option will be ignored. \nPlease use 'exatn' backend if you want to run multi-shot simulation.");
       }
     }
@@ -115,7 +163,7 @@ public:
     // have been handled here, i.e. retrieving from the new config map. The rest
     // of the configs are visitor-specific and will be forwarded to them
     // accordingly.
-    options.merge(config);
+    configuration.options.merge(config);
   }
   const std::vector<std::string> configurationKeys() override { return {}; }
 //   const std::string getSignature() override {return name()+":";}
@@ -131,21 +179,60 @@ public:
   const std::vector<std::complex<double>>
   getAcceleratorState(std::shared_ptr<CompositeInstruction> program) override;
 
+  // Lower the kernel once into a replayable instruction tape, e.g. for
+  // optimizer loops executing the same circuit structure many times.
+  // The visitor transformations and the optimization passes (light-cone,
+  // peephole, gate-fusion) of the current configuration are applied here,
+  // once. The multi-kernel options (vqe-mode, shared-prefix,
+  // parallel-kernels) don't apply to a tape, nor does cluster-factorization.
+  std::shared_ptr<InstructionTape>
+  compile(std::shared_ptr<CompositeInstruction> kernel);
+  // Execute a compiled tape after binding its variables to the given values
+  // (in the order of the kernel's getVariables()). The tape itself is not
+  // modified (a bound copy is executed), hence it can be replayed
+  // concurrently.
+  void execute(std::shared_ptr<AcceleratorBuffer> buffer,
+               std::shared_ptr<InstructionTape> tape,
+               const std::vector<double> &params = {});
+
+  // Completion callback of an asynchronous submission: the result buffer and
+  // the execution info of that submission.
+  using CompletionCallback = std::function<void(
+      std::shared_ptr<AcceleratorBuffer>, const HeterogeneousMap &)>;
+  // Non-blocking execution: the kernels are executed on a worker thread by a
+  // separate accelerator instance (own visitor, snapshot of the current
+  // configuration), hence several submissions can be in flight.
+  // The callback (if any) is invoked on the worker thread upon completion; the
+  // returned future holds the execution info of the submission.
+  // The worker threads are owned by this instance (joined on destruction).
+  // Note: submissions using a visitor which is not thread-safe are serialized,
+  // e.g. ExaTN-based submissions run one at a time.
+  std::future<HeterogeneousMap>
+  executeAsync(std::shared_ptr<AcceleratorBuffer> buffer,
+               const std::vector<std::shared_ptr<CompositeInstruction>> functions,
+               CompletionCallback callback = {});
+  std::future<HeterogeneousMap>
+  executeAsync(std::shared_ptr<AcceleratorBuffer> buffer,
+               const std::shared_ptr<CompositeInstruction> kernel,
+               CompletionCallback callback = {});
+
   const std::string name() const override { return "tnqvm"; }
   
   const std::string description() const override {
     return "XACC tensor network quantum virtual machine (TNQVM) Accelerator";
   }
 
-  const std::string& getVisitorName() const { return backendName; }
+  std::string getVisitorName() const {
+    std::lock_guard<std::mutex> lock(configurationMutex);
+    return configuration.backendName;
+  }
   
-  virtual ~TNQVM() {}
+  // Waits for the asynchronous submissions in flight.
+  virtual ~TNQVM();
   
-  virtual HeterogeneousMap getExecutionInfo() const override { 
-    auto result = visitor->getExecutionInfo();
-    result.insert("visitor", visitor->name());
-    return result; 
-  }
+  // Execution info of the last execution by the calling thread (if any),
+  // otherwise of the last execution on this instance.
+  virtual HeterogeneousMap getExecutionInfo() const override;
   
   int verbose() const { return __verbose; }
   void verbose(int level) { __verbose = level; }
@@ -154,25 +241,174 @@ public:
   void unmute() { __verbose = 1; } // default to 1
   
 protected:
+  // Default visitor backend is ITensor.
+  // TODO: we may eventually use our exatn as default.
+  static const std::string DEFAULT_VISITOR_BACKEND;
+  // Accelerator configuration (set by initialize/updateConfiguration).
+  struct Configuration {
+    bool vqeMode = true;
+    // Keep visitor instances (and their backend resources) alive between calls
+    bool warmMode = false;
+    // Max number of kernels executed concurrently (non-VQE multi-kernel execution)
+    int nbParallelKernels = 1;
+    // Memory budget (MB) of each parallel worker, used to limit the number of
+    // concurrent workers and passed to the worker visitors as their
+    // "memory-budget" (0: no limit).
+    int workerMemoryBudgetMb = 0;
+    // Share the simulation of common kernel prefixes (non-VQE multi-kernel execution)
+    bool sharedPrefix = false;
+    // Group VQE terms into qubit-wise commuting sets (VQE mode only)
+    bool qwcGrouping = true;
+    // Light-cone pruning of the ansatz for each term (VQE mode), or of the
+    // gates outside the cone of the measured qubits (other kernels)
+    bool lightCone = false;
+    // Peephole simplification (inverse pairs, rotation merging, trailing
+    // diagonal gates before measurement) before execution
+    bool peephole = false;
+    // Fuse runs of gates into (at most) two-qubit unitaries before execution
+    bool gateFusion = false;
+    // Simulate non-interacting qubit clusters of a kernel independently
+    bool clusterFactorization = false;
+    // Select the backend for each execution (tnqvm-visitor=auto)
+    bool autoVisitor = false;
+    // The backend name that is configured.
+    // Initialized to the default.
+    std::string backendName = DEFAULT_VISITOR_BACKEND;
+    // Number of *shots* (randomized runs) requested.
+    // If not specified (i.e. left as -1), 
+    // then we don't return the binary measurement result (as a bit string).
+    // This is to make sure that on the XACC side, it can interpret the avarage-Z result correctly.
+    int nbShots = -1;
+    // Cache of the TNQVM options (to send on to the visitor)
+    HeterogeneousMap options;
+  };
   std::shared_ptr<TNQVMVisitor> visitor;
+  // Get the visitor to execute with: in warm mode, the visitor instance of the
+  // selected backend is kept (and reused) between executions.
+  std::shared_ptr<TNQVMVisitor> getVisitor(bool in_clone);
+  // Concurrent execute calls on the same instance: the first one runs on this
+  // instance, the others run in their own execution context (an instance
+  // configured as this one, with its own visitor and execution info).
+  std::shared_ptr<TNQVM> createExecutionContext() const;
+  void executeInContext(const std::function<void(TNQVM &)> &in_execute);
+  // Lock (process-wide) the execution of the selected visitor if it is not
+  // thread-safe. Note: all ExaTN-based visitors share the (process-global)
+  // ExaTN runtime, hence their executions are serialized across all instances
+  // and execution contexts; concurrent calls only overlap the kernel
+  // preparation and the execution with thread-safe visitors.
+  std::unique_lock<std::mutex> lockVisitorExecution() const;
+  // Execution info of the current state of this instance.
+  HeterogeneousMap getCurrentExecutionInfo() const;
+  // Snapshot of the configuration.
+  Configuration getConfiguration() const;
+  // Set the visitor of the current execution (read by other threads).
+  void setVisitor(std::shared_ptr<TNQVMVisitor> in_visitor);
+  // Record the execution info of the calling thread's execution.
+  void recordExecutionInfo();
+  // Execute a kernel with the given visitor (into the given buffer).
+  void executeKernel(std::shared_ptr<TNQVMVisitor> in_visitor,
+                     std::shared_ptr<AcceleratorBuffer> buffer,
+                     std::shared_ptr<CompositeInstruction> kernel);
+  // Kernel transformations (visitor-specific and optional passes) before
+  // execution: returns the kernel to visit.
+  std::shared_ptr<CompositeInstruction>
+  prepareKernel(std::shared_ptr<AcceleratorBuffer> buffer,
+                std::shared_ptr<CompositeInstruction> kernel);
+  // Execute a prepared kernel with the given visitor (configured with the
+  // given options) into the given buffer.
+  // Safe to call concurrently with different visitors and buffers.
+  void visitKernel(std::shared_ptr<TNQVMVisitor> in_visitor,
+                   std::shared_ptr<AcceleratorBuffer> buffer,
+                   std::shared_ptr<CompositeInstruction> kernel,
+                   const HeterogeneousMap &in_options);
+  // Number of concurrent workers to execute independent kernels.
+  size_t getNumberOfKernelWorkers(size_t in_nbKernels) const;
+  // Execute independent kernels concurrently on a pool of visitor clones.
+  // Child buffers are appended in submission order.
+  void executeInParallel(
+      std::shared_ptr<AcceleratorBuffer> buffer,
+      const std::vector<std::shared_ptr<CompositeInstruction>> &functions,
+      size_t in_nbWorkers);
+  // Execute kernels into their buffers on a pool of visitor clones.
+  void executeOnWorkers(
+      const std::vector<std::shared_ptr<AcceleratorBuffer>> &buffers,
+      const std::vector<std::shared_ptr<CompositeInstruction>> &functions,
+      size_t in_nbWorkers);
+  // Execute the kernel as a product state of independent qubit clusters
+  // (connected components of the interaction graph), each one simulated on its
+  // own register (concurrently with 'parallel-kernels'). Exp-val-z is the
+  // product of the cluster values, shots are combined from the cluster shots.
+  // Returns false if the kernel cannot be factorized (e.g. single cluster),
+  // nothing is executed in that case.
+  bool executeByClusters(std::shared_ptr<AcceleratorBuffer> buffer,
+                         std::shared_ptr<CompositeInstruction> kernel);
+  // Can the kernels be executed with executeWithSharedPrefix? Otherwise, warns
+  // about the ignored 'shared-prefix' option.
+  bool canShareKernelPrefixes() const;
+  // Execute kernels (sharing a common prefix) by simulating each shared prefix
+  // only once, using visitor state snapshots at the branch points.
+  void executeWithSharedPrefix(
+      std::shared_ptr<AcceleratorBuffer> buffer,
+      const std::vector<std::shared_ptr<CompositeInstruction>> &functions);
+  // Kernel transformations required by the selected visitor.
+  void applyVisitorTransformations(std::shared_ptr<CompositeInstruction> kernel);
+  // VQE mode: evaluate each term on the backward light cone of its measured
+  // qubits only (gates outside the cone cancel out). Terms with the same cone
+  // share the reduced ansatz circuit.
+  std::vector<double> getExpectationValuesByLightCone(
+      std::shared_ptr<AcceleratorBuffer> buffer,
+      std::shared_ptr<CompositeInstruction> ansatz,
+      const std::vector<std::shared_ptr<CompositeInstruction>> &obsCircuits);
+  // tnqvm-visitor=auto: select the visitor backend for the kernels to execute
+  // (predicted fastest feasible one), the decision is added to the execution
+  // info. Returns the name of the selected backend.
+  std::string selectVisitorBackend(
+      const std::vector<std::shared_ptr<CompositeInstruction>> &functions);
+  // Run the execution function on a new accelerator instance (configured as
+  // this one) on a worker thread.
+  std::future<HeterogeneousMap>
+  submitAsync(std::function<void(TNQVM &)> in_execute,
+              std::shared_ptr<AcceleratorBuffer> buffer,
+              CompletionCallback callback);
+  // Optional (performance) kernel transformations, e.g. gate fusion.
+  // Returns the kernel to execute, statistics are added to the buffer (and
+  // accumulated in the execution info).
+  std::shared_ptr<CompositeInstruction>
+  applyOptimizationPasses(std::shared_ptr<AcceleratorBuffer> buffer,
+                          std::shared_ptr<CompositeInstruction> kernel);
 
 private:
   int __verbose = 1;
   bool executedOnce = false;
-  bool vqeMode = true;
-  // Default visitor backend is ITensor.
-  // TODO: we may eventually use our exatn as default.
-  static const std::string DEFAULT_VISITOR_BACKEND;
-  // The backend name that is configured.
-  // Initialized to the default.
-  std::string backendName = DEFAULT_VISITOR_BACKEND;
-  // Number of *shots* (randomized runs) requested.
-  // If not specified (i.e. left as -1), 
-  // then we don't return the binary measurement result (as a bit string).
-  // This is to make sure that on the XACC side, it can interpret the avarage-Z result correctly.
-  int nbShots = -1;
-  // Cache of the TNQVM options (to send on to the visitor)
-  HeterogeneousMap options;
+  Configuration configuration;
+  // Visitor instances kept between calls in warm mode (by backend name).
+  std::unordered_map<std::string, std::shared_ptr<TNQVMVisitor>> warmVisitors;
+  // Guards the configuration and warmVisitors against concurrent configuration
+  // updates, and the visitor member against concurrent reads.
+  mutable std::mutex configurationMutex;
+  // Copy of the configuration taken when the execution running on this
+  // instance started (incl. the backend selected for it): the execution path
+  // only reads this copy.
+  Configuration executionConfig;
+  // Accelerator-level execution info (of the last execution)
+  HeterogeneousMap executionInfo;
+  // Guards executionInfo updates from concurrent kernel executions
+  mutable std::mutex executionInfoMutex;
+  // Execution info of the last execution of each calling thread
+  std::unordered_map<std::thread::id, HeterogeneousMap> threadExecutionInfo;
+  // Held by the execution running on this instance (others run in their own
+  // execution context).
+  std::mutex executionMutex;
+  // This instance is the execution context of a call on another instance.
+  bool isExecutionContext = false;
+  // Worker threads of the asynchronous submissions (finished ones are joined
+  // on the next submission, the others on destruction).
+  struct AsyncWorker {
+    std::thread thread;
+    std::shared_ptr<std::atomic<bool>> isDone;
+  };
+  std::vector<AsyncWorker> asyncWorkers;
+  std::mutex asyncWorkersMutex;
 };
 } // namespace tnqvm
 
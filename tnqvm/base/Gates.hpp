@@ -33,6 +33,7 @@
 #include <array>
 #include <complex>
 #include <cassert>
+#include <vector>
 
 namespace tnqvm {
     // Enum of common quantum gates. 
@@ -129,7 +130,7 @@ namespace tnqvm {
     }
     
     template <> 
-    std::vector<std::vector<std::complex<double>>> GetGateMatrix<CommonGates::I>() {
+    inline std::vector<std::vector<std::complex<double>>> GetGateMatrix<CommonGates::I>() {
         return 
         {
             { 1.0, 0.0 },
@@ -138,7 +139,7 @@ namespace tnqvm {
     }
 
     template <> 
-    std::vector<std::vector<std::complex<double>>> GetGateMatrix<CommonGates::H>() {
+    inline std::vector<std::vector<std::complex<double>>> GetGateMatrix<CommonGates::H>() {
         return 
         {
             { M_SQRT1_2, M_SQRT1_2 },
@@ -147,7 +148,7 @@ namespace tnqvm {
     }
 
     template <> 
-    std::vector<std::vector<std::complex<double>>> GetGateMatrix<CommonGates::X>() {
+    inline std::vector<std::vector<std::complex<double>>> GetGateMatrix<CommonGates::X>() {
         return 
         {
             { 0.0, 1.0 },
@@ -156,7 +157,7 @@ namespace tnqvm {
     }
 
     template <> 
-    std::vector<std::vector<std::complex<double>>> GetGateMatrix<CommonGates::Y>() {
+    inline std::vector<std::vector<std::complex<double>>> GetGateMatrix<CommonGates::Y>() {
         return 
         {
             { 0.0, std::complex<double>(0, -1) },
@@ -165,7 +166,7 @@ namespace tnqvm {
     }
 
     template <> 
-    std::vector<std::vector<std::complex<double>>> GetGateMatrix<CommonGates::Z>() {
+    inline std::vector<std::vector<std::complex<double>>> GetGateMatrix<CommonGates::Z>() {
         return 
         {
             { 1.0, 0.0 },
@@ -175,7 +176,7 @@ namespace tnqvm {
 
     // Rx(theta) gate:
     template <> 
-    std::vector<std::vector<std::complex<double>>> GetGateMatrix<CommonGates::Rx>(double in_theta) {
+    inline std::vector<std::vector<std::complex<double>>> GetGateMatrix<CommonGates::Rx>(double in_theta) {
         return 
         {
             { std::cos(0.5 * in_theta), std::complex<double>(0, -1) * std::sin(0.5 * in_theta) },
@@ -185,7 +186,7 @@ namespace tnqvm {
 
     // Ry(theta) gate:
     template <> 
-    std::vector<std::vector<std::complex<double>>> GetGateMatrix<CommonGates::Ry>(double in_theta) {
+    inline std::vector<std::vector<std::complex<double>>> GetGateMatrix<CommonGates::Ry>(double in_theta) {
         return 
         {
             { std::cos(0.5 * in_theta), -std::sin(0.5 * in_theta) },
@@ -195,7 +196,7 @@ namespace tnqvm {
 
     // Rz(theta) gate:
     template <> 
-    std::vector<std::vector<std::complex<double>>> GetGateMatrix<CommonGates::Rz>(double in_theta) {
+    inline std::vector<std::vector<std::complex<double>>> GetGateMatrix<CommonGates::Rz>(double in_theta) {
         return 
         {
             { std::exp(std::complex<double>(0, -0.5 * in_theta)), 0.0 },
@@ -204,7 +205,7 @@ namespace tnqvm {
     }
 
     template <> 
-    std::vector<std::vector<std::complex<double>>> GetGateMatrix<CommonGates::T>() {
+    inline std::vector<std::vector<std::complex<double>>> GetGateMatrix<CommonGates::T>() {
         return 
         {
             { 1.0, 0.0 },
@@ -213,7 +214,7 @@ namespace tnqvm {
     }
 
     template <> 
-    std::vector<std::vector<std::complex<double>>> GetGateMatrix<CommonGates::Tdg>() {
+    inline std::vector<std::vector<std::complex<double>>> GetGateMatrix<CommonGates::Tdg>() {
         return 
         {
             { 1.0, 0.0 },
@@ -222,7 +223,7 @@ namespace tnqvm {
     }
 
     template <>
-    std::vector<std::vector<std::complex<double>>>
+    inline std::vector<std::vector<std::complex<double>>>
     GetGateMatrix<CommonGates::U>(double in_theta, double in_phi,
                                   double in_lambda) {
       return {
@@ -235,7 +236,7 @@ namespace tnqvm {
     }
 
     template <> 
-    std::vector<std::vector<std::complex<double>>> GetGateMatrix<CommonGates::CNOT>() {
+    inline std::vector<std::vector<std::complex<double>>> GetGateMatrix<CommonGates::CNOT>() {
         return 
         {
             { 1.0, 0.0, 0.0 , 0.0 },
@@ -246,7 +247,7 @@ namespace tnqvm {
     }
 
     template <> 
-    std::vector<std::vector<std::complex<double>>> GetGateMatrix<CommonGates::Swap>() {
+    inline std::vector<std::vector<std::complex<double>>> GetGateMatrix<CommonGates::Swap>() {
         return 
         {
             { 1.0, 0.0, 0.0 , 0.0 },
@@ -257,7 +258,7 @@ namespace tnqvm {
     }
 
     template <> 
-    std::vector<std::vector<std::complex<double>>> GetGateMatrix<CommonGates::iSwap>() {
+    inline std::vector<std::vector<std::complex<double>>> GetGateMatrix<CommonGates::iSwap>() {
         return 
         {
             { 1.0, 0.0, 0.0 , 0.0 },
@@ -268,7 +269,7 @@ namespace tnqvm {
     }
 
     template <> 
-    std::vector<std::vector<std::complex<double>>> GetGateMatrix<CommonGates::fSim>(double in_theta, double in_phi) {
+    inline std::vector<std::vector<std::complex<double>>> GetGateMatrix<CommonGates::fSim>(double in_theta, double in_phi) {
         return 
         {
             { 1.0, 0.0, 0.0 , 0.0 },
@@ -279,7 +280,82 @@ namespace tnqvm {
     }
 
     template <> 
-    std::vector<std::vector<std::complex<double>>> GetGateMatrix<CommonGates::Measure>() {
+    inline std::vector<std::vector<std::complex<double>>> GetGateMatrix<CommonGates::S>() {
+        return 
+        {
+            { 1.0, 0.0 },
+            { 0.0, std::complex<double>(0, 1) }
+        };    
+    }
+
+    template <> 
+    inline std::vector<std::vector<std::complex<double>>> GetGateMatrix<CommonGates::Sdg>() {
+        return 
+        {
+            { 1.0, 0.0 },
+            { 0.0, std::complex<double>(0, -1) }
+        };    
+    }
+
+    template <> 
+    inline std::vector<std::vector<std::complex<double>>> GetGateMatrix<CommonGates::CZ>() {
+        return 
+        {
+            { 1.0, 0.0, 0.0 , 0.0 },
+            { 0.0, 1.0, 0.0 , 0.0 },
+            { 0.0, 0.0, 1.0 , 0.0 },
+            { 0.0, 0.0, 0.0 , -1.0 }
+        };    
+    }
+
+    template <> 
+    inline std::vector<std::vector<std::complex<double>>> GetGateMatrix<CommonGates::CY>() {
+        return 
+        {
+            { 1.0, 0.0, 0.0 , 0.0 },
+            { 0.0, 1.0, 0.0 , 0.0 },
+            { 0.0, 0.0, 0.0 , std::complex<double>(0, -1) },
+            { 0.0, 0.0, std::complex<double>(0, 1), 0.0 }
+        };    
+    }
+
+    template <> 
+    inline std::vector<std::vector<std::complex<double>>> GetGateMatrix<CommonGates::CH>() {
+        return 
+        {
+            { 1.0, 0.0, 0.0 , 0.0 },
+            { 0.0, 1.0, 0.0 , 0.0 },
+            { 0.0, 0.0, M_SQRT1_2, M_SQRT1_2 },
+            { 0.0, 0.0, M_SQRT1_2, -M_SQRT1_2 }
+        };    
+    }
+
+    // CPhase(theta) gate:
+    template <> 
+    inline std::vector<std::vector<std::complex<double>>> GetGateMatrix<CommonGates::CPhase>(double in_theta) {
+        return 
+        {
+            { 1.0, 0.0, 0.0 , 0.0 },
+            { 0.0, 1.0, 0.0 , 0.0 },
+            { 0.0, 0.0, 1.0 , 0.0 },
+            { 0.0, 0.0, 0.0 , std::exp(std::complex<double>(0, in_theta)) }
+        };    
+    }
+
+    // CRZ(theta) gate:
+    template <> 
+    inline std::vector<std::vector<std::complex<double>>> GetGateMatrix<CommonGates::CRZ>(double in_theta) {
+        return 
+        {
+            { 1.0, 0.0, 0.0 , 0.0 },
+            { 0.0, 1.0, 0.0 , 0.0 },
+            { 0.0, 0.0, std::exp(std::complex<double>(0, -0.5 * in_theta)), 0.0 },
+            { 0.0, 0.0, 0.0 , std::exp(std::complex<double>(0, 0.5 * in_theta)) }
+        };    
+    }
+
+    template <> 
+    inline std::vector<std::vector<std::complex<double>>> GetGateMatrix<CommonGates::Measure>() {
         return {};    
     }
 }
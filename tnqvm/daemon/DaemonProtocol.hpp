@@ -0,0 +1,245 @@
+/***********************************************************************************
+ * Copyright (c) 2020, UT-Battelle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the xacc nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ **********************************************************************************/
+
+// Wire protocol of the TNQVM local daemon (Unix domain socket).
+// Header-only and independent of XACC so that clients only need this file and
+// the client library.
+//
+// A message is a set of string fields (key -> value). On the socket, each
+// message is a frame: its size (uint64_t, host byte order since both ends are
+// on the same host) followed by the encoded fields, each one as
+// "<key size>:<key><value size>:<value>".
+#pragma once
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace tnqvm {
+namespace daemon {
+using Message = std::map<std::string, std::string>;
+
+// Request fields
+// "command": "execute" (default), "ping" or "shutdown"
+constexpr const char *COMMAND_KEY = "command";
+// Kernel source code and the name of the XACC compiler to compile it with
+// (e.g. "xasm", or "staq" for OpenQASM).
+constexpr const char *SOURCE_KEY = "source";
+constexpr const char *COMPILER_KEY = "compiler";
+// Kernel to execute (optional if the source contains a single kernel)
+constexpr const char *KERNEL_KEY = "kernel";
+// Kernel parameter values (comma separated), if the kernel is parameterized
+constexpr const char *PARAMETERS_KEY = "parameters";
+// Register size (optional, default: qubits used by the kernel)
+constexpr const char *QUBITS_KEY = "qubits";
+// Accelerator options: "option:<type>:<name>", type is one of "int", "double",
+// "bool" ("true"/"false") or "string".
+constexpr const char *OPTION_KEY_PREFIX = "option:";
+
+// Response fields
+// "status": "ok" or "error" (with the error message in "error")
+constexpr const char *STATUS_KEY = "status";
+constexpr const char *ERROR_KEY = "error";
+// Measurement counts, one "<bit string>:<count>" per line
+constexpr const char *COUNTS_KEY = "counts";
+// Expectation value of the Z-string on the measured qubits (if any)
+constexpr const char *EXP_VAL_Z_KEY = "exp-val-z";
+// Visitor backend used for the execution
+constexpr const char *VISITOR_KEY = "visitor";
+
+// Frames larger than this are rejected (corrupted stream).
+constexpr uint64_t MAX_FRAME_SIZE = 1ULL << 30;
+
+// Socket path: $TNQVM_DAEMON_SOCKET if set, otherwise a per-user path in /tmp.
+inline std::string getDefaultSocketPath() {
+  if (const char *path = std::getenv("TNQVM_DAEMON_SOCKET")) {
+    return path;
+  }
+  return "/tmp/tnqvm-daemon-" + std::to_string(getuid()) + ".sock";
+}
+
+inline std::string makeOptionKey(const std::string &in_type,
+                                 const std::string &in_name) {
+  return OPTION_KEY_PREFIX + in_type + ":" + in_name;
+}
+
+// Split an option key into its type and name; returns false if the key is
+// not an option key.
+inline bool parseOptionKey(const std::string &in_key, std::string &out_type,
+                           std::string &out_name) {
+  const std::string prefix(OPTION_KEY_PREFIX);
+  if (in_key.compare(0, prefix.size(), prefix) != 0) {
+    return false;
+  }
+  const auto separator = in_key.find(':', prefix.size());
+  if (separator == std::string::npos) {
+    return false;
+  }
+  out_type = in_key.substr(prefix.size(), separator - prefix.size());
+  out_name = in_key.substr(separator + 1);
+  return !out_name.empty();
+}
+
+inline std::string encodeMessage(const Message &in_message) {
+  std::string result;
+  for (const auto &[key, value] : in_message) {
+    result.append(std::to_string(key.size())).append(":").append(key);
+    result.append(std::to_string(value.size())).append(":").append(value);
+  }
+  return result;
+}
+
+// Returns false if the data is not a valid encoded message.
+inline bool decodeMessage(const std::string &in_data, Message &out_message) {
+  out_message.clear();
+  size_t pos = 0;
+  const auto readString = [&](std::string &out_str) {
+    const auto separator = in_data.find(':', pos);
+    if (separator == std::string::npos || separator == pos ||
+        separator - pos > 19) {
+      return false;
+    }
+    size_t size = 0;
+    for (size_t i = pos; i < separator; ++i) {
+      if (in_data[i] < '0' || in_data[i] > '9') {
+        return false;
+      }
+      size = size * 10 + (in_data[i] - '0');
+    }
+    if (size > in_data.size() - separator - 1) {
+      return false;
+    }
+    out_str = in_data.substr(separator + 1, size);
+    pos = separator + 1 + size;
+    return true;
+  };
+  while (pos < in_data.size()) {
+    std::string key, value;
+    if (!readString(key) || !readString(value)) {
+      return false;
+    }
+    out_message[key] = std::move(value);
+  }
+  return true;
+}
+
+inline std::string
+encodeCounts(const std::map<std::string, int> &in_counts) {
+  std::string result;
+  for (const auto &[bitString, count] : in_counts) {
+    result.append(bitString).append(":").append(std::to_string(count));
+    result.push_back('\n');
+  }
+  return result;
+}
+
+inline bool decodeCounts(const std::string &in_data,
+                         std::map<std::string, int> &out_counts) {
+  out_counts.clear();
+  size_t pos = 0;
+  while (pos < in_data.size()) {
+    auto lineEnd = in_data.find('\n', pos);
+    if (lineEnd == std::string::npos) {
+      lineEnd = in_data.size();
+    }
+    const auto line = in_data.substr(pos, lineEnd - pos);
+    const auto separator = line.rfind(':');
+    if (separator == std::string::npos || separator + 1 == line.size()) {
+      return false;
+    }
+    char *end = nullptr;
+    const long count = std::strtol(line.c_str() + separator + 1, &end, 10);
+    if (*end != '\0' || count < 0) {
+      return false;
+    }
+    out_counts[line.substr(0, separator)] = count;
+    pos = lineEnd + 1;
+  }
+  return true;
+}
+
+namespace detail {
+inline bool writeAll(int in_fd, const char *in_data, size_t in_size) {
+  while (in_size > 0) {
+    // No SIGPIPE if the peer has closed the connection
+    const auto written = ::send(in_fd, in_data, in_size, MSG_NOSIGNAL);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    in_data += written;
+    in_size -= written;
+  }
+  return true;
+}
+
+inline bool readAll(int in_fd, char *out_data, size_t in_size) {
+  while (in_size > 0) {
+    const auto nbRead = ::read(in_fd, out_data, in_size);
+    if (nbRead < 0 && errno == EINTR) {
+      continue;
+    }
+    // Error or end of stream
+    if (nbRead <= 0) {
+      return false;
+    }
+    out_data += nbRead;
+    in_size -= nbRead;
+  }
+  return true;
+}
+} // namespace detail
+
+// Send a message frame; returns false if the connection is broken.
+inline bool writeMessage(int in_fd, const Message &in_message) {
+  const auto data = encodeMessage(in_message);
+  const uint64_t size = data.size();
+  return detail::writeAll(in_fd, reinterpret_cast<const char *>(&size),
+                          sizeof(size)) &&
+         detail::writeAll(in_fd, data.data(), data.size());
+}
+
+// Receive a message frame; returns false at the end of the stream or if the
+// frame is invalid.
+inline bool readMessage(int in_fd, Message &out_message) {
+  uint64_t size = 0;
+  if (!detail::readAll(in_fd, reinterpret_cast<char *>(&size), sizeof(size)) ||
+      size > MAX_FRAME_SIZE) {
+    return false;
+  }
+  std::string data(size, '\0');
+  return detail::readAll(in_fd, &data[0], size) &&
+         decodeMessage(data, out_message);
+}
+} // namespace daemon
+} // namespace tnqvm
@@ -0,0 +1,382 @@
+/***********************************************************************************
+ * Copyright (c) 2020, UT-Battelle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the xacc nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ **********************************************************************************/
+#include "DaemonServer.hpp"
+#include "TNQVM.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <sstream>
+#include <sys/un.h>
+#include <thread>
+#include <vector>
+
+namespace {
+// Z-basis measurement of a superposition: runs the whole visitor pipeline.
+const std::string WARM_UP_KERNEL = R"(__qpu__ void tnqvm_daemon_warm_up(qbit q) {
+  H(q[0]);
+  Measure(q[0]);
+})";
+
+// Max number of accelerator configurations kept warm.
+const size_t MAX_WARM_ACCELERATORS = 16;
+
+tnqvm::daemon::Message makeError(const std::string &in_message) {
+  return {{tnqvm::daemon::STATUS_KEY, "error"},
+          {tnqvm::daemon::ERROR_KEY, in_message}};
+}
+
+// Returns false (with the error message) if the option is invalid.
+bool parseOption(const std::string &in_type, const std::string &in_name,
+                 const std::string &in_value, xacc::HeterogeneousMap &io_options,
+                 std::string &out_error) {
+  try {
+    if (in_type == "int") {
+      io_options.insert(in_name, std::stoi(in_value));
+    } else if (in_type == "double") {
+      io_options.insert(in_name, std::stod(in_value));
+    } else if (in_type == "bool" && (in_value == "true" || in_value == "false")) {
+      io_options.insert(in_name, in_value == "true");
+    } else if (in_type == "string") {
+      io_options.insert(in_name, in_value);
+    } else {
+      out_error = "Invalid option '" + in_name + "' of type '" + in_type + "'.";
+      return false;
+    }
+  } catch (const std::exception &) {
+    out_error = "Invalid value of the '" + in_name + "' option: " + in_value;
+    return false;
+  }
+  return true;
+}
+
+// Returns false (with the error message) if TNQVM would reject the options
+// (xacc::error exits the process).
+bool validateOptions(const xacc::HeterogeneousMap &in_options,
+                     std::string &out_error) {
+  for (const std::string name : {"shots", "parallel-kernels"}) {
+    if (in_options.keyExists<int>(name) && in_options.get<int>(name) < 1) {
+      out_error = "Invalid value of the '" + name +
+                  "' option: " + std::to_string(in_options.get<int>(name));
+      return false;
+    }
+  }
+  return true;
+}
+} // namespace
+
+namespace tnqvm {
+DaemonServer::DaemonServer(const std::string &in_socketPath,
+                           const xacc::HeterogeneousMap &in_defaultOptions,
+                           size_t in_nbConnectionThreads)
+    : m_socketPath(in_socketPath), m_defaultOptions(in_defaultOptions),
+      m_nbConnectionThreads(std::max<size_t>(1, in_nbConnectionThreads)),
+      m_stopRequested(false) {}
+
+DaemonServer::~DaemonServer() {
+  if (m_listenSocket >= 0) {
+    ::close(m_listenSocket);
+    ::unlink(m_socketPath.c_str());
+  }
+}
+
+bool DaemonServer::listen() {
+  sockaddr_un address;
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (m_socketPath.size() >= sizeof(address.sun_path)) {
+    xacc::warning("TNQVM daemon socket path is too long: " + m_socketPath);
+    return false;
+  }
+  std::strncpy(address.sun_path, m_socketPath.c_str(),
+               sizeof(address.sun_path) - 1);
+  ::unlink(m_socketPath.c_str());
+  m_listenSocket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (m_listenSocket < 0 ||
+      ::bind(m_listenSocket, reinterpret_cast<sockaddr *>(&address),
+             sizeof(address)) != 0 ||
+      ::listen(m_listenSocket, SOMAXCONN) != 0) {
+    xacc::warning("Cannot listen on '" + m_socketPath +
+                  "': " + std::strerror(errno));
+    if (m_listenSocket >= 0) {
+      ::close(m_listenSocket);
+      m_listenSocket = -1;
+    }
+    return false;
+  }
+  return true;
+}
+
+void DaemonServer::run() {
+  assert(m_listenSocket >= 0);
+  std::vector<std::thread> connectionThreads;
+  for (size_t i = 0; i < m_nbConnectionThreads; ++i) {
+    connectionThreads.emplace_back(&DaemonServer::serveConnections, this);
+  }
+  while (!m_stopRequested) {
+    const int clientSocket = ::accept(m_listenSocket, nullptr, nullptr);
+    if (clientSocket < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) {
+        continue;
+      }
+      // The listening socket has been shut down (stop) or is broken.
+      break;
+    }
+    std::lock_guard<std::mutex> lock(m_connectionsMutex);
+    if (m_stopRequested) {
+      ::close(clientSocket);
+      break;
+    }
+    m_connections.emplace(clientSocket);
+    m_pendingConnections.push(clientSocket);
+    m_connectionAvailable.notify_one();
+  }
+  stop();
+  // Wait for the requests in progress.
+  for (auto &thread : connectionThreads) {
+    thread.join();
+  }
+  ::close(m_listenSocket);
+  m_listenSocket = -1;
+  ::unlink(m_socketPath.c_str());
+}
+
+void DaemonServer::stop() {
+  std::lock_guard<std::mutex> lock(m_connectionsMutex);
+  if (m_stopRequested.exchange(true)) {
+    return;
+  }
+  // Wake up the accept loop and the connections waiting for a request.
+  if (m_listenSocket >= 0) {
+    ::shutdown(m_listenSocket, SHUT_RDWR);
+  }
+  for (const auto &connection : m_connections) {
+    ::shutdown(connection, SHUT_RDWR);
+  }
+  m_connectionAvailable.notify_all();
+}
+
+void DaemonServer::serveConnections() {
+  for (;;) {
+    int clientSocket = -1;
+    {
+      std::unique_lock<std::mutex> lock(m_connectionsMutex);
+      m_connectionAvailable.wait(lock, [this]() {
+        return m_stopRequested || !m_pendingConnections.empty();
+      });
+      // On stop, the pending connections (already shut down) are still
+      // closed by the connection threads.
+      if (m_pendingConnections.empty()) {
+        return;
+      }
+      clientSocket = m_pendingConnections.front();
+      m_pendingConnections.pop();
+    }
+    serveConnection(clientSocket);
+  }
+}
+
+void DaemonServer::serveConnection(int in_socket) {
+  daemon::Message request;
+  while (daemon::readMessage(in_socket, request)) {
+    const auto response = handleRequest(request);
+    if (!daemon::writeMessage(in_socket, response)) {
+      break;
+    }
+    const auto commandIter = request.find(daemon::COMMAND_KEY);
+    if (commandIter != request.end() && commandIter->second == "shutdown") {
+      stop();
+      break;
+    }
+  }
+  std::lock_guard<std::mutex> lock(m_connectionsMutex);
+  m_connections.erase(in_socket);
+  ::close(in_socket);
+}
+
+void DaemonServer::warmUp() {
+  const auto response =
+      handleRequest({{daemon::SOURCE_KEY, WARM_UP_KERNEL},
+                     {daemon::COMPILER_KEY, "xasm"},
+                     {daemon::makeOptionKey("int", "shots"), "1"}});
+  if (response.at(daemon::STATUS_KEY) != "ok") {
+    xacc::warning("TNQVM daemon warm-up failed: " +
+                  response.at(daemon::ERROR_KEY));
+  }
+}
+
+daemon::Message DaemonServer::handleRequest(const daemon::Message &in_request) {
+  const auto commandIter = in_request.find(daemon::COMMAND_KEY);
+  const std::string command =
+      (commandIter != in_request.end()) ? commandIter->second : "execute";
+  if (command == "ping" || command == "shutdown") {
+    return {{daemon::STATUS_KEY, "ok"}};
+  }
+  if (command != "execute") {
+    return makeError("Unknown command '" + command + "'.");
+  }
+  try {
+    return execute(in_request);
+  } catch (const std::exception &ex) {
+    return makeError(ex.what());
+  }
+}
+
+daemon::Message DaemonServer::execute(const daemon::Message &in_request) {
+  const auto getField = [&in_request](const char *in_key) {
+    const auto iter = in_request.find(in_key);
+    return (iter != in_request.end()) ? iter->second : std::string();
+  };
+  const auto source = getField(daemon::SOURCE_KEY);
+  const auto compilerName = getField(daemon::COMPILER_KEY).empty()
+                                ? std::string("xasm")
+                                : getField(daemon::COMPILER_KEY);
+  if (source.empty()) {
+    return makeError("No kernel source code.");
+  }
+  if (!xacc::hasCompiler(compilerName)) {
+    return makeError("Unknown compiler '" + compilerName + "'.");
+  }
+  xacc::HeterogeneousMap requestOptions;
+  // Options of the request (sorted by key), identifying its accelerator.
+  std::string optionsKey;
+  for (const auto &[key, value] : in_request) {
+    std::string type, name, error;
+    if (daemon::parseOptionKey(key, type, name)) {
+      if (!parseOption(type, name, value, requestOptions, error)) {
+        return makeError(error);
+      }
+      optionsKey += key + "=" + value + "\n";
+    }
+  }
+  std::string optionsError;
+  if (!validateOptions(requestOptions, optionsError)) {
+    return makeError(optionsError);
+  }
+
+  std::shared_ptr<xacc::CompositeInstruction> kernel;
+  {
+    std::lock_guard<std::mutex> lock(m_compileMutex);
+    auto compiler = xacc::getCompiler(compilerName);
+    if (!compiler->canParse(source)) {
+      return makeError("Invalid kernel source code for the '" + compilerName +
+                       "' compiler.");
+    }
+    auto ir = compiler->compile(source);
+    const auto kernelName = getField(daemon::KERNEL_KEY);
+    for (const auto &composite : ir->getComposites()) {
+      if (kernelName.empty() || composite->name() == kernelName) {
+        if (kernel) {
+          return makeError("The source code contains multiple kernels, "
+                           "please specify the kernel to execute.");
+        }
+        kernel = composite;
+      }
+    }
+  }
+  if (!kernel) {
+    return makeError("Kernel not found.");
+  }
+  const auto parameterList = getField(daemon::PARAMETERS_KEY);
+  if (!parameterList.empty()) {
+    std::vector<double> parameters;
+    std::stringstream parameterStream(parameterList);
+    std::string parameter;
+    while (std::getline(parameterStream, parameter, ',')) {
+      parameters.emplace_back(std::stod(parameter));
+    }
+    kernel = kernel->operator()(parameters);
+  } else if (kernel->nVariables() > 0) {
+    return makeError("Kernel '" + kernel->name() +
+                     "' is parameterized, please specify the parameters.");
+  }
+
+  // Register size: qubits used by the kernel, unless specified.
+  int nbQubits = 0;
+  xacc::InstructionIterator it(kernel);
+  while (it.hasNext()) {
+    auto nextInst = it.next();
+    for (const auto &bit : nextInst->bits()) {
+      nbQubits = std::max(nbQubits, (int)bit + 1);
+    }
+  }
+  if (!getField(daemon::QUBITS_KEY).empty()) {
+    nbQubits = std::max(nbQubits, std::stoi(getField(daemon::QUBITS_KEY)));
+  }
+  if (nbQubits < 1) {
+    return makeError("The kernel doesn't act on any qubit.");
+  }
+
+  auto accelerator = getAccelerator(optionsKey, requestOptions);
+  auto buffer = std::make_shared<xacc::AcceleratorBuffer>("q", nbQubits);
+  accelerator->execute(buffer, kernel);
+
+  daemon::Message response{{daemon::STATUS_KEY, "ok"}};
+  const auto counts = buffer->getMeasurementCounts();
+  if (!counts.empty()) {
+    response[daemon::COUNTS_KEY] = daemon::encodeCounts(counts);
+  }
+  if (!counts.empty() || buffer->hasExtraInfoKey("exp-val-z")) {
+    std::ostringstream expValZ;
+    expValZ.precision(17);
+    expValZ << buffer->getExpectationValueZ();
+    response[daemon::EXP_VAL_Z_KEY] = expValZ.str();
+  }
+  const auto executionInfo = accelerator->getExecutionInfo();
+  if (executionInfo.stringExists("visitor")) {
+    response[daemon::VISITOR_KEY] = executionInfo.getString("visitor");
+  }
+  return response;
+}
+
+std::shared_ptr<TNQVM>
+DaemonServer::getAccelerator(const std::string &in_optionsKey,
+                             const xacc::HeterogeneousMap &in_requestOptions) {
+  std::lock_guard<std::mutex> lock(m_acceleratorsMutex);
+  const auto iter = m_accelerators.find(in_optionsKey);
+  if (iter != m_accelerators.end()) {
+    return iter->second;
+  }
+  if (m_accelerators.size() >= MAX_WARM_ACCELERATORS) {
+    // Requests in progress keep their accelerator alive.
+    m_accelerators.erase(m_accelerators.begin());
+  }
+  // Warm mode (unless disabled by the options): the visitor (and its backend
+  // resources) is reused by the next requests with the same options.
+  // Note: concurrent requests on the same accelerator run in their own
+  // execution context (see TNQVM::execute).
+  auto options = m_defaultOptions;
+  if (!options.keyExists<bool>("warm-mode")) {
+    options.insert("warm-mode", true);
+  }
+  auto accelerator = std::make_shared<TNQVM>();
+  accelerator->initialize(options);
+  accelerator->updateConfiguration(in_requestOptions);
+  m_accelerators.emplace(in_optionsKey, accelerator);
+  return accelerator;
+}
+} // namespace tnqvm
@@ -0,0 +1,103 @@
+/***********************************************************************************
+ * Copyright (c) 2020, UT-Battelle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the xacc nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ **********************************************************************************/
+
+// TNQVM local daemon: a long-running process keeping XACC (plugins) and the
+// visitor backends (e.g. the ExaTN runtime) initialized, which executes
+// kernels sent by clients (TNQVMClient) over a Unix domain socket.
+#pragma once
+#include "DaemonProtocol.hpp"
+#include "xacc.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <queue>
+#include <set>
+#include <string>
+
+namespace tnqvm {
+class TNQVM;
+
+class DaemonServer {
+public:
+  // in_defaultOptions: accelerator options of all requests (a request can
+  // override them).
+  // in_nbConnectionThreads: max number of connections served concurrently
+  // (a connection is served until the client disconnects; other clients wait
+  // for a free connection thread).
+  explicit DaemonServer(
+      const std::string &in_socketPath = daemon::getDefaultSocketPath(),
+      const xacc::HeterogeneousMap &in_defaultOptions = {},
+      size_t in_nbConnectionThreads = 8);
+  ~DaemonServer();
+
+  // Create the socket (a stale socket file at that path is replaced).
+  // Returns false if the socket cannot be created.
+  bool listen();
+  // Serve clients (on the pool of connection threads) until a shutdown request
+  // or a call to stop(). Returns when the requests in progress are completed
+  // and the connection threads are joined; the socket is removed.
+  void run();
+  void stop();
+  // Execute a kernel with the default options (e.g. to initialize the
+  // visitor backend before serving clients).
+  void warmUp();
+  // Handle a single request message.
+  // Note: the request (source code, options) is validated before reaching
+  // XACC, since errors reported by xacc::error exit the process.
+  daemon::Message handleRequest(const daemon::Message &in_request);
+
+private:
+  // Connection thread: serve the accepted connections until stop.
+  void serveConnections();
+  void serveConnection(int in_socket);
+  daemon::Message execute(const daemon::Message &in_request);
+  // Warm accelerator (warm-mode) configured with the default options and the
+  // given request options, created on first use.
+  std::shared_ptr<TNQVM>
+  getAccelerator(const std::string &in_optionsKey,
+                 const xacc::HeterogeneousMap &in_requestOptions);
+
+  std::string m_socketPath;
+  xacc::HeterogeneousMap m_defaultOptions;
+  size_t m_nbConnectionThreads;
+  int m_listenSocket = -1;
+  std::atomic<bool> m_stopRequested;
+  // Open client connections (closed on stop)
+  std::set<int> m_connections;
+  // Accepted connections waiting for a connection thread
+  std::queue<int> m_pendingConnections;
+  std::mutex m_connectionsMutex;
+  std::condition_variable m_connectionAvailable;
+  // XACC compilers are shared services: one compilation at a time.
+  std::mutex m_compileMutex;
+  // Accelerators by request options (bounded, see getAccelerator)
+  std::map<std::string, std::shared_ptr<TNQVM>> m_accelerators;
+  std::mutex m_acceleratorsMutex;
+};
+} // namespace tnqvm
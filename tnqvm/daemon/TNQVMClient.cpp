@@ -0,0 +1,155 @@
+/***********************************************************************************
+ * Copyright (c) 2020, UT-Battelle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the xacc nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ **********************************************************************************/
+#include "TNQVMClient.hpp"
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+namespace tnqvm {
+TNQVMClient::TNQVMClient(const std::string &in_socketPath)
+    : m_socketPath(in_socketPath) {}
+
+TNQVMClient::~TNQVMClient() { disconnect(); }
+
+void TNQVMClient::disconnect() {
+  if (m_socket >= 0) {
+    ::close(m_socket);
+    m_socket = -1;
+  }
+}
+
+daemon::Message TNQVMClient::sendRequest(const daemon::Message &in_request) {
+  if (m_socket < 0) {
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (m_socketPath.size() >= sizeof(address.sun_path)) {
+      throw std::runtime_error("TNQVM daemon socket path is too long: " +
+                               m_socketPath);
+    }
+    std::strncpy(address.sun_path, m_socketPath.c_str(),
+                 sizeof(address.sun_path) - 1);
+    m_socket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (m_socket < 0 ||
+        ::connect(m_socket, reinterpret_cast<sockaddr *>(&address),
+                  sizeof(address)) != 0) {
+      const std::string reason(std::strerror(errno));
+      disconnect();
+      throw std::runtime_error("Cannot connect to the TNQVM daemon at '" +
+                               m_socketPath + "': " + reason);
+    }
+  }
+
+  daemon::Message response;
+  if (!daemon::writeMessage(m_socket, in_request) ||
+      !daemon::readMessage(m_socket, response)) {
+    disconnect();
+    throw std::runtime_error("Lost connection to the TNQVM daemon at '" +
+                             m_socketPath + "'.");
+  }
+  const auto statusIter = response.find(daemon::STATUS_KEY);
+  if (statusIter == response.end() || statusIter->second != "ok") {
+    const auto errorIter = response.find(daemon::ERROR_KEY);
+    throw std::runtime_error(
+        "TNQVM daemon error: " +
+        (errorIter != response.end() ? errorIter->second : "unknown error"));
+  }
+  return response;
+}
+
+bool TNQVMClient::ping() {
+  try {
+    sendRequest({{daemon::COMMAND_KEY, "ping"}});
+    return true;
+  } catch (const std::runtime_error &) {
+    return false;
+  }
+}
+
+TNQVMClient::ExecutionResult
+TNQVMClient::execute(const std::string &in_source,
+                     const std::string &in_compiler,
+                     const std::map<std::string, OptionValue> &in_options,
+                     const std::string &in_kernelName,
+                     const std::vector<double> &in_parameters) {
+  daemon::Message request{{daemon::COMMAND_KEY, "execute"},
+                          {daemon::SOURCE_KEY, in_source},
+                          {daemon::COMPILER_KEY, in_compiler}};
+  if (!in_kernelName.empty()) {
+    request[daemon::KERNEL_KEY] = in_kernelName;
+  }
+  if (!in_parameters.empty()) {
+    std::ostringstream parameters;
+    parameters.precision(17);
+    for (size_t i = 0; i < in_parameters.size(); ++i) {
+      parameters << (i > 0 ? "," : "") << in_parameters[i];
+    }
+    request[daemon::PARAMETERS_KEY] = parameters.str();
+  }
+  for (const auto &[name, value] : in_options) {
+    if (const auto *intValue = std::get_if<int>(&value)) {
+      request[daemon::makeOptionKey("int", name)] = std::to_string(*intValue);
+    } else if (const auto *doubleValue = std::get_if<double>(&value)) {
+      std::ostringstream str;
+      str.precision(17);
+      str << *doubleValue;
+      request[daemon::makeOptionKey("double", name)] = str.str();
+    } else if (const auto *boolValue = std::get_if<bool>(&value)) {
+      request[daemon::makeOptionKey("bool", name)] =
+          *boolValue ? "true" : "false";
+    } else {
+      request[daemon::makeOptionKey("string", name)] =
+          std::get<std::string>(value);
+    }
+  }
+
+  const auto response = sendRequest(request);
+  ExecutionResult result;
+  const auto countsIter = response.find(daemon::COUNTS_KEY);
+  if (countsIter != response.end() &&
+      !daemon::decodeCounts(countsIter->second, result.counts)) {
+    throw std::runtime_error("Invalid measurement counts from the TNQVM daemon.");
+  }
+  const auto expValIter = response.find(daemon::EXP_VAL_Z_KEY);
+  if (expValIter != response.end()) {
+    result.expValZ = std::stod(expValIter->second);
+  }
+  const auto visitorIter = response.find(daemon::VISITOR_KEY);
+  if (visitorIter != response.end()) {
+    result.visitor = visitorIter->second;
+  }
+  return result;
+}
+
+void TNQVMClient::shutdown() {
+  sendRequest({{daemon::COMMAND_KEY, "shutdown"}});
+  disconnect();
+}
+} // namespace tnqvm
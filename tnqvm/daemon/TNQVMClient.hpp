@@ -0,0 +1,84 @@
+/***********************************************************************************
+ * Copyright (c) 2020, UT-Battelle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the xacc nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ **********************************************************************************/
+
+// Client of the TNQVM local daemon (tnqvm-daemon): executes kernels on a warm
+// accelerator in the daemon process, hence without paying the XACC/ExaTN
+// start-up cost in the calling process. No XACC dependency.
+#pragma once
+#include "DaemonProtocol.hpp"
+#include <map>
+#include <optional>
+#include <string>
+#include <variant>
+#include <vector>
+
+namespace tnqvm {
+class TNQVMClient {
+public:
+  // Accelerator option value (e.g. "shots", "tnqvm-visitor").
+  using OptionValue = std::variant<int, double, bool, std::string>;
+  struct ExecutionResult {
+    // Measurement counts (shots)
+    std::map<std::string, int> counts;
+    // Expectation value of the Z-string on the measured qubits (if any)
+    std::optional<double> expValZ;
+    // Visitor backend which executed the kernel
+    std::string visitor;
+  };
+
+  // The connection is opened on the first request and kept for the lifetime
+  // of the client.
+  explicit TNQVMClient(
+      const std::string &in_socketPath = daemon::getDefaultSocketPath());
+  ~TNQVMClient();
+  TNQVMClient(const TNQVMClient &) = delete;
+  TNQVMClient &operator=(const TNQVMClient &) = delete;
+
+  // Returns true if the daemon is up and answering.
+  bool ping();
+  // Compile the source code (with the given XACC compiler, e.g. "xasm", or
+  // "staq" for OpenQASM) and execute the kernel in the daemon.
+  // The kernel name can be omitted if the source contains a single kernel.
+  // Throws std::runtime_error if the daemon cannot be reached or reports an
+  // error.
+  ExecutionResult
+  execute(const std::string &in_source, const std::string &in_compiler = "xasm",
+          const std::map<std::string, OptionValue> &in_options = {},
+          const std::string &in_kernelName = "",
+          const std::vector<double> &in_parameters = {});
+  // Ask the daemon to exit (after the requests in progress).
+  void shutdown();
+
+private:
+  daemon::Message sendRequest(const daemon::Message &in_request);
+  void disconnect();
+
+  std::string m_socketPath;
+  int m_socket = -1;
+};
+} // namespace tnqvm
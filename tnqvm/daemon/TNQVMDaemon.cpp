@@ -0,0 +1,90 @@
+/***********************************************************************************
+ * Copyright (c) 2020, UT-Battelle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the xacc nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ **********************************************************************************/
+// tnqvm-daemon: serve TNQVM executions on a local Unix domain socket.
+// Usage: tnqvm-daemon [--socket <path>] [--visitor <name>] [--no-warm-up]
+// The socket path defaults to $TNQVM_DAEMON_SOCKET or /tmp/tnqvm-daemon-<uid>.sock
+#include "DaemonServer.hpp"
+#include <csignal>
+#include <iostream>
+#include <pthread.h>
+#include <thread>
+
+int main(int argc, char **argv) {
+  std::string socketPath = tnqvm::daemon::getDefaultSocketPath();
+  std::string visitorName;
+  bool warmUp = true;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg(argv[i]);
+    if (arg == "--socket" && i + 1 < argc) {
+      socketPath = argv[++i];
+    } else if (arg == "--visitor" && i + 1 < argc) {
+      visitorName = argv[++i];
+    } else if (arg == "--no-warm-up") {
+      warmUp = false;
+    } else if (arg == "--help") {
+      std::cout << "Usage: " << argv[0]
+                << " [--socket <path>] [--visitor <name>] [--no-warm-up]\n";
+      return 0;
+    }
+  }
+
+  // SIGINT/SIGTERM are handled by a dedicated thread (blocked in all others).
+  sigset_t stopSignals;
+  sigemptyset(&stopSignals);
+  sigaddset(&stopSignals, SIGINT);
+  sigaddset(&stopSignals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &stopSignals, nullptr);
+
+  xacc::Initialize(argc, argv);
+  xacc::HeterogeneousMap defaultOptions;
+  if (!visitorName.empty()) {
+    defaultOptions.insert("tnqvm-visitor", visitorName);
+  }
+  int exitCode = 0;
+  {
+    auto server =
+        std::make_shared<tnqvm::DaemonServer>(socketPath, defaultOptions);
+    if (!server->listen()) {
+      exitCode = 1;
+    } else {
+      if (warmUp) {
+        // Pay the backend initialization cost before serving clients.
+        server->warmUp();
+      }
+      std::thread([server, stopSignals]() {
+        int signal = 0;
+        sigwait(&stopSignals, &signal);
+        server->stop();
+      }).detach();
+      xacc::info("TNQVM daemon listening on " + socketPath);
+      server->run();
+    }
+  }
+  xacc::Finalize();
+  return exitCode;
+}
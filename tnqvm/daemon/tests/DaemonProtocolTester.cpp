@@ -0,0 +1,88 @@
+/***********************************************************************************
+ * Copyright (c) 2020, UT-Battelle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the xacc nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ **********************************************************************************/
+#include <gtest/gtest.h>
+#include "DaemonProtocol.hpp"
+#include <sys/socket.h>
+#include <thread>
+
+using namespace tnqvm;
+
+TEST(DaemonProtocolTester, checkEncodeDecode) {
+  const daemon::Message message{
+      {"source", "__qpu__ void f(qbit q) {\n  H(q[0]);\n}"},
+      {"empty", ""},
+      {"option:int:shots", "1024"},
+      {"a:b", "1:2"}};
+  daemon::Message decoded;
+  EXPECT_TRUE(daemon::decodeMessage(daemon::encodeMessage(message), decoded));
+  EXPECT_EQ(decoded, message);
+  EXPECT_TRUE(daemon::decodeMessage("", decoded));
+  EXPECT_TRUE(decoded.empty());
+  // Truncated or malformed data
+  EXPECT_FALSE(daemon::decodeMessage("3:key5:val", decoded));
+  EXPECT_FALSE(daemon::decodeMessage("3:key", decoded));
+  EXPECT_FALSE(daemon::decodeMessage("x:key1:v", decoded));
+}
+
+TEST(DaemonProtocolTester, checkCountsAndOptions) {
+  const std::map<std::string, int> counts{{"00", 510}, {"11", 514}};
+  std::map<std::string, int> decoded;
+  EXPECT_TRUE(daemon::decodeCounts(daemon::encodeCounts(counts), decoded));
+  EXPECT_EQ(decoded, counts);
+  EXPECT_FALSE(daemon::decodeCounts("01:x\n", decoded));
+
+  std::string type, name;
+  EXPECT_TRUE(daemon::parseOptionKey(daemon::makeOptionKey("string", "tnqvm-visitor"),
+                                     type, name));
+  EXPECT_EQ(type, "string");
+  EXPECT_EQ(name, "tnqvm-visitor");
+  EXPECT_FALSE(daemon::parseOptionKey("source", type, name));
+  EXPECT_FALSE(daemon::parseOptionKey("option:int", type, name));
+}
+
+TEST(DaemonProtocolTester, checkFrames) {
+  int sockets[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sockets), 0);
+  const daemon::Message first{{"command", "ping"}};
+  const daemon::Message second{{"source", std::string(1 << 20, 'x')}};
+  // Large frames need a concurrent reader.
+  std::thread writer([&]() {
+    EXPECT_TRUE(daemon::writeMessage(sockets[0], first));
+    EXPECT_TRUE(daemon::writeMessage(sockets[0], second));
+    close(sockets[0]);
+  });
+  daemon::Message received;
+  EXPECT_TRUE(daemon::readMessage(sockets[1], received));
+  EXPECT_EQ(received, first);
+  EXPECT_TRUE(daemon::readMessage(sockets[1], received));
+  EXPECT_EQ(received, second);
+  writer.join();
+  // End of stream
+  EXPECT_FALSE(daemon::readMessage(sockets[1], received));
+  close(sockets[1]);
+}
@@ -0,0 +1,139 @@
+/***********************************************************************************
+ * Copyright (c) 2020, UT-Battelle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the xacc nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ **********************************************************************************/
+#include <gtest/gtest.h>
+#include "DaemonServer.hpp"
+#include "TNQVMClient.hpp"
+#include <cmath>
+#include <thread>
+
+using namespace tnqvm;
+
+namespace {
+const std::string SOCKET_PATH =
+    "/tmp/tnqvm-daemon-test-" + std::to_string(getpid()) + ".sock";
+
+// Daemon serving on a background thread (stopped on test failures too).
+struct TestDaemon {
+  TestDaemon() : server(SOCKET_PATH) {
+    if (server.listen()) {
+      serverThread = std::thread([this]() { server.run(); });
+    }
+  }
+  ~TestDaemon() {
+    server.stop();
+    if (serverThread.joinable()) {
+      serverThread.join();
+    }
+  }
+  DaemonServer server;
+  std::thread serverThread;
+};
+} // namespace
+
+TEST(TNQVMDaemonTester, checkExecute) {
+  TestDaemon daemon;
+  ASSERT_TRUE(daemon.serverThread.joinable());
+
+  TNQVMClient client(SOCKET_PATH);
+  EXPECT_TRUE(client.ping());
+  const std::string source = R"(__qpu__ void daemon_ry(qbit q, double theta) {
+      Ry(q[0], theta);
+      CX(q[0], q[1]);
+      Measure(q[1]);
+    })";
+  // <Z1> = cos(theta), several requests on the same (warm) daemon
+  for (const double theta : {0.0, 0.5, 1.5}) {
+    const auto result = client.execute(source, "xasm", {}, "", {theta});
+    EXPECT_NEAR(result.expValZ.value_or(0.0), std::cos(theta), 1e-6);
+    EXPECT_EQ(result.visitor, "itensor-mps");
+  }
+  // Errors are reported to the client, the daemon keeps serving.
+  EXPECT_THROW(client.execute(source, "xasm"), std::runtime_error);
+  EXPECT_THROW(client.execute(source, "no-such-compiler", {}, "", {0.1}),
+               std::runtime_error);
+  EXPECT_THROW(client.execute(source, "xasm", {}, "no_such_kernel", {0.1}),
+               std::runtime_error);
+  // Concurrent clients
+  std::vector<std::thread> clientThreads;
+  std::vector<double> results(4, 0.0);
+  for (size_t i = 0; i < results.size(); ++i) {
+    clientThreads.emplace_back([&, i]() {
+      TNQVMClient threadClient(SOCKET_PATH);
+      results[i] =
+          threadClient.execute(source, "xasm", {}, "daemon_ry", {0.25 * i})
+              .expValZ.value_or(0.0);
+    });
+  }
+  for (auto &thread : clientThreads) {
+    thread.join();
+  }
+  for (size_t i = 0; i < results.size(); ++i) {
+    EXPECT_NEAR(results[i], std::cos(0.25 * i), 1e-6);
+  }
+
+  client.shutdown();
+  daemon.serverThread.join();
+  EXPECT_FALSE(TNQVMClient(SOCKET_PATH).ping());
+}
+
+TEST(TNQVMDaemonTester, checkInvalidRequests) {
+  TestDaemon daemon;
+  ASSERT_TRUE(daemon.serverThread.joinable());
+
+  TNQVMClient client(SOCKET_PATH);
+  // Requests which XACC/TNQVM would reject (xacc::error exits the process) are
+  // rejected by the daemon, which keeps serving.
+  const std::string malformedSource = R"(__qpu__ void daemon_bad(qbit q) {
+      H(q[0];
+      Measure(q[0]);
+    })";
+  EXPECT_THROW(client.execute(malformedSource, "xasm"), std::runtime_error);
+  EXPECT_TRUE(client.ping());
+  const std::string source = R"(__qpu__ void daemon_x(qbit q) {
+      X(q[0]);
+      Measure(q[0]);
+    })";
+  EXPECT_THROW(client.execute(source, "xasm", {{"parallel-kernels", 0}}),
+               std::runtime_error);
+  EXPECT_THROW(client.execute(source, "xasm", {{"shots", -1}}),
+               std::runtime_error);
+  EXPECT_TRUE(client.ping());
+  EXPECT_NEAR(client.execute(source, "xasm").expValZ.value_or(0.0), -1.0,
+              1e-6);
+
+  client.shutdown();
+  daemon.serverThread.join();
+}
+
+int main(int argc, char **argv) {
+  xacc::Initialize(argc, argv);
+  ::testing::InitGoogleTest(&argc, argv);
+  auto ret = RUN_ALL_TESTS();
+  xacc::Finalize();
+  return ret;
+}
@@ -33,6 +33,10 @@
 #include "xacc.hpp"
 #include "xacc_service.hpp"
 #include <random>
+#include <cstdlib>
+#include <algorithm>
+#include <dirent.h>
+#include <fstream>
 namespace {
 inline double generateRandomProbability() {
   auto randFunc =
@@ -209,6 +213,261 @@ TEST(ExatnExpValSumReduceTester, testDeuteronH3) {
   }
 }
 
+TEST(ExatnExpValSumReduceTester, testSliceLanes) {
+  auto xasmCompiler = xacc::getCompiler("xasm");
+  auto ir = xasmCompiler->compile(R"(__qpu__ void lanes_test(qbit q) {
+      Ry(q[0], 0.3);
+      Ry(q[1], 0.7);
+      Rx(q[2], 1.1);
+      H(q[3]);
+      CX(q[0], q[1]);
+      CX(q[1], q[2]);
+      CZ(q[2], q[3]);
+      Ry(q[3], 0.5);
+      Measure(q[0]);
+      Measure(q[2]);
+      Measure(q[3]);
+    })");
+  auto program = ir->getComposite("lanes_test");
+  // Reference: full wave function
+  auto refBuffer = xacc::qalloc(4);
+  xacc::getAccelerator("tnqvm", {{"tnqvm-visitor", "exatn"}})
+      ->execute(refBuffer, program);
+
+  for (int nbLanes : {1, 2, 4}) {
+    auto accelerator = xacc::getAccelerator(
+        "tnqvm", {{"tnqvm-visitor", "exatn"},
+                  {"max-qubit", 3},
+                  {"exatn-slice-lanes", nbLanes}});
+    auto buffer = xacc::qalloc(4);
+    accelerator->execute(buffer, program);
+    EXPECT_NEAR(buffer->getExpectationValueZ(),
+                refBuffer->getExpectationValueZ(), 1e-6);
+    // Each doubling of the number of lanes projects one more qubit.
+    EXPECT_EQ(accelerator->getExecutionInfo().get<int>("exatn-slices"),
+              2 * nbLanes);
+  }
+}
+
+TEST(ExatnExpValSumReduceTester, testCostSliceSelection) {
+  auto xasmCompiler = xacc::getCompiler("xasm");
+  auto ir = xasmCompiler->compile(R"(__qpu__ void cost_slice_test(qbit q) {
+      H(q[0]);
+      Ry(q[1], 0.7);
+      Rx(q[2], 1.1);
+      Ry(q[3], 0.4);
+      Rx(q[4], 0.9);
+      CX(q[0], q[1]);
+      CX(q[1], q[2]);
+      CX(q[2], q[3]);
+      CX(q[3], q[4]);
+      Ry(q[2], 0.5);
+      CZ(q[0], q[4]);
+      Measure(q[0]);
+      Measure(q[2]);
+      Measure(q[4]);
+    })");
+  auto program = ir->getComposite("cost_slice_test");
+  // Reference: full wave function
+  auto refBuffer = xacc::qalloc(5);
+  xacc::getAccelerator("tnqvm", {{"tnqvm-visitor", "exatn"}})
+      ->execute(refBuffer, program);
+
+  // Evaluating a single candidate per step (evenly spaced subset) or all of
+  // them must give a valid plan.
+  for (int nbCandidates : {1, 16}) {
+    for (int maxQubit : {2, 3}) {
+      auto accelerator = xacc::getAccelerator(
+          "tnqvm", {{"tnqvm-visitor", "exatn"},
+                    {"max-qubit", maxQubit},
+                    {"exatn-slice-selection", "cost"},
+                    {"exatn-slice-candidates", nbCandidates}});
+      auto buffer = xacc::qalloc(5);
+      accelerator->execute(buffer, program);
+      EXPECT_NEAR(buffer->getExpectationValueZ(),
+                  refBuffer->getExpectationValueZ(), 1e-6);
+      const auto info = accelerator->getExecutionInfo();
+      // At least (5 - maxQubit) qubits are projected.
+      EXPECT_GE(info.get<int>("exatn-sliced-qubits"), 5 - maxQubit);
+      EXPECT_EQ(info.get<int>("exatn-slices"),
+                1 << (info.get<int>("exatn-sliced-qubits") +
+                      info.get<int>("exatn-sliced-bonds")));
+    }
+  }
+}
+
+TEST(ExatnExpValSumReduceTester, testMemoryBudget) {
+  auto xasmCompiler = xacc::getCompiler("xasm");
+  auto ir = xasmCompiler->compile(R"(__qpu__ void budget_test(qbit q) {
+      H(q[0]);
+      Ry(q[1], 0.7);
+      Rx(q[2], 1.1);
+      CX(q[0], q[1]);
+      CX(q[1], q[2]);
+      CZ(q[2], q[3]);
+      Ry(q[3], 0.5);
+      Measure(q[0]);
+      Measure(q[3]);
+    })");
+  auto program = ir->getComposite("budget_test");
+  // Reference: full wave function
+  auto refBuffer = xacc::qalloc(4);
+  xacc::getAccelerator("tnqvm", {{"tnqvm-visitor", "exatn"}})
+      ->execute(refBuffer, program);
+
+  // The method is selected from the cost estimates, for any budget (MB).
+  for (int memoryBudget : {1, 1024}) {
+    auto accelerator = xacc::getAccelerator(
+        "tnqvm",
+        {{"tnqvm-visitor", "exatn"}, {"memory-budget", memoryBudget}});
+    auto buffer = xacc::qalloc(4);
+    accelerator->execute(buffer, program);
+    EXPECT_NEAR(buffer->getExpectationValueZ(),
+                refBuffer->getExpectationValueZ(), 1e-6);
+    const auto strategy = accelerator->getExecutionInfo().getString(
+        "exp-val-strategy");
+    EXPECT_TRUE(strategy == "direct" || strategy == "slicing" ||
+                strategy == "conjugate");
+    EXPECT_LE(accelerator->getExecutionInfo().get<double>(
+                  "exp-val-estimated-bytes"),
+              memoryBudget * (1 << 20));
+  }
+}
+
+TEST(ExatnExpValSumReduceTester, testContractionSequenceCache) {
+  auto xasmCompiler = xacc::getCompiler("xasm");
+  auto ir = xasmCompiler->compile(R"(__qpu__ void seq_cache_test(qbit q, double theta) {
+      H(q[0]);
+      Ry(q[1], theta);
+      Rx(q[2], 1.1);
+      CX(q[0], q[1]);
+      CX(q[1], q[2]);
+      CZ(q[2], q[3]);
+      Ry(q[3], theta);
+      Measure(q[0]);
+      Measure(q[3]);
+    })");
+  auto program = ir->getComposite("seq_cache_test");
+  char dirTemplate[] = "/tmp/tnqvm_seq_cacheXXXXXX";
+  const std::string cacheDir = ::mkdtemp(dirTemplate);
+
+  // Same circuit topology, different parameters: the second run only uses the
+  // sequences persisted by the first one.
+  const std::vector<double> angles{0.7, -1.3};
+  for (size_t i = 0; i < angles.size(); ++i) {
+    auto circuit = program->operator()({angles[i]});
+    auto refBuffer = xacc::qalloc(4);
+    xacc::getAccelerator("tnqvm", {{"tnqvm-visitor", "exatn"}})
+        ->execute(refBuffer, circuit);
+    auto accelerator = xacc::getAccelerator(
+        "tnqvm", {{"tnqvm-visitor", "exatn"},
+                  {"max-qubit", 3},
+                  {"exatn-contract-seq-cache-dir", cacheDir}});
+    auto buffer = xacc::qalloc(4);
+    accelerator->execute(buffer, circuit);
+    EXPECT_NEAR(buffer->getExpectationValueZ(),
+                refBuffer->getExpectationValueZ(), 1e-6);
+    const auto info = accelerator->getExecutionInfo();
+    if (i == 0) {
+      EXPECT_GT(info.get<int>("exatn-contract-seq-cache-misses"), 0);
+    } else {
+      EXPECT_EQ(info.get<int>("exatn-contract-seq-cache-misses"), 0);
+      EXPECT_GT(info.get<int>("exatn-contract-seq-cache-hits"), 0);
+    }
+  }
+
+  // One complete file per sequence, no temporary file left behind.
+  std::vector<std::string> cacheFiles;
+  DIR *dir = ::opendir(cacheDir.c_str());
+  ASSERT_TRUE(dir != nullptr);
+  while (const auto *entry = ::readdir(dir)) {
+    const std::string fileName = entry->d_name;
+    if (fileName != "." && fileName != "..") {
+      cacheFiles.emplace_back(cacheDir + "/" + fileName);
+    }
+  }
+  ::closedir(dir);
+  EXPECT_FALSE(cacheFiles.empty());
+  for (const auto &filePath : cacheFiles) {
+    EXPECT_EQ(filePath.substr(filePath.size() - 4), ".seq");
+    std::ifstream file(filePath);
+    std::string header;
+    std::getline(file, header);
+    EXPECT_EQ(header, "tnqvm-contraction-sequence 1");
+  }
+
+  // Corrupted cache files are not used: the sequences are searched again.
+  for (const auto &filePath : cacheFiles) {
+    std::ofstream file(filePath, std::ios::trunc);
+    file << "tnqvm-contraction-sequence 1\n0\n1.0\n1 2 3\n";
+  }
+  auto circuit = program->operator()({angles[0]});
+  auto refBuffer = xacc::qalloc(4);
+  xacc::getAccelerator("tnqvm", {{"tnqvm-visitor", "exatn"}})
+      ->execute(refBuffer, circuit);
+  auto accelerator = xacc::getAccelerator(
+      "tnqvm", {{"tnqvm-visitor", "exatn"},
+                {"max-qubit", 3},
+                {"exatn-contract-seq-cache-dir", cacheDir}});
+  auto buffer = xacc::qalloc(4);
+  accelerator->execute(buffer, circuit);
+  EXPECT_NEAR(buffer->getExpectationValueZ(),
+              refBuffer->getExpectationValueZ(), 1e-6);
+}
+
+TEST(ExatnExpValSumReduceTester, testContractionSequencePortfolio) {
+  auto xasmCompiler = xacc::getCompiler("xasm");
+  auto ir = xasmCompiler->compile(R"(__qpu__ void seq_portfolio_test(qbit q) {
+      H(q[0]);
+      Ry(q[1], 0.7);
+      Rx(q[2], 1.1);
+      CX(q[0], q[1]);
+      CX(q[1], q[2]);
+      CZ(q[2], q[3]);
+      Ry(q[3], 0.5);
+      CX(q[3], q[0]);
+      Measure(q[0]);
+      Measure(q[3]);
+    })");
+  auto program = ir->getComposite("seq_portfolio_test");
+  auto refBuffer = xacc::qalloc(4);
+  xacc::getAccelerator("tnqvm", {{"tnqvm-visitor", "exatn"}})
+      ->execute(refBuffer, program);
+
+  const std::vector<std::string> optimizers{"metis", "greed", "heuro"};
+  auto accelerator = xacc::getAccelerator(
+      "tnqvm", {{"tnqvm-visitor", "exatn"},
+                {"max-qubit", 3},
+                {"exatn-contract-seq-portfolio", std::string("metis,greed,heuro")},
+                {"exatn-contract-seq-timeout", 1.0},
+                {"exatn-contract-seq-restarts", 2}});
+  auto buffer = xacc::qalloc(4);
+  accelerator->execute(buffer, program);
+  EXPECT_NEAR(buffer->getExpectationValueZ(),
+              refBuffer->getExpectationValueZ(), 1e-6);
+  const auto info = accelerator->getExecutionInfo();
+  const auto winner = info.getString("exatn-contract-seq-winner");
+  EXPECT_TRUE(std::find(optimizers.begin(), optimizers.end(), winner) !=
+              optimizers.end());
+  EXPECT_GT(info.get<double>("exatn-contract-seq-flops"), 0.0);
+  EXPECT_LT(info.get<int>("exatn-contract-seq-restart"), 2);
+
+  // No time left: only the first run of each optimizer.
+  auto noTimeAccelerator = xacc::getAccelerator(
+      "tnqvm", {{"tnqvm-visitor", "exatn"},
+                {"max-qubit", 3},
+                {"exatn-contract-seq-portfolio", std::string("metis,greed,heuro")},
+                {"exatn-contract-seq-timeout", 0.0},
+                {"exatn-contract-seq-restarts", 3}});
+  auto noTimeBuffer = xacc::qalloc(4);
+  noTimeAccelerator->execute(noTimeBuffer, program);
+  EXPECT_NEAR(noTimeBuffer->getExpectationValueZ(),
+              refBuffer->getExpectationValueZ(), 1e-6);
+  EXPECT_EQ(noTimeAccelerator->getExecutionInfo().get<int>(
+                "exatn-contract-seq-restart"),
+            0);
+}
+
 int main(int argc, char **argv) {
   xacc::Initialize();
   ::testing::InitGoogleTest(&argc, argv);
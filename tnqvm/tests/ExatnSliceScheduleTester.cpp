@@ -0,0 +1,86 @@
+/***********************************************************************************
+ * Copyright (c) 2017, UT-Battelle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the xacc nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Contributors:
+ *   Initial API and implementation - Alex McCaskey
+ *
+ **********************************************************************************/
+#include <memory>
+#include <numeric>
+#include <gtest/gtest.h>
+#include "xacc.hpp"
+#include "xacc_service.hpp"
+
+// This unit test is executed with mpiexec: exp-val-z slices are only
+// scheduled across processes.
+TEST(ExatnSliceScheduleTester, testSliceSchedules) {
+  auto xasmCompiler = xacc::getCompiler("xasm");
+  auto ir = xasmCompiler->compile(R"(__qpu__ void schedule_test(qbit q) {
+      Ry(q[0], 0.3);
+      Ry(q[1], 0.7);
+      Rx(q[2], 1.1);
+      H(q[3]);
+      Ry(q[4], 0.9);
+      CX(q[0], q[1]);
+      CX(q[1], q[2]);
+      CZ(q[2], q[3]);
+      CX(q[3], q[4]);
+      Ry(q[3], 0.5);
+      Measure(q[0]);
+      Measure(q[2]);
+      Measure(q[4]);
+    })");
+  auto program = ir->getComposite("schedule_test");
+  // Reference: full wave function
+  auto refBuffer = xacc::qalloc(5);
+  xacc::getAccelerator("tnqvm", {{"tnqvm-visitor", "exatn"}})
+      ->execute(refBuffer, program);
+
+  for (const std::string schedule : {"static", "dynamic"}) {
+    auto accelerator = xacc::getAccelerator(
+        "tnqvm", {{"tnqvm-visitor", "exatn"},
+                  {"max-qubit", 2},
+                  {"exatn-slice-schedule", schedule}});
+    auto buffer = xacc::qalloc(5);
+    accelerator->execute(buffer, program);
+    EXPECT_NEAR(buffer->getExpectationValueZ(),
+                refBuffer->getExpectationValueZ(), 1e-6);
+    const auto info = accelerator->getExecutionInfo();
+    EXPECT_EQ(info.getString("exatn-slice-schedule"), schedule);
+    // Every slice is evaluated by exactly one process.
+    const auto rankSlices = info.get<std::vector<int>>("exatn-rank-slices");
+    EXPECT_EQ(std::accumulate(rankSlices.begin(), rankSlices.end(), 0),
+              info.get<int>("exatn-slices"));
+  }
+}
+
+int main(int argc, char **argv) {
+  xacc::Initialize();
+  ::testing::InitGoogleTest(&argc, argv);
+  auto ret = RUN_ALL_TESTS();
+  xacc::Finalize();
+  return ret;
+}
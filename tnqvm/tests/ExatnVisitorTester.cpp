@@ -257,6 +257,62 @@ TEST(ExatnVisitorTester, checkDeuteuron) {
   }
 }
 
+TEST(ExatnVisitorTester, checkInstructionTape) {
+  auto accelerator = xacc::getAccelerator("tnqvm", {std::make_pair("tnqvm-visitor", "exatn")});
+  auto tnqvmAcc = std::static_pointer_cast<tnqvm::TNQVM>(accelerator);
+  auto xasmCompiler = xacc::getCompiler("xasm");
+  auto ir = xasmCompiler->compile(R"(__qpu__ void ansatz_tape(qbit q, double t) {
+      X(q[0]);
+      Ry(q[1], 0.5 * t - 0.1);
+      CX(q[1], q[0]);
+      Rz(q[0], t);
+      H(q[0]);
+      H(q[1]);
+      Measure(q[0]);
+      Measure(q[1]);
+  })", accelerator);
+
+  auto program = ir->getComposite("ansatz_tape");
+  // Compile once, then re-bind and replay.
+  auto tape = tnqvmAcc->compile(program);
+  EXPECT_EQ(tape->nbParametricEntries(), 2);
+  const auto angles = xacc::linspace(-xacc::constants::pi, xacc::constants::pi, 20);
+  for (const auto &a : angles) {
+    auto bufferTape = xacc::qalloc(2);
+    tnqvmAcc->execute(bufferTape, tape, {a});
+    auto buffer = xacc::qalloc(2);
+    accelerator->execute(buffer, program->operator()({a}));
+    EXPECT_NEAR(getExpectedValue(*bufferTape), getExpectedValue(*buffer), 1e-12);
+  }
+}
+
+TEST(ExatnVisitorTester, checkWarmMode) {
+  auto accelerator = xacc::getAccelerator("tnqvm", {std::make_pair("tnqvm-visitor", "exatn")});
+  auto warmAccelerator = xacc::getAccelerator("tnqvm", {std::make_pair("tnqvm-visitor", "exatn"), std::make_pair("warm-mode", true)});
+  auto xasmCompiler = xacc::getCompiler("xasm");
+  auto ir = xasmCompiler->compile(R"(__qpu__ void ansatz_warm(qbit q, double t) {
+      X(q[0]);
+      Ry(q[1], t);
+      CX(q[1], q[0]);
+      H(q[0]);
+      H(q[1]);
+      Measure(q[0]);
+      Measure(q[1]);
+  })", accelerator);
+
+  auto program = ir->getComposite("ansatz_warm");
+  const auto angles = xacc::linspace(-xacc::constants::pi, xacc::constants::pi, 20);
+  for (const auto &a : angles) {
+    auto evaled = program->operator()({a});
+    auto buffer = xacc::qalloc(2);
+    accelerator->execute(buffer, evaled);
+    // Warm visitor: gate and qubit tensors from the previous iterations are reused.
+    auto warmBuffer = xacc::qalloc(2);
+    warmAccelerator->execute(warmBuffer, evaled);
+    EXPECT_NEAR(getExpectedValue(*warmBuffer), getExpectedValue(*buffer), 1e-12);
+  }
+}
+
 TEST(ExatnVisitorTester, testPostMeasurementSimulation) {
   // Test that after-measurement simulation mode,
   // i.e. multiple tensor evaluation runs on the backend.  
@@ -653,6 +709,274 @@ TEST(ExatnVisitorTester, testBitStringAmplitude)
   }
 }
 
+TEST(ExatnVisitorTester, testBitStringBatchAmplitudes)
+{
+  auto xasmCompiler = xacc::getCompiler("xasm");
+  auto ir = xasmCompiler->compile(R"(__qpu__ void testGhzBatch(qbit q) {
+    H(q[0]);
+    for (int i = 1; i < 50; i++) {
+      CX(q[0], q[i]); 
+    }
+  })", nullptr);
+  auto program = ir->getComposites()[0];
+  // Batch: all zero's, all one's and their neighbors (concatenated).
+  std::vector<std::vector<int>> bitStrings(4);
+  bitStrings[0] = std::vector<int>(50, 0);
+  bitStrings[1] = std::vector<int>(50, 1);
+  bitStrings[2] = bitStrings[1];
+  bitStrings[2][4] = 0;
+  bitStrings[3] = bitStrings[0];
+  bitStrings[3][10] = 1;
+  const std::vector<double> expectedAmpls{M_SQRT1_2, M_SQRT1_2, 0.0, 0.0};
+  std::vector<int> bitStringBatch;
+  for (const auto &bitString : bitStrings) {
+    bitStringBatch.insert(bitStringBatch.end(), bitString.begin(), bitString.end());
+  }
+  auto qpu = xacc::getAccelerator("tnqvm",
+                                  {
+                                    std::make_pair("tnqvm-visitor", "exatn"),
+                                    std::make_pair("bitstring-batch", bitStringBatch),
+                                  });
+  auto buffer = xacc::qalloc(50);
+  qpu->execute(buffer, program);
+  const auto realAmpl = (*buffer)["amplitudes-real"].as<std::vector<double>>();
+  const auto imagAmpl = (*buffer)["amplitudes-imag"].as<std::vector<double>>();
+  ASSERT_EQ(realAmpl.size(), bitStrings.size());
+  ASSERT_EQ(imagAmpl.size(), bitStrings.size());
+  for (size_t i = 0; i < bitStrings.size(); ++i) {
+    EXPECT_NEAR(realAmpl[i], expectedAmpls[i], 1e-6);
+    EXPECT_NEAR(imagAmpl[i], 0.0, 1e-6);
+  }
+  // Neighbors share a contraction.
+  EXPECT_EQ(qpu->getExecutionInfo().get<int>("exatn-amplitude-contractions"), 2);
+
+  // Duplicated bit strings: one contraction, each entry gets its amplitude.
+  std::vector<int> duplicateBatch(bitStrings[1]);
+  duplicateBatch.insert(duplicateBatch.end(), bitStrings[1].begin(), bitStrings[1].end());
+  auto qpuDup = xacc::getAccelerator("tnqvm",
+                                     {
+                                       std::make_pair("tnqvm-visitor", "exatn"),
+                                       std::make_pair("bitstring-batch", duplicateBatch),
+                                     });
+  auto bufferDup = xacc::qalloc(50);
+  qpuDup->execute(bufferDup, program);
+  const auto realAmplDup = (*bufferDup)["amplitudes-real"].as<std::vector<double>>();
+  ASSERT_EQ(realAmplDup.size(), 2);
+  EXPECT_NEAR(realAmplDup[0], M_SQRT1_2, 1e-6);
+  EXPECT_NEAR(realAmplDup[1], M_SQRT1_2, 1e-6);
+  EXPECT_EQ(qpuDup->getExecutionInfo().get<int>("exatn-amplitude-contractions"), 1);
+}
+
+TEST(ExatnVisitorTester, testFrugalSampling)
+{
+  // Random-like circuit (Porter-Thomas output distribution)
+  auto xasmCompiler = xacc::getCompiler("xasm");
+  auto ir = xasmCompiler->compile(R"(__qpu__ void testFrugal(qbit q) {
+    Rx(q[0], 0.3);
+    Ry(q[0], 1.1);
+    Rx(q[1], 1.0);
+    Ry(q[1], 1.5);
+    Rx(q[2], 1.7);
+    Ry(q[2], 1.9);
+    Rx(q[3], 2.4);
+    Ry(q[3], 2.3);
+    Rx(q[4], 3.1);
+    Ry(q[4], 2.7);
+    Rx(q[5], 0.7);
+    Ry(q[5], 0.0);
+    Rx(q[6], 1.4);
+    Ry(q[6], 0.4);
+    Rx(q[7], 2.1);
+    Ry(q[7], 0.8);
+    CZ(q[0], q[1]);
+    CZ(q[2], q[3]);
+    CZ(q[4], q[5]);
+    CZ(q[6], q[7]);
+    Rx(q[0], 1.6);
+    Ry(q[0], 2.0);
+    Rx(q[1], 2.3);
+    Ry(q[1], 2.4);
+    Rx(q[2], 3.0);
+    Ry(q[2], 2.8);
+    Rx(q[3], 0.6);
+    Ry(q[3], 0.1);
+    Rx(q[4], 1.3);
+    Ry(q[4], 0.5);
+    Rx(q[5], 2.0);
+    Ry(q[5], 0.9);
+    Rx(q[6], 2.7);
+    Ry(q[6], 1.3);
+    Rx(q[7], 0.3);
+    Ry(q[7], 1.7);
+    CZ(q[1], q[2]);
+    CZ(q[3], q[4]);
+    CZ(q[5], q[6]);
+    Rx(q[0], 2.9);
+    Ry(q[0], 2.9);
+    Rx(q[1], 0.5);
+    Ry(q[1], 0.2);
+    Rx(q[2], 1.2);
+    Ry(q[2], 0.6);
+    Rx(q[3], 1.9);
+    Ry(q[3], 1.0);
+    Rx(q[4], 2.6);
+    Ry(q[4], 1.4);
+    Rx(q[5], 0.2);
+    Ry(q[5], 1.8);
+    Rx(q[6], 0.9);
+    Ry(q[6], 2.2);
+    Rx(q[7], 1.6);
+    Ry(q[7], 2.6);
+    CZ(q[0], q[1]);
+    CZ(q[2], q[3]);
+    CZ(q[4], q[5]);
+    CZ(q[6], q[7]);
+    Rx(q[0], 1.1);
+    Ry(q[0], 0.7);
+    Rx(q[1], 1.8);
+    Ry(q[1], 1.1);
+    Rx(q[2], 2.5);
+    Ry(q[2], 1.5);
+    Rx(q[3], 0.1);
+    Ry(q[3], 1.9);
+    Rx(q[4], 0.8);
+    Ry(q[4], 2.3);
+    Rx(q[5], 1.5);
+    Ry(q[5], 2.7);
+    Rx(q[6], 2.2);
+    Ry(q[6], 0.0);
+    Rx(q[7], 2.9);
+    Ry(q[7], 0.4);
+    CZ(q[1], q[2]);
+    CZ(q[3], q[4]);
+    CZ(q[5], q[6]);
+    Measure(q[0]);
+    Measure(q[1]);
+    Measure(q[2]);
+    Measure(q[3]);
+    Measure(q[4]);
+    Measure(q[5]);
+    Measure(q[6]);
+    Measure(q[7]);
+  })", nullptr);
+  auto program = ir->getComposites()[0];
+  const int nbShots = 200;
+  // The state vector is too large (max-qubit): sample from slices with 3 open
+  // qubits.
+  auto qpu = xacc::getAccelerator("tnqvm",
+                                  {
+                                    std::make_pair("tnqvm-visitor", "exatn"),
+                                    std::make_pair("max-qubit", 4),
+                                    std::make_pair("shots", nbShots),
+                                    std::make_pair("sampling-method", "frugal"),
+                                    std::make_pair("frugal-open-qubits", 3),
+                                  });
+  auto buffer = xacc::qalloc(8);
+  qpu->execute(buffer, program);
+  int totalCount = 0;
+  for (const auto &[bitString, count] : buffer->getMeasurementCounts()) {
+    EXPECT_EQ(bitString.size(), 8);
+    totalCount += count;
+  }
+  EXPECT_EQ(totalCount, nbShots);
+  const auto info = qpu->getExecutionInfo();
+  // 8 candidates per slice, ~10 candidates per sample
+  EXPECT_GE(info.get<int>("frugal-candidates"), nbShots);
+  EXPECT_LT(info.get<int>("frugal-slices"), nbShots * 10);
+
+  // Basis state: a projected (q[0]) and an open (q[7]) qubit are flipped,
+  // the only candidate with a non-zero probability is always accepted.
+  auto irBasis = xasmCompiler->compile(R"(__qpu__ void testFrugalBasis(qbit q) {
+    X(q[0]);
+    X(q[7]);
+    for (int i = 0; i < 8; i++) {
+      Measure(q[i]);
+    }
+  })", nullptr);
+  auto qpuBasis = xacc::getAccelerator("tnqvm",
+                                       {
+                                         std::make_pair("tnqvm-visitor", "exatn"),
+                                         std::make_pair("max-qubit", 4),
+                                         std::make_pair("shots", 20),
+                                         std::make_pair("sampling-method", "frugal"),
+                                         std::make_pair("frugal-open-qubits", 3),
+                                       });
+  auto bufferBasis = xacc::qalloc(8);
+  qpuBasis->execute(bufferBasis, irBasis->getComposites()[0]);
+  const auto basisCounts = bufferBasis->getMeasurementCounts();
+  ASSERT_EQ(basisCounts.size(), 1);
+  EXPECT_EQ(basisCounts.begin()->first, "10000001");
+  EXPECT_EQ(basisCounts.begin()->second, 20);
+  EXPECT_EQ(qpuBasis->getExecutionInfo().get<int>("frugal-over-bound"), 20);
+}
+
+TEST(ExatnVisitorTester, testBlockSampling)
+{
+  // Too many qubits for a state vector: sampled by RDM contractions.
+  auto xasmCompiler = xacc::getCompiler("xasm");
+  auto ir = xasmCompiler->compile(R"(__qpu__ void testGhzSampling(qbit q) {
+    H(q[0]);
+    for (int i = 1; i < 52; i++) {
+      CX(q[0], q[i]);
+    }
+    for (int i = 0; i < 52; i++) {
+      Measure(q[i]);
+    }
+  })", nullptr);
+  auto program = ir->getComposites()[0];
+  const int nbShots = 3;
+  for (int blockSize : {1, 4}) {
+    auto qpu = xacc::getAccelerator("tnqvm",
+                                    {
+                                      std::make_pair("tnqvm-visitor", "exatn"),
+                                      std::make_pair("shots", nbShots),
+                                      std::make_pair("sampling-block-size", blockSize),
+                                    });
+    auto buffer = xacc::qalloc(52);
+    qpu->execute(buffer, program);
+    int totalCount = 0;
+    for (const auto &[bitString, count] : buffer->getMeasurementCounts()) {
+      // GHZ: all 0's or all 1's
+      EXPECT_TRUE(bitString == std::string(52, '0') ||
+                  bitString == std::string(52, '1'));
+      totalCount += count;
+    }
+    EXPECT_EQ(totalCount, nbShots);
+  }
+
+  // Flipped qubits across uneven blocks (52 = 17 * 3 + 1): the outcomes of
+  // each block are placed on its own qubits.
+  auto irFlipped = xasmCompiler->compile(R"(__qpu__ void testGhzFlippedSampling(qbit q) {
+    H(q[0]);
+    for (int i = 1; i < 52; i++) {
+      CX(q[0], q[i]);
+    }
+    X(q[1]);
+    X(q[50]);
+    for (int i = 0; i < 52; i++) {
+      Measure(q[i]);
+    }
+  })", nullptr);
+  std::string expected0(52, '0');
+  expected0[1] = expected0[50] = '1';
+  std::string expected1(52, '1');
+  expected1[1] = expected1[50] = '0';
+  auto qpu = xacc::getAccelerator("tnqvm",
+                                  {
+                                    std::make_pair("tnqvm-visitor", "exatn"),
+                                    std::make_pair("shots", nbShots),
+                                    std::make_pair("sampling-block-size", 3),
+                                  });
+  auto buffer = xacc::qalloc(52);
+  qpu->execute(buffer, irFlipped->getComposites()[0]);
+  int totalCount = 0;
+  for (const auto &[bitString, count] : buffer->getMeasurementCounts()) {
+    EXPECT_TRUE(bitString == expected0 || bitString == expected1);
+    totalCount += count;
+  }
+  EXPECT_EQ(totalCount, nbShots);
+}
+
 int main(int argc, char **argv) 
 {
   xacc::Initialize();
@@ -0,0 +1,127 @@
+/***********************************************************************************
+ * Copyright (c) 2020, UT-Battelle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the xacc nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ **********************************************************************************/
+#include <gtest/gtest.h>
+#include <random>
+#include "xacc.hpp"
+#include "utils/StateVectorKernels.hpp"
+
+using namespace tnqvm;
+
+namespace {
+std::vector<double> generateRandomProbVector(size_t in_nbQubits) {
+  std::mt19937 gen(1234);
+  std::uniform_real_distribution<double> dis(0.0, 1.0);
+  std::vector<double> probVec(1ULL << in_nbQubits);
+  double sum = 0.0;
+  for (auto &val : probVec) {
+    val = dis(gen);
+    sum += val;
+  }
+  for (auto &val : probVec) {
+    val /= sum;
+  }
+  return probVec;
+}
+
+double directExpValZ(const std::vector<double> &in_probVec, uint64_t in_mask) {
+  double result = 0.0;
+  for (uint64_t i = 0; i < in_probVec.size(); ++i) {
+    result += (__builtin_popcountll(i & in_mask) % 2 == 0 ? 1.0 : -1.0) *
+              in_probVec[i];
+  }
+  return result;
+}
+} // namespace
+
+TEST(StateVectorKernelsTester, checkWalshHadamardExpValZ) {
+  // Small (serial) and large (multi-threaded) vectors
+  for (const size_t nbQubits : {1, 4, 10, 18}) {
+    const auto probVec = generateRandomProbVector(nbQubits);
+    auto transformed = probVec;
+    kernels::fastWalshHadamardTransform(transformed, 8);
+    // Total probability
+    EXPECT_NEAR(transformed[0], 1.0, 1e-9);
+    const uint64_t maxMask = (1ULL << nbQubits) - 1;
+    for (const uint64_t mask : std::vector<uint64_t>{1, 2, 5, maxMask / 3, maxMask}) {
+      if (mask <= maxMask) {
+        EXPECT_NEAR(transformed[mask], directExpValZ(probVec, mask), 1e-9);
+      }
+    }
+    // Z-string on qubits {0, nbQubits - 1}
+    const std::vector<int> qubits{0, static_cast<int>(nbQubits) - 1};
+    EXPECT_NEAR(transformed[kernels::getQubitMask(qubits)],
+                directExpValZ(probVec, kernels::getQubitMask(qubits)), 1e-9);
+  }
+}
+
+TEST(StateVectorKernelsTester, checkQubitMask) {
+  EXPECT_EQ(kernels::getQubitMask(std::vector<int>{0, 2}), 5u);
+  // Z0 Z0 Z2 == Z2
+  EXPECT_EQ(kernels::getQubitMask(std::vector<int>{0, 2, 0}), 4u);
+  EXPECT_EQ(kernels::getQubitMask(std::vector<int>{1, 1}), 0u);
+}
+
+TEST(StateVectorKernelsTester, checkSingleQubitGate) {
+  const std::complex<double> I(0.0, 1.0);
+  // Rx(pi/2), i.e. Y-basis change
+  const std::array<std::complex<double>, 4> rxMat{
+      M_SQRT1_2, -I * M_SQRT1_2, -I * M_SQRT1_2, M_SQRT1_2};
+  for (const size_t nbQubits : {2, 16}) {
+    for (size_t qubitIdx = 0; qubitIdx < nbQubits; ++qubitIdx) {
+      // Random state
+      std::mt19937 gen(qubitIdx);
+      std::normal_distribution<double> dis(0.0, 1.0);
+      std::vector<std::complex<double>> stateVec(1ULL << nbQubits);
+      for (auto &val : stateVec) {
+        val = std::complex<double>(dis(gen), dis(gen));
+      }
+      auto expected = stateVec;
+      const size_t stride = 1ULL << qubitIdx;
+      for (size_t i = 0; i < expected.size(); ++i) {
+        if ((i & stride) == 0) {
+          const auto a = stateVec[i];
+          const auto b = stateVec[i + stride];
+          expected[i] = rxMat[0] * a + rxMat[1] * b;
+          expected[i + stride] = rxMat[2] * a + rxMat[3] * b;
+        }
+      }
+      kernels::applySingleQubitGate(stateVec, qubitIdx, rxMat, 8);
+      for (size_t i = 0; i < expected.size(); ++i) {
+        EXPECT_NEAR(std::abs(stateVec[i] - expected[i]), 0.0, 1e-12);
+      }
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+  xacc::Initialize(argc, argv);
+  ::testing::InitGoogleTest(&argc, argv);
+  auto ret = RUN_ALL_TESTS();
+  xacc::Finalize();
+  return ret;
+}
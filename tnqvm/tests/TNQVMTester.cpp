@@ -32,6 +32,10 @@
 #include <gtest/gtest.h>
 #include "xacc.hpp"
 #include "xacc_service.hpp"
+#include "TNQVM.hpp"
+#include <atomic>
+#include <random>
+#include <thread>
 
 using namespace xacc;
 // using namespace xacc::quantum;
@@ -218,6 +222,555 @@ TEST(TNQVMTester, checkKernelExecution) {
   acc->execute(qreg1, f);
 }
 
+TEST(TNQVMTester, checkParallelKernels) {
+  auto provider = xacc::getIRProvider("quantum");
+  std::vector<std::shared_ptr<xacc::CompositeInstruction>> kernels;
+  const auto angles = xacc::linspace(-xacc::constants::pi, xacc::constants::pi, 16);
+  for (size_t i = 0; i < angles.size(); ++i) {
+    auto f = provider->createComposite("kernel_" + std::to_string(i));
+    f->addInstruction(provider->createInstruction("X", 0));
+    f->addInstruction(provider->createInstruction("Ry", {1}, {angles[i]}));
+    f->addInstruction(provider->createInstruction("CNOT", {1, 0}));
+    f->addInstruction(provider->createInstruction("Measure", 0));
+    f->addInstruction(provider->createInstruction("Measure", 1));
+    kernels.emplace_back(f);
+  }
+
+  auto acc = xacc::getAccelerator("tnqvm", {std::make_pair("vqe-mode", false)});
+  auto buffer = xacc::qalloc(2);
+  acc->execute(buffer, kernels);
+
+  auto parallelAcc = xacc::getAccelerator("tnqvm", {std::make_pair("vqe-mode", false), std::make_pair("parallel-kernels", 4)});
+  auto parallelBuffer = xacc::qalloc(2);
+  parallelAcc->execute(parallelBuffer, kernels);
+
+  const auto children = buffer->getChildren();
+  const auto parallelChildren = parallelBuffer->getChildren();
+  EXPECT_EQ(parallelChildren.size(), kernels.size());
+  for (size_t i = 0; i < kernels.size(); ++i) {
+    // Submission order is preserved
+    EXPECT_EQ(parallelChildren[i]->name(), kernels[i]->name());
+    EXPECT_NEAR(parallelChildren[i]->getExpectationValueZ(), children[i]->getExpectationValueZ(), 1e-9);
+  }
+}
+
+TEST(TNQVMTester, checkSharedPrefix) {
+  auto provider = xacc::getIRProvider("quantum");
+  // Common prefix, different trailing gates (e.g. tomography circuits)
+  std::vector<std::shared_ptr<xacc::CompositeInstruction>> kernels;
+  const std::vector<std::string> bases{"Z", "X", "Y"};
+  for (const auto &basis0 : bases) {
+    for (const auto &basis1 : bases) {
+      auto f = provider->createComposite("tomo_" + basis0 + basis1);
+      f->addInstruction(provider->createInstruction("H", 0));
+      f->addInstruction(provider->createInstruction("Ry", {1}, {0.123}));
+      f->addInstruction(provider->createInstruction("CNOT", {0, 1}));
+      f->addInstruction(provider->createInstruction("Rz", {0}, {-0.456}));
+      for (const auto &[qubitIdx, basis] : {std::make_pair(0, basis0), std::make_pair(1, basis1)}) {
+        if (basis == "X") {
+          f->addInstruction(provider->createInstruction("H", qubitIdx));
+        } else if (basis == "Y") {
+          f->addInstruction(provider->createInstruction("Rx", {(size_t)qubitIdx}, {xacc::constants::pi / 2.0}));
+        }
+      }
+      f->addInstruction(provider->createInstruction("Measure", 0));
+      f->addInstruction(provider->createInstruction("Measure", 1));
+      kernels.emplace_back(f);
+    }
+  }
+
+  auto acc = xacc::getAccelerator("tnqvm", {std::make_pair("vqe-mode", false)});
+  auto buffer = xacc::qalloc(2);
+  acc->execute(buffer, kernels);
+
+  auto sharedAcc = xacc::getAccelerator("tnqvm", {std::make_pair("vqe-mode", false), std::make_pair("shared-prefix", true)});
+  auto sharedBuffer = xacc::qalloc(2);
+  sharedAcc->execute(sharedBuffer, kernels);
+  const auto info = sharedAcc->getExecutionInfo();
+  EXPECT_LT(info.get<int>("shared-prefix-simulated-gates"), info.get<int>("shared-prefix-total-gates"));
+
+  const auto children = buffer->getChildren();
+  const auto sharedChildren = sharedBuffer->getChildren();
+  EXPECT_EQ(sharedChildren.size(), kernels.size());
+  for (size_t i = 0; i < kernels.size(); ++i) {
+    EXPECT_EQ(sharedChildren[i]->name(), kernels[i]->name());
+    EXPECT_NEAR(sharedChildren[i]->getExpectationValueZ(), children[i]->getExpectationValueZ(), 1e-6);
+  }
+}
+
+TEST(TNQVMTester, checkGateFusion) {
+  auto provider = xacc::getIRProvider("quantum");
+  auto f = provider->createComposite("fusion_test");
+  f->addInstruction(provider->createInstruction("H", 0));
+  f->addInstruction(provider->createInstruction("Ry", {1}, {0.123}));
+  f->addInstruction(provider->createInstruction("T", 1));
+  f->addInstruction(provider->createInstruction("CNOT", {0, 1}));
+  f->addInstruction(provider->createInstruction("Rz", {0}, {-0.456}));
+  f->addInstruction(provider->createInstruction("CNOT", {1, 0}));
+  f->addInstruction(provider->createInstruction("Rx", {2}, {0.789}));
+  f->addInstruction(provider->createInstruction("CNOT", {1, 2}));
+  f->addInstruction(provider->createInstruction("H", 2));
+  f->addInstruction(provider->createInstruction("Measure", 0));
+  f->addInstruction(provider->createInstruction("Measure", 2));
+
+  auto acc = xacc::getAccelerator("tnqvm");
+  auto buffer = xacc::qalloc(3);
+  acc->execute(buffer, f);
+
+  auto fusionAcc = xacc::getAccelerator("tnqvm", {std::make_pair("gate-fusion", true)});
+  auto fusionBuffer = xacc::qalloc(3);
+  fusionAcc->execute(fusionBuffer, f);
+  // {H, Ry, T, CNOT, Rz, CNOT} and {Rx, CNOT, H} are fused (+ 2 measurements)
+  EXPECT_EQ(mpark::get<int>(fusionBuffer->getInformation("gate-fusion-gates-before")), 11);
+  EXPECT_EQ(mpark::get<int>(fusionBuffer->getInformation("gate-fusion-gates-after")), 4);
+  EXPECT_NEAR(fusionBuffer->getExpectationValueZ(), buffer->getExpectationValueZ(), 1e-6);
+}
+
+TEST(TNQVMTester, checkGateFusionBlocks) {
+  // H(0) H(1) CNOT(0,1) H(1) CNOT(1,0) Measure(0) H(2): one two-qubit block,
+  // the measurement (barrier) and the lone H on qubit 2.
+  auto provider = xacc::getIRProvider("quantum");
+  auto f = provider->createComposite("fusion_blocks_test");
+  f->addInstruction(provider->createInstruction("H", 0));
+  f->addInstruction(provider->createInstruction("H", 1));
+  f->addInstruction(provider->createInstruction("CNOT", {0, 1}));
+  f->addInstruction(provider->createInstruction("H", 1));
+  f->addInstruction(provider->createInstruction("CNOT", {1, 0}));
+  f->addInstruction(provider->createInstruction("Measure", 0));
+  f->addInstruction(provider->createInstruction("H", 2));
+
+  auto acc = xacc::getAccelerator("tnqvm");
+  auto buffer = xacc::qalloc(3);
+  acc->execute(buffer, f);
+
+  auto fusionAcc = xacc::getAccelerator("tnqvm", {std::make_pair("gate-fusion", true)});
+  auto fusionBuffer = xacc::qalloc(3);
+  fusionAcc->execute(fusionBuffer, f);
+  EXPECT_EQ(mpark::get<int>(fusionBuffer->getInformation("gate-fusion-gates-after")), 3);
+  EXPECT_NEAR(fusionBuffer->getExpectationValueZ(), buffer->getExpectationValueZ(), 1e-6);
+}
+
+TEST(TNQVMTester, checkGateFusionRandomCircuits) {
+  constexpr int NB_QUBITS = 4;
+  std::mt19937 gen(1234);
+  std::uniform_int_distribution<int> qubitDis(0, NB_QUBITS - 1);
+  std::uniform_int_distribution<int> typeDis(0, 5);
+  std::uniform_real_distribution<double> angleDis(-xacc::constants::pi, xacc::constants::pi);
+  auto provider = xacc::getIRProvider("quantum");
+  auto acc = xacc::getAccelerator("tnqvm");
+  auto fusionAcc = xacc::getAccelerator("tnqvm", {std::make_pair("gate-fusion", true)});
+  for (int trial = 0; trial < 10; ++trial) {
+    auto f = provider->createComposite("fusion_random_test_" + std::to_string(trial));
+    for (int i = 0; i < 40; ++i) {
+      const size_t q0 = qubitDis(gen);
+      size_t q1 = qubitDis(gen);
+      while (q1 == q0) {
+        q1 = qubitDis(gen);
+      }
+      switch (typeDis(gen)) {
+      case 0: f->addInstruction(provider->createInstruction("Rx", {q0}, {angleDis(gen)})); break;
+      case 1: f->addInstruction(provider->createInstruction("Ry", {q0}, {angleDis(gen)})); break;
+      case 2: f->addInstruction(provider->createInstruction("Rz", {q0}, {angleDis(gen)})); break;
+      case 3: f->addInstruction(provider->createInstruction("H", q0)); break;
+      case 4: f->addInstruction(provider->createInstruction("CNOT", {q0, q1})); break;
+      default: f->addInstruction(provider->createInstruction("CPhase", {q0, q1}, {angleDis(gen)})); break;
+      }
+    }
+    for (size_t q = 0; q < NB_QUBITS; ++q) {
+      f->addInstruction(provider->createInstruction("Measure", q));
+    }
+
+    auto buffer = xacc::qalloc(NB_QUBITS);
+    acc->execute(buffer, f);
+    auto fusionBuffer = xacc::qalloc(NB_QUBITS);
+    fusionAcc->execute(fusionBuffer, f);
+    EXPECT_LT(mpark::get<int>(fusionBuffer->getInformation("gate-fusion-gates-after")),
+              mpark::get<int>(fusionBuffer->getInformation("gate-fusion-gates-before")));
+    EXPECT_NEAR(fusionBuffer->getExpectationValueZ(), buffer->getExpectationValueZ(), 1e-6);
+  }
+}
+
+TEST(TNQVMTester, checkPeephole) {
+  auto provider = xacc::getIRProvider("quantum");
+  auto f = provider->createComposite("peephole_test");
+  f->addInstruction(provider->createInstruction("H", 0));
+  f->addInstruction(provider->createInstruction("X", 1));
+  f->addInstruction(provider->createInstruction("X", 1));
+  f->addInstruction(provider->createInstruction("CNOT", {0, 1}));
+  f->addInstruction(provider->createInstruction("CNOT", {0, 1}));
+  f->addInstruction(provider->createInstruction("Rx", {2}, {0.3}));
+  f->addInstruction(provider->createInstruction("Rx", {2}, {0.4}));
+  f->addInstruction(provider->createInstruction("CNOT", {2, 0}));
+  f->addInstruction(provider->createInstruction("Rz", {0}, {0.5}));
+  f->addInstruction(provider->createInstruction("CZ", {0, 2}));
+  f->addInstruction(provider->createInstruction("Measure", 0));
+  f->addInstruction(provider->createInstruction("Measure", 2));
+
+  auto acc = xacc::getAccelerator("tnqvm");
+  auto buffer = xacc::qalloc(3);
+  acc->execute(buffer, f);
+
+  auto peepholeAcc = xacc::getAccelerator("tnqvm", {std::make_pair("peephole", true)});
+  auto peepholeBuffer = xacc::qalloc(3);
+  peepholeAcc->execute(peepholeBuffer, f);
+  // X.X and CNOT.CNOT cancel, Rx's are merged, Rz and CZ before measurement
+  // are dropped: {H, Rx, CNOT} + 2 measurements
+  auto executionInfo = peepholeAcc->getExecutionInfo();
+  EXPECT_EQ(executionInfo.get<int>("peephole-gates-before"), 12);
+  EXPECT_EQ(executionInfo.get<int>("peephole-gates-after"), 5);
+  EXPECT_NEAR(peepholeBuffer->getExpectationValueZ(), buffer->getExpectationValueZ(), 1e-6);
+}
+
+TEST(TNQVMTester, checkPeepholeRules) {
+  auto provider = xacc::getIRProvider("quantum");
+  auto acc = xacc::getAccelerator("tnqvm");
+  auto peepholeAcc = xacc::getAccelerator("tnqvm", {std::make_pair("peephole", true)});
+  // Returns the number of gates after simplification, checking the result
+  // against the unsimplified execution.
+  const auto simplify = [&](const std::string &in_name,
+                            const std::vector<std::shared_ptr<xacc::Instruction>> &in_gates,
+                            const std::vector<size_t> &in_measured) {
+    auto f = provider->createComposite(in_name);
+    for (const auto &gate : in_gates) {
+      f->addInstruction(gate);
+    }
+    for (const auto &qubit : in_measured) {
+      f->addInstruction(provider->createInstruction("Measure", qubit));
+    }
+    auto buffer = xacc::qalloc(3);
+    acc->execute(buffer, f);
+    auto peepholeBuffer = xacc::qalloc(3);
+    peepholeAcc->execute(peepholeBuffer, f);
+    EXPECT_NEAR(peepholeBuffer->getExpectationValueZ(), buffer->getExpectationValueZ(), 1e-6);
+    return peepholeAcc->getExecutionInfo().get<int>("peephole-gates-after");
+  };
+
+  // H.X.X.H: cascading cancellation
+  EXPECT_EQ(simplify("peephole_cascade",
+                     {provider->createInstruction("H", 0), provider->createInstruction("X", 0),
+                      provider->createInstruction("X", 0), provider->createInstruction("H", 0)},
+                     {0}),
+            1);
+  // Swap in/swap back (either qubit order), S.Sdg, Tdg.T
+  EXPECT_EQ(simplify("peephole_pairs",
+                     {provider->createInstruction("Swap", {0, 1}), provider->createInstruction("S", 2),
+                      provider->createInstruction("Sdg", 2), provider->createInstruction("Swap", {1, 0}),
+                      provider->createInstruction("Tdg", 0), provider->createInstruction("T", 0)},
+                     {0, 1, 2}),
+            3);
+  // CNOT with reversed control/target doesn't cancel.
+  EXPECT_EQ(simplify("peephole_reversed_cnot",
+                     {provider->createInstruction("H", 0), provider->createInstruction("CNOT", {0, 1}),
+                      provider->createInstruction("CNOT", {1, 0})},
+                     {0, 1}),
+            5);
+  // Rz(2*pi) = -I is kept (global phase), Rz(4*pi) is dropped.
+  EXPECT_EQ(simplify("peephole_rz_2pi",
+                     {provider->createInstruction("Rz", {0}, {xacc::constants::pi}),
+                      provider->createInstruction("Rz", {0}, {xacc::constants::pi}),
+                      provider->createInstruction("H", 0)},
+                     {0}),
+            3);
+  EXPECT_EQ(simplify("peephole_rz_4pi",
+                     {provider->createInstruction("Rz", {0}, {2.0 * xacc::constants::pi}),
+                      provider->createInstruction("Rz", {0}, {2.0 * xacc::constants::pi}),
+                      provider->createInstruction("H", 0)},
+                     {0}),
+            2);
+  // CZ is kept: qubit 1 is not only measured afterward.
+  EXPECT_EQ(simplify("peephole_cz_kept",
+                     {provider->createInstruction("H", 0), provider->createInstruction("H", 1),
+                      provider->createInstruction("CZ", {0, 1}), provider->createInstruction("Measure", 0),
+                      provider->createInstruction("H", 1)},
+                     {1}),
+            6);
+}
+
+TEST(TNQVMTester, checkMeasuredLightCone) {
+  auto provider = xacc::getIRProvider("quantum");
+  auto f = provider->createComposite("light_cone_test");
+  f->addInstruction(provider->createInstruction("H", 0));
+  f->addInstruction(provider->createInstruction("Ry", {1}, {0.123}));
+  f->addInstruction(provider->createInstruction("CNOT", {0, 1}));
+  // Not in the light cone of the measured qubits (0, 1)
+  f->addInstruction(provider->createInstruction("Rx", {2}, {0.789}));
+  f->addInstruction(provider->createInstruction("CNOT", {2, 3}));
+  f->addInstruction(provider->createInstruction("CNOT", {1, 2}));
+  f->addInstruction(provider->createInstruction("Measure", 0));
+  f->addInstruction(provider->createInstruction("Measure", 1));
+
+  auto acc = xacc::getAccelerator("tnqvm");
+  auto buffer = xacc::qalloc(4);
+  acc->execute(buffer, f);
+
+  auto coneAcc = xacc::getAccelerator("tnqvm", {std::make_pair("light-cone", true)});
+  auto coneBuffer = xacc::qalloc(4);
+  coneAcc->execute(coneBuffer, f);
+  // {H, Ry, CNOT} + 2 measurements
+  EXPECT_EQ(mpark::get<int>(coneBuffer->getInformation("light-cone-gates-before")), 8);
+  EXPECT_EQ(mpark::get<int>(coneBuffer->getInformation("light-cone-gates-after")), 5);
+  EXPECT_NEAR(coneBuffer->getExpectationValueZ(), buffer->getExpectationValueZ(), 1e-6);
+}
+
+TEST(TNQVMTester, checkMeasuredLightConeBrickwork) {
+  // Brickwork circuit on 6 qubits: H layer, CZ(0,1) CZ(2,3) CZ(4,5) CZ(1,2)
+  // CZ(3,4), Rx layer, then measure qubit 2.
+  auto provider = xacc::getIRProvider("quantum");
+  auto f = provider->createComposite("light_cone_brickwork_test");
+  for (size_t q = 0; q < 6; ++q) {
+    f->addInstruction(provider->createInstruction("H", q));
+  }
+  for (const auto &pair : std::vector<std::vector<size_t>>{{0, 1}, {2, 3}, {4, 5}, {1, 2}, {3, 4}}) {
+    f->addInstruction(provider->createInstruction("CZ", pair));
+  }
+  for (size_t q = 0; q < 6; ++q) {
+    f->addInstruction(provider->createInstruction("Rx", {q}, {0.1 * (q + 1)}));
+  }
+  f->addInstruction(provider->createInstruction("Measure", 2));
+
+  auto acc = xacc::getAccelerator("tnqvm");
+  auto buffer = xacc::qalloc(6);
+  acc->execute(buffer, f);
+
+  auto coneAcc = xacc::getAccelerator("tnqvm", {std::make_pair("light-cone", true)});
+  auto coneBuffer = xacc::qalloc(6);
+  coneAcc->execute(coneBuffer, f);
+  // CZ(1,2) pulls in CZ(0,1) and CZ(2,3): H and CZ on qubits 0-3, Rx(2) and
+  // the measurement.
+  EXPECT_EQ(mpark::get<int>(coneBuffer->getInformation("light-cone-gates-before")), 18);
+  EXPECT_EQ(mpark::get<int>(coneBuffer->getInformation("light-cone-gates-after")), 9);
+  EXPECT_NEAR(coneBuffer->getExpectationValueZ(), buffer->getExpectationValueZ(), 1e-6);
+}
+
+TEST(TNQVMTester, checkAutoVisitor) {
+  auto xasmCompiler = xacc::getCompiler("xasm");
+  auto ir = xasmCompiler->compile(R"(__qpu__ void ghz_auto(qbit q) {
+      H(q[0]);
+      CX(q[0], q[1]);
+      CX(q[1], q[2]);
+      CX(q[2], q[3]);
+      Measure(q[0]);
+      Measure(q[3]);
+    })");
+  auto program = ir->getComposite("ghz_auto");
+  auto accelerator =
+      xacc::getAccelerator("tnqvm", {std::make_pair("tnqvm-visitor", "auto")});
+  auto qreg = xacc::qalloc(4);
+  accelerator->execute(qreg, program);
+  // Z0 Z3 = 1 for the GHZ state
+  EXPECT_NEAR(qreg->getExpectationValueZ(), 1.0, 1e-6);
+  // The selected visitor is reported.
+  auto executionInfo = accelerator->getExecutionInfo();
+  EXPECT_EQ(executionInfo.getString("auto-visitor"),
+            executionInfo.getString("visitor"));
+  EXPECT_TRUE(executionInfo.keyExists<double>("auto-visitor-log2-cost"));
+}
+
+TEST(TNQVMTester, checkAutoVisitorSampling) {
+  auto xasmCompiler = xacc::getCompiler("xasm");
+  auto ir = xasmCompiler->compile(R"(__qpu__ void bell_auto(qbit q) {
+      H(q[0]);
+      CX(q[0], q[1]);
+      Measure(q[0]);
+      Measure(q[1]);
+    })");
+  auto program = ir->getComposite("bell_auto");
+  auto accelerator = xacc::getAccelerator(
+      "tnqvm", {std::make_pair("tnqvm-visitor", "auto"), std::make_pair("shots", 100)});
+  auto qreg = xacc::qalloc(2);
+  accelerator->execute(qreg, program);
+  int totalCount = 0;
+  for (const auto &[bitString, count] : qreg->getMeasurementCounts()) {
+    EXPECT_TRUE(bitString == "00" || bitString == "11");
+    totalCount += count;
+  }
+  EXPECT_EQ(totalCount, 100);
+  // Only the noiseless backends which support multi-shot sampling are
+  // candidates.
+  const auto estimates = accelerator->getExecutionInfo()
+                             .get<std::map<std::string, double>>("auto-visitor-estimates");
+  EXPECT_EQ(estimates.count("itensor-mps"), 0);
+  EXPECT_EQ(estimates.count("exatn-dm"), 0);
+  EXPECT_EQ(estimates.count("exatn-pmps"), 0);
+  EXPECT_EQ(estimates.count(accelerator->getExecutionInfo().getString("auto-visitor")), 1);
+}
+
+TEST(TNQVMTester, checkAsyncExecute) {
+  auto provider = xacc::getIRProvider("quantum");
+  auto accelerator = xacc::getAccelerator("tnqvm");
+  auto tnqvmAcc = std::static_pointer_cast<tnqvm::TNQVM>(accelerator);
+  const std::vector<double> angles{0.1, 0.7, 1.3, 2.1};
+  std::vector<std::shared_ptr<xacc::AcceleratorBuffer>> buffers;
+  std::vector<std::future<xacc::HeterogeneousMap>> futures;
+  std::atomic<int> nbCompleted(0);
+  for (const auto &angle : angles) {
+    auto f = provider->createComposite("async_" + std::to_string(buffers.size()));
+    f->addInstruction(provider->createInstruction("Ry", {0}, {angle}));
+    f->addInstruction(provider->createInstruction("CNOT", {0, 1}));
+    f->addInstruction(provider->createInstruction("Measure", 1));
+    buffers.emplace_back(xacc::qalloc(2));
+    futures.emplace_back(tnqvmAcc->executeAsync(
+        buffers.back(), f,
+        [&nbCompleted](std::shared_ptr<xacc::AcceleratorBuffer> in_buffer,
+                       const xacc::HeterogeneousMap &in_executionInfo) {
+          EXPECT_TRUE(in_buffer->hasExtraInfoKey("exp-val-z"));
+          ++nbCompleted;
+        }));
+  }
+  for (size_t i = 0; i < angles.size(); ++i) {
+    const auto executionInfo = futures[i].get();
+    EXPECT_EQ(executionInfo.getString("visitor"), tnqvmAcc->getVisitorName());
+    // <Z1> = cos(theta)
+    EXPECT_NEAR(buffers[i]->getExpectationValueZ(), std::cos(angles[i]), 1e-6);
+  }
+  EXPECT_EQ(nbCompleted, angles.size());
+}
+
+TEST(TNQVMTester, checkConcurrentExecute) {
+  auto provider = xacc::getIRProvider("quantum");
+  // One accelerator instance shared by all threads
+  auto accelerator = xacc::getAccelerator("tnqvm");
+  const std::vector<double> angles{0.2, 0.9, 1.6, 2.5, 3.0};
+  std::vector<double> results(angles.size());
+  std::vector<std::string> visitorNames(angles.size());
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < angles.size(); ++i) {
+    threads.emplace_back([&, i]() {
+      auto f = provider->createComposite("concurrent_" + std::to_string(i));
+      f->addInstruction(provider->createInstruction("Rx", {1}, {angles[i]}));
+      f->addInstruction(provider->createInstruction("Swap", {0, 1}));
+      f->addInstruction(provider->createInstruction("Measure", 0));
+      auto buffer = xacc::qalloc(2);
+      accelerator->execute(buffer, f);
+      results[i] = buffer->getExpectationValueZ();
+      visitorNames[i] = accelerator->getExecutionInfo().getString("visitor");
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  for (size_t i = 0; i < angles.size(); ++i) {
+    // <Z0> = cos(theta)
+    EXPECT_NEAR(results[i], std::cos(angles[i]), 1e-6);
+    EXPECT_EQ(visitorNames[i], "itensor-mps");
+  }
+}
+
+TEST(TNQVMTester, checkConcurrentTapeExecute) {
+  auto xasmCompiler = xacc::getCompiler("xasm");
+  auto ir = xasmCompiler->compile(R"(__qpu__ void concurrent_tape(qbit q, double t) {
+      Rx(q[1], t);
+      Swap(q[0], q[1]);
+      Measure(q[0]);
+  })");
+  auto program = ir->getComposite("concurrent_tape");
+  // One accelerator instance and one tape shared by all threads
+  auto accelerator = xacc::getAccelerator("tnqvm");
+  auto tnqvmAcc = std::static_pointer_cast<tnqvm::TNQVM>(accelerator);
+  auto tape = tnqvmAcc->compile(program);
+  const std::vector<double> angles{0.2, 0.9, 1.6, 2.5, 3.0};
+  std::vector<double> results(angles.size());
+  std::vector<std::string> visitorNames(angles.size());
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < angles.size(); ++i) {
+    threads.emplace_back([&, i]() {
+      auto buffer = xacc::qalloc(2);
+      tnqvmAcc->execute(buffer, tape, {angles[i]});
+      results[i] = buffer->getExpectationValueZ();
+      visitorNames[i] = tnqvmAcc->getExecutionInfo().getString("visitor");
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  for (size_t i = 0; i < angles.size(); ++i) {
+    // <Z0> = cos(theta)
+    EXPECT_NEAR(results[i], std::cos(angles[i]), 1e-6);
+    EXPECT_EQ(visitorNames[i], "itensor-mps");
+  }
+  // The shared tape is not bound by the executions.
+  EXPECT_FALSE(tape->isBound());
+}
+
+TEST(TNQVMTester, checkTapeOptimizationPasses) {
+  auto xasmCompiler = xacc::getCompiler("xasm");
+  auto ir = xasmCompiler->compile(R"(__qpu__ void tape_passes(qbit q, double t) {
+      X(q[0]);
+      X(q[0]);
+      Rx(q[1], t);
+      H(q[2]);
+      Measure(q[1]);
+  })");
+  auto program = ir->getComposite("tape_passes");
+  auto accelerator = xacc::getAccelerator(
+      "tnqvm", {std::make_pair("peephole", true), std::make_pair("light-cone", true)});
+  auto tnqvmAcc = std::static_pointer_cast<tnqvm::TNQVM>(accelerator);
+  // X.X cancels, H is outside the light cone of the measured qubit.
+  auto tape = tnqvmAcc->compile(program);
+  EXPECT_EQ(tape->entries().size(), 2);
+  auto buffer = xacc::qalloc(3);
+  tnqvmAcc->execute(buffer, tape, {0.7});
+  EXPECT_NEAR(buffer->getExpectationValueZ(), std::cos(0.7), 1e-6);
+  // The kernel itself is not modified.
+  EXPECT_EQ(program->nInstructions(), 5);
+}
+
+TEST(TNQVMTester, checkClusterFactorization) {
+  // Two non-interacting blocks {0, 2, 4} and {1, 3}, qubit 5 is idle.
+  auto provider = xacc::getIRProvider("quantum");
+  auto f = provider->createComposite("cluster_test");
+  f->addInstruction(provider->createInstruction("Ry", {0}, {0.3}));
+  f->addInstruction(provider->createInstruction("Ry", {1}, {1.1}));
+  f->addInstruction(provider->createInstruction("CNOT", {0, 2}));
+  f->addInstruction(provider->createInstruction("Rx", {3}, {0.7}));
+  f->addInstruction(provider->createInstruction("CNOT", {3, 1}));
+  f->addInstruction(provider->createInstruction("Ry", {4}, {0.9}));
+  f->addInstruction(provider->createInstruction("CZ", {2, 4}));
+  f->addInstruction(provider->createInstruction("H", {4}));
+  f->addInstruction(provider->createInstruction("Measure", 4));
+  f->addInstruction(provider->createInstruction("Measure", 1));
+  f->addInstruction(provider->createInstruction("Measure", 0));
+
+  auto acc = xacc::getAccelerator("tnqvm");
+  auto buffer = xacc::qalloc(6);
+  acc->execute(buffer, f);
+
+  auto clusterAcc = xacc::getAccelerator(
+      "tnqvm", {std::make_pair("cluster-factorization", true)});
+  auto clusterBuffer = xacc::qalloc(6);
+  clusterAcc->execute(clusterBuffer, f);
+  EXPECT_EQ(mpark::get<int>(clusterBuffer->getInformation("cluster-count")), 3);
+  EXPECT_EQ(mpark::get<int>(clusterBuffer->getInformation("cluster-max-qubits")), 3);
+  EXPECT_EQ(clusterAcc->getExecutionInfo().get<int>("cluster-max-qubits"), 3);
+  EXPECT_NEAR(clusterBuffer->getExpectationValueZ(), buffer->getExpectationValueZ(), 1e-6);
+}
+
+TEST(TNQVMTester, checkClusterFactorizationSampling) {
+  // Bell pair on {0, 2}, X on qubit 1 and qubit 3 is not measured: the
+  // combined samples interleave the bits of the two measured clusters.
+  auto provider = xacc::getIRProvider("quantum");
+  auto f = provider->createComposite("cluster_sampling_test");
+  f->addInstruction(provider->createInstruction("H", 0));
+  f->addInstruction(provider->createInstruction("X", 1));
+  f->addInstruction(provider->createInstruction("CNOT", {0, 2}));
+  f->addInstruction(provider->createInstruction("H", 3));
+  f->addInstruction(provider->createInstruction("Measure", 0));
+  f->addInstruction(provider->createInstruction("Measure", 1));
+  f->addInstruction(provider->createInstruction("Measure", 2));
+
+  auto clusterAcc = xacc::getAccelerator(
+      "tnqvm", {std::make_pair("cluster-factorization", true), std::make_pair("shots", 100)});
+  auto clusterBuffer = xacc::qalloc(4);
+  clusterAcc->execute(clusterBuffer, f);
+  EXPECT_EQ(mpark::get<int>(clusterBuffer->getInformation("cluster-count")), 3);
+  int totalCount = 0;
+  for (const auto &[bitString, count] : clusterBuffer->getMeasurementCounts()) {
+    EXPECT_TRUE(bitString == "010" || bitString == "111");
+    totalCount += count;
+  }
+  EXPECT_EQ(totalCount, 100);
+}
+
 int main(int argc, char **argv) {
   xacc::Initialize(argc, argv);
   ::testing::InitGoogleTest(&argc, argv);
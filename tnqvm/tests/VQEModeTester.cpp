@@ -126,6 +126,92 @@ TEST(VQEModeTester, checkUcc)
     EXPECT_NEAR(-1.13717, (*buffer)["opt-val"].as<double>(), 1e-4);
 }
 
+TEST(VQEModeTester, checkQwcGrouping)
+{
+    auto H_N_3 = xacc::quantum::getObservable(
+        "pauli",
+        std::string("5.907 - 2.1433 X0X1 - 2.1433 Y0Y1 + .21829 Z0 - 6.125 Z1 + "
+                    "9.625 - 9.625 Z2 - 3.91 X1 X2 - 3.91 Y1 Y2"));
+    xacc::qasm(R"(
+        .compiler xasm
+        .circuit deuteron_ansatz_qwc
+        .parameters t0, t1
+        .qbit q
+        X(q[0]);
+        exp_i_theta(q, t0, {{"pauli", "X0 Y1 - Y0 X1"}});
+        exp_i_theta(q, t1, {{"pauli", "X0 Z1 Y2 - X2 Z1 Y0"}});
+    )");
+    auto ansatz = xacc::getCompiled("deuteron_ansatz_qwc");
+    auto kernels = H_N_3->observe((*ansatz)({0.5, -0.3}));
+
+    auto accGrouped = xacc::getAccelerator("tnqvm", { std::make_pair("tnqvm-visitor", "exatn") });
+    auto bufferGrouped = xacc::qalloc(3);
+    accGrouped->execute(bufferGrouped, kernels);
+    // {X0X1, X1X2}, {Y0Y1, Y1Y2}, {Z0, Z1, Z2}
+    EXPECT_EQ(accGrouped->getExecutionInfo().get<int>("vqe-num-qwc-groups"), 3);
+
+    auto accRef = xacc::getAccelerator("tnqvm", { std::make_pair("tnqvm-visitor", "exatn"), std::make_pair("qwc-grouping", false) });
+    auto bufferRef = xacc::qalloc(3);
+    accRef->execute(bufferRef, kernels);
+
+    const auto childrenGrouped = bufferGrouped->getChildren();
+    const auto childrenRef = bufferRef->getChildren();
+    EXPECT_EQ(childrenGrouped.size(), kernels.size());
+    EXPECT_EQ(childrenGrouped.size(), childrenRef.size());
+    for (size_t i = 0; i < childrenRef.size(); ++i) {
+        EXPECT_EQ(childrenGrouped[i]->name(), childrenRef[i]->name());
+        EXPECT_NEAR(childrenGrouped[i]->getExpectationValueZ(), childrenRef[i]->getExpectationValueZ(), 1e-9);
+    }
+}
+
+TEST(VQEModeTester, checkLightCone)
+{
+    // Shallow brickwork circuit: local terms have small light cones.
+    const size_t nbQubits = 10;
+    auto provider = xacc::getIRProvider("quantum");
+    auto ansatz = provider->createComposite("brickwork_ansatz");
+    for (size_t i = 0; i < nbQubits; ++i) {
+        ansatz->addInstruction(provider->createInstruction("H", i));
+    }
+    for (const size_t offset : {0, 1}) {
+        for (size_t i = offset; i + 1 < nbQubits; i += 2) {
+            ansatz->addInstruction(provider->createInstruction("CNOT", {i, i + 1}));
+            ansatz->addInstruction(provider->createInstruction("Rz", {i + 1}, {0.1 * (i + 1)}));
+            ansatz->addInstruction(provider->createInstruction("CNOT", {i, i + 1}));
+        }
+    }
+    for (size_t i = 0; i < nbQubits; ++i) {
+        ansatz->addInstruction(provider->createInstruction("Rx", {i}, {0.3}));
+    }
+
+    std::string hamStr;
+    for (size_t i = 0; i + 1 < nbQubits; ++i) {
+        hamStr += " + Z" + std::to_string(i) + " Z" + std::to_string(i + 1) + " + 0.5 X" + std::to_string(i);
+    }
+    auto H = xacc::quantum::getObservable("pauli", hamStr);
+    auto kernels = H->observe(ansatz);
+
+    auto accLightCone = xacc::getAccelerator("tnqvm", { std::make_pair("tnqvm-visitor", "exatn"), std::make_pair("light-cone", true) });
+    auto bufferLightCone = xacc::qalloc(nbQubits);
+    accLightCone->execute(bufferLightCone, kernels);
+    const auto info = accLightCone->getExecutionInfo();
+    // Largest cone: Z_i Z_{i+1} spans 6 qubits.
+    EXPECT_LE(info.get<int>("light-cone-max-qubits"), 6);
+    EXPECT_GT(info.get<int>("light-cone-groups"), 1);
+
+    auto accRef = xacc::getAccelerator("tnqvm", { std::make_pair("tnqvm-visitor", "exatn"), std::make_pair("light-cone", false) });
+    auto bufferRef = xacc::qalloc(nbQubits);
+    accRef->execute(bufferRef, kernels);
+
+    const auto childrenLightCone = bufferLightCone->getChildren();
+    const auto childrenRef = bufferRef->getChildren();
+    EXPECT_EQ(childrenLightCone.size(), childrenRef.size());
+    for (size_t i = 0; i < childrenRef.size(); ++i) {
+        EXPECT_EQ(childrenLightCone[i]->name(), childrenRef[i]->name());
+        EXPECT_NEAR(childrenLightCone[i]->getExpectationValueZ(), childrenRef[i]->getExpectationValueZ(), 1e-9);
+    }
+}
+
 int main(int argc, char **argv) 
 {
     xacc::set_verbose(true);   
@@ -0,0 +1,299 @@
+/***********************************************************************************
+ * Copyright (c) 2020, UT-Battelle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the xacc nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ **********************************************************************************/
+
+// Circuit structure analysis: header-only and independent of the IR, a circuit
+// being given by the list of qubits of each gate.
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <numeric>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace tnqvm {
+namespace lightcone {
+// Backward light cone of a set of qubits at the end of a gate sequence (each
+// gate given by the list of qubits it acts on).
+// Returns the (ascending) indices of the gates which can affect the reduced
+// state of those qubits; all other gates cancel against their conjugates in
+// <psi|O|psi> for any observable O supported on those qubits.
+inline std::vector<size_t>
+computeLightCone(const std::vector<std::vector<size_t>> &in_gateQubits,
+                 const std::vector<size_t> &in_qubits,
+                 std::set<size_t> *out_coneQubits = nullptr) {
+  std::set<size_t> coneQubits(in_qubits.begin(), in_qubits.end());
+  std::vector<size_t> result;
+  for (size_t i = in_gateQubits.size(); i-- > 0;) {
+    const auto &qubits = in_gateQubits[i];
+    const bool isInCone =
+        std::any_of(qubits.begin(), qubits.end(), [&](size_t in_qubit) {
+          return coneQubits.count(in_qubit) > 0;
+        });
+    if (isInCone) {
+      coneQubits.insert(qubits.begin(), qubits.end());
+      result.emplace_back(i);
+    }
+  }
+  std::reverse(result.begin(), result.end());
+  if (out_coneQubits) {
+    *out_coneQubits = std::move(coneQubits);
+  }
+  return result;
+}
+} // namespace lightcone
+
+namespace clusters {
+// Connected components of the interaction graph of a gate sequence (each gate
+// given by the list of qubits it acts on) on in_nbQubits qubits.
+// Qubits that no multi-qubit gate connects form singleton clusters.
+// Returns the clusters ordered by their smallest qubit, each one in ascending
+// qubit order.
+inline std::vector<std::vector<size_t>>
+computeQubitClusters(size_t in_nbQubits,
+                     const std::vector<std::vector<size_t>> &in_gateQubits) {
+  std::vector<size_t> parent(in_nbQubits);
+  std::iota(parent.begin(), parent.end(), 0);
+  const auto findRoot = [&parent](size_t in_qubit) {
+    while (parent[in_qubit] != in_qubit) {
+      // Path halving
+      parent[in_qubit] = parent[parent[in_qubit]];
+      in_qubit = parent[in_qubit];
+    }
+    return in_qubit;
+  };
+  for (const auto &qubits : in_gateQubits) {
+    for (size_t i = 1; i < qubits.size(); ++i) {
+      assert(qubits[0] < in_nbQubits && qubits[i] < in_nbQubits);
+      const size_t root0 = findRoot(qubits[0]);
+      const size_t rooti = findRoot(qubits[i]);
+      // The smallest qubit is the root: clusters come out in order.
+      parent[std::max(root0, rooti)] = std::min(root0, rooti);
+    }
+  }
+
+  std::vector<std::vector<size_t>> result;
+  std::map<size_t, size_t> rootToCluster;
+  for (size_t qubit = 0; qubit < in_nbQubits; ++qubit) {
+    const auto [iter, isNewCluster] =
+        rootToCluster.emplace(findRoot(qubit), result.size());
+    if (isNewCluster) {
+      result.emplace_back();
+    }
+    result[iter->second].emplace_back(qubit);
+  }
+  return result;
+}
+
+// Combine the samples of independent clusters into samples of the whole
+// circuit: the i-th combined bit string is made of the i-th bit string of each
+// cluster (all clusters must have the same number of samples).
+// in_bitSources gives, for each bit of the combined bit strings, the cluster
+// and the bit position in that cluster's bit strings (clusters which are not
+// referenced may have no samples).
+inline std::vector<std::string> combineSamples(
+    const std::vector<std::vector<std::string>> &in_clusterSamples,
+    const std::vector<std::pair<size_t, size_t>> &in_bitSources) {
+  if (in_bitSources.empty()) {
+    return {};
+  }
+  const size_t nbSamples =
+      in_clusterSamples[in_bitSources.front().first].size();
+  std::vector<std::string> result(nbSamples,
+                                  std::string(in_bitSources.size(), '0'));
+  for (size_t i = 0; i < nbSamples; ++i) {
+    for (size_t bitIdx = 0; bitIdx < in_bitSources.size(); ++bitIdx) {
+      const auto &[clusterIdx, clusterBitIdx] = in_bitSources[bitIdx];
+      assert(in_clusterSamples[clusterIdx].size() == nbSamples);
+      result[i][bitIdx] = in_clusterSamples[clusterIdx][i][clusterBitIdx];
+    }
+  }
+  return result;
+}
+} // namespace clusters
+
+namespace selection {
+// Cheap cost model to select the visitor backend for a circuit
+// (tnqvm-visitor=auto).
+struct CircuitProfile {
+  size_t nbQubits = 0;
+  size_t nbGates = 0;
+  size_t nbTwoQubitGates = 0;
+  // Max distance between the qubits of a two-qubit gate
+  size_t bandwidth = 0;
+  // Sum of the distances of two-qubit gates (linear qubit order)
+  size_t totalDistance = 0;
+  // Max number of two-qubit gates across any cut (i, i + 1) of the linear
+  // qubit order: bounds the MPS bond dimension (log2).
+  size_t maxCutGates = 0;
+  // Number of kernels to execute
+  size_t nbKernels = 1;
+  bool hasNoiseModel = false;
+  // Multi-shot sampling requested
+  bool needsSampling = false;
+  // VQE mode: expectation values of observed sub-circuits of the same ansatz
+  bool isVqe = false;
+};
+
+// Profile a circuit, given the qubits of each gate (in order).
+inline CircuitProfile
+profileCircuit(const std::vector<std::vector<size_t>> &in_gateQubits,
+               size_t in_nbQubits) {
+  CircuitProfile profile;
+  profile.nbQubits = in_nbQubits;
+  profile.nbGates = in_gateQubits.size();
+  std::vector<size_t> cutGates(in_nbQubits, 0);
+  for (const auto &qubits : in_gateQubits) {
+    if (qubits.size() < 2) {
+      continue;
+    }
+    const auto minMax = std::minmax_element(qubits.begin(), qubits.end());
+    const size_t distance = *minMax.second - *minMax.first;
+    ++profile.nbTwoQubitGates;
+    profile.bandwidth = std::max(profile.bandwidth, distance);
+    profile.totalDistance += distance;
+    for (size_t cut = *minMax.first; cut < *minMax.second; ++cut) {
+      if (cut < cutGates.size()) {
+        ++cutGates[cut];
+      }
+    }
+  }
+  if (!cutGates.empty()) {
+    profile.maxCutGates = *std::max_element(cutGates.begin(), cutGates.end());
+  }
+  return profile;
+}
+
+struct BackendEstimate {
+  std::string backend;
+  bool isFeasible = false;
+  // Estimated (log2) number of floating-point operations and memory (bytes)
+  double log2Cost = 0.0;
+  double log2Memory = 0.0;
+};
+
+struct Decision {
+  // Empty if none of the available backends is applicable.
+  std::string backend;
+  std::vector<BackendEstimate> estimates;
+};
+
+// Estimate the cost of each available backend and select the cheapest
+// feasible one (i.e. fitting in the memory budget and supporting the
+// requested features). If none is feasible, the one requiring the least
+// memory is selected. Ties are resolved in the order of the given backends.
+inline Decision selectBackend(const CircuitProfile &in_profile,
+                              const std::vector<std::string> &in_backends,
+                              double in_memoryBytes) {
+  // Bytes per amplitude (double-precision complex) and a factor 2 for
+  // intermediate tensors.
+  constexpr double LOG2_BYTES_PER_ELEMENT = 4.0 + 1.0;
+  const double n = in_profile.nbQubits;
+  const double log2MemoryBudget = std::log2(std::max(in_memoryBytes, 1.0));
+  const double log2Gates = std::log2(std::max<double>(in_profile.nbGates, 1.0));
+  // Kernels are simulated one at a time, except VQE mode on a backend which
+  // supports it (the ansatz is simulated once).
+  const double log2Kernels =
+      std::log2(std::max<double>(in_profile.nbKernels, 1.0));
+  // Bond dimension (log2) of a pure-state MPS, and the number of gates
+  // including the swaps to make two-qubit gates nearest-neighbor.
+  const double log2BondDim =
+      std::min<double>(in_profile.maxCutGates, std::floor(n / 2.0));
+  const double log2MpsGates = std::log2(std::max<double>(
+      in_profile.nbGates + 2 * (in_profile.totalDistance -
+                                in_profile.nbTwoQubitGates),
+      1.0));
+
+  Decision decision;
+  for (const auto &backend : in_backends) {
+    BackendEstimate estimate;
+    estimate.backend = backend;
+    bool isApplicable = true;
+    if (backend == "exatn") {
+      // Full state vector
+      isApplicable = !in_profile.hasNoiseModel;
+      estimate.log2Memory = n + LOG2_BYTES_PER_ELEMENT;
+      estimate.log2Cost = n + log2Gates + (in_profile.isVqe ? 0.0 : log2Kernels);
+    } else if (backend == "itensor-mps" || backend == "exatn-mps") {
+      // Multi-shot sampling is not supported by the ITensor MPS backend.
+      isApplicable = !in_profile.hasNoiseModel &&
+                     !(in_profile.needsSampling && backend == "itensor-mps");
+      estimate.log2Memory =
+          std::log2(std::max(n, 1.0)) + 2.0 * log2BondDim + LOG2_BYTES_PER_ELEMENT;
+      estimate.log2Cost = 3.0 * log2BondDim + log2MpsGates + log2Kernels;
+    } else if (backend == "exatn-dm") {
+      // Full density matrix
+      isApplicable = in_profile.hasNoiseModel;
+      estimate.log2Memory = 2.0 * n + LOG2_BYTES_PER_ELEMENT;
+      estimate.log2Cost = 2.0 * n + log2Gates + log2Kernels;
+    } else if (backend == "exatn-pmps") {
+      // Purified MPS: an extra (Kraus) leg of dimension <= 4 per site, the
+      // bond dimension grows with the purification.
+      isApplicable = in_profile.hasNoiseModel;
+      const double log2PurifiedBondDim = std::min(2.0 * log2BondDim, n);
+      estimate.log2Memory = std::log2(std::max(n, 1.0)) +
+                            2.0 * log2PurifiedBondDim + 2.0 +
+                            LOG2_BYTES_PER_ELEMENT;
+      estimate.log2Cost =
+          3.0 * log2PurifiedBondDim + 2.0 + log2MpsGates + log2Kernels;
+    } else {
+      // Unknown backend: no cost model.
+      continue;
+    }
+    if (!isApplicable) {
+      continue;
+    }
+    estimate.isFeasible = estimate.log2Memory <= log2MemoryBudget;
+    decision.estimates.emplace_back(estimate);
+  }
+
+  const BackendEstimate *best = nullptr;
+  for (const auto &estimate : decision.estimates) {
+    if (estimate.isFeasible &&
+        (!best || estimate.log2Cost < best->log2Cost)) {
+      best = &estimate;
+    }
+  }
+  if (!best) {
+    for (const auto &estimate : decision.estimates) {
+      if (!best || estimate.log2Memory < best->log2Memory) {
+        best = &estimate;
+      }
+    }
+  }
+  if (best) {
+    decision.backend = best->backend;
+  }
+  return decision;
+}
+} // namespace selection
+} // namespace tnqvm
@@ -0,0 +1,490 @@
+/***********************************************************************************
+ * Copyright (c) 2020, UT-Battelle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the xacc nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ **********************************************************************************/
+// Tensor network contraction planning: header-only and independent of ExaTN
+// and of the communication layer (costs and collective operations are
+// provided by the caller).
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <set>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace tnqvm {
+namespace slicing {
+// Distribution of tensor network slices (independent projections of the
+// network) among processes.
+
+// Static schedule: contiguous block [begin, end) of slices of a process.
+// If not evenly divided, process 0 gets the remainder. If there are more
+// processes than slices, the excess processes get an empty block.
+inline std::pair<int64_t, int64_t> getStaticBlock(int64_t in_nbSlices,
+                                                  int in_processRank,
+                                                  int in_nbProcesses) {
+  assert(in_processRank >= 0 && in_processRank < in_nbProcesses);
+  const int64_t nbProcessesToUse =
+      std::min<int64_t>(in_nbSlices, in_nbProcesses);
+  if (in_processRank >= nbProcessesToUse) {
+    return std::make_pair(in_nbSlices, in_nbSlices);
+  }
+  const int64_t nbSlicesPerProcess = in_nbSlices / nbProcessesToUse;
+  const int64_t nbSlicesProcess0 =
+      nbSlicesPerProcess + in_nbSlices % nbProcessesToUse;
+  if (in_processRank == 0) {
+    return std::make_pair(int64_t(0), nbSlicesProcess0);
+  }
+  const int64_t begin =
+      nbSlicesProcess0 + (in_processRank - 1) * nbSlicesPerProcess;
+  return std::make_pair(begin, begin + nbSlicesPerProcess);
+}
+
+// Guided self-scheduling chunk size: a fraction of the remaining slices per
+// process, i.e. large chunks first (less contention on the shared counter)
+// and small ones at the end (to even out the finish times).
+inline int64_t getGuidedChunkSize(int64_t in_nbRemainingSlices,
+                                  int in_nbProcesses,
+                                  int64_t in_minChunkSize = 1) {
+  assert(in_nbProcesses > 0 && in_minChunkSize > 0);
+  const int64_t divisor = 2 * static_cast<int64_t>(in_nbProcesses);
+  const int64_t chunkSize =
+      (std::max<int64_t>(in_nbRemainingSlices, 0) + divisor - 1) / divisor;
+  return std::max(chunkSize, in_minChunkSize);
+}
+
+// Dynamic schedule: processes claim chunks of slices from a shared counter.
+// The fetch-and-add functor atomically adds its argument to the shared counter
+// and returns the previous value (e.g. an MPI one-sided atomic).
+// The chunk size is based on the last counter value seen by this process,
+// hence a claim can overshoot the end: the chunk is then truncated.
+class DynamicChunkScheduler {
+public:
+  DynamicChunkScheduler(int64_t in_nbSlices, int in_nbProcesses,
+                        std::function<int64_t(int64_t)> in_fetchAndAdd,
+                        int64_t in_minChunkSize = 1)
+      : m_nbSlices(in_nbSlices), m_nbProcesses(in_nbProcesses),
+        m_minChunkSize(in_minChunkSize),
+        m_fetchAndAdd(std::move(in_fetchAndAdd)), m_lastSeenCounter(0) {}
+
+  // Claims the next chunk [out_begin, out_end).
+  // Returns false if there are no slices left.
+  bool claimChunk(int64_t &out_begin, int64_t &out_end) {
+    if (m_lastSeenCounter >= m_nbSlices) {
+      return false;
+    }
+    const int64_t chunkSize = getGuidedChunkSize(
+        m_nbSlices - m_lastSeenCounter, m_nbProcesses, m_minChunkSize);
+    const int64_t begin = m_fetchAndAdd(chunkSize);
+    m_lastSeenCounter = begin + chunkSize;
+    if (begin >= m_nbSlices) {
+      return false;
+    }
+    out_begin = begin;
+    out_end = std::min(begin + chunkSize, m_nbSlices);
+    return true;
+  }
+
+private:
+  int64_t m_nbSlices;
+  int m_nbProcesses;
+  int64_t m_minChunkSize;
+  std::function<int64_t(int64_t)> m_fetchAndAdd;
+  int64_t m_lastSeenCounter;
+};
+
+// Greedy selection of the indices to slice in a tensor network contraction.
+
+// Estimated cost of a single slice: fused multiply-add flops and the peak
+// volume (number of elements) of the intermediate tensors.
+struct SliceCost {
+  double flops;
+  double peakVolume;
+};
+
+// Index candidates: [0, in_nbOpenCandidates) are the open (output) indices,
+// [in_nbOpenCandidates, in_nbOpenCandidates + in_nbBondCandidates) are the
+// internal bonds. All indices have dimension 2, i.e. each sliced index doubles
+// the number of slices.
+// The cost functor returns the cost of one slice given the list of sliced
+// indices.
+// Selection:
+// (1) While the peak volume is over budget: slice the index which reduces it
+// the most (ties broken by the total flops). Stops if no index reduces it.
+// (2) While fewer than in_minOpenIndices open indices are sliced: slice the
+// open index with the lowest total flops.
+// (3) Then, keep slicing as long as it reduces the total flops
+// (flops x number of slices).
+// At most in_maxEvaluationsPerStep candidates (evenly spaced) are evaluated at
+// each step. Returns the sliced indices (ascending order) and their cost
+// (out_cost); the caller must check the cost against the budget.
+inline std::vector<size_t> selectSlicedIndices(
+    size_t in_nbOpenCandidates, size_t in_nbBondCandidates,
+    size_t in_minOpenIndices, double in_maxPeakVolume,
+    const std::function<SliceCost(const std::vector<size_t> &)> &in_costFunc,
+    size_t in_maxEvaluationsPerStep, SliceCost &out_cost) {
+  assert(in_minOpenIndices <= in_nbOpenCandidates);
+  assert(in_maxEvaluationsPerStep > 0);
+  const size_t nbCandidates = in_nbOpenCandidates + in_nbBondCandidates;
+  const auto getTotalFlops = [](const SliceCost &in_cost,
+                                size_t in_nbSlicedIndices) {
+    return in_cost.flops * std::pow(2.0, in_nbSlicedIndices);
+  };
+
+  std::vector<size_t> selected;
+  std::vector<bool> isSelected(nbCandidates, false);
+  size_t nbOpenSelected = 0;
+  SliceCost currentCost = in_costFunc(selected);
+  while (selected.size() < nbCandidates) {
+    const bool isOverBudget = currentCost.peakVolume > in_maxPeakVolume;
+    const bool needsOpenIndex =
+        !isOverBudget && nbOpenSelected < in_minOpenIndices;
+    std::vector<size_t> eligible;
+    const size_t nbEligibleCandidates =
+        needsOpenIndex ? in_nbOpenCandidates : nbCandidates;
+    for (size_t i = 0; i < nbEligibleCandidates; ++i) {
+      if (!isSelected[i]) {
+        eligible.emplace_back(i);
+      }
+    }
+    if (eligible.empty()) {
+      break;
+    }
+    if (eligible.size() > in_maxEvaluationsPerStep) {
+      std::vector<size_t> subset;
+      for (size_t k = 0; k < in_maxEvaluationsPerStep; ++k) {
+        subset.emplace_back(
+            eligible[k * eligible.size() / in_maxEvaluationsPerStep]);
+      }
+      eligible = std::move(subset);
+    }
+
+    size_t bestCandidate = nbCandidates;
+    SliceCost bestCost{std::numeric_limits<double>::max(),
+                       std::numeric_limits<double>::max()};
+    const auto isBetter = [&](const SliceCost &in_lhs,
+                              const SliceCost &in_rhs) {
+      const double lhsTotal = getTotalFlops(in_lhs, selected.size() + 1);
+      const double rhsTotal = getTotalFlops(in_rhs, selected.size() + 1);
+      if (isOverBudget && in_lhs.peakVolume != in_rhs.peakVolume) {
+        return in_lhs.peakVolume < in_rhs.peakVolume;
+      }
+      return lhsTotal < rhsTotal;
+    };
+    for (const auto &candidate : eligible) {
+      auto trial = selected;
+      trial.emplace_back(candidate);
+      const SliceCost cost = in_costFunc(trial);
+      if (bestCandidate == nbCandidates || isBetter(cost, bestCost)) {
+        bestCandidate = candidate;
+        bestCost = cost;
+      }
+    }
+
+    const bool isImprovement =
+        isOverBudget ? (bestCost.peakVolume < currentCost.peakVolume)
+                     : (needsOpenIndex ||
+                        getTotalFlops(bestCost, selected.size() + 1) <
+                            getTotalFlops(currentCost, selected.size()));
+    if (!isImprovement) {
+      break;
+    }
+    selected.emplace_back(bestCandidate);
+    isSelected[bestCandidate] = true;
+    if (bestCandidate < in_nbOpenCandidates) {
+      ++nbOpenSelected;
+    }
+    currentCost = bestCost;
+  }
+  std::sort(selected.begin(), selected.end());
+  out_cost = currentCost;
+  return selected;
+}
+} // namespace slicing
+
+namespace contraction {
+// Persistent (on-disk) cache of tensor network contraction sequences.
+//
+// A contraction sequence only depends on the topology of the network (tensor
+// shapes and connectivity), not on the tensor names or bodies (e.g. gate
+// parameters). Hence, it is keyed by a hash of the topology and can be reused
+// by later runs of the same circuit family.
+//
+// One file per network topology and optimizer in the cache directory:
+// "<hash>.<optimizer>.seq", a text file with a header line, the hash, the FMA
+// flops of the sequence and then one "<result> <left> <right>" tensor id
+// triple per line.
+
+// Pairwise contraction: result tensor id <- (left tensor id, right tensor id)
+struct ContractionTriple {
+  unsigned int result;
+  unsigned int left;
+  unsigned int right;
+};
+
+// Topology of a tensor of the network:
+// the dimension extents and, for each dimension, the connected
+// (tensor id, dimension id).
+struct TensorNode {
+  unsigned int id;
+  std::vector<uint64_t> extents;
+  std::vector<std::pair<unsigned int, unsigned int>> legs;
+  bool conjugated;
+};
+
+constexpr const char *SEQUENCE_FILE_HEADER = "tnqvm-contraction-sequence 1";
+
+// FNV-1a hash (64-bit) of a value, byte by byte.
+inline void hashCombine(uint64_t &io_hash, uint64_t in_value) {
+  constexpr uint64_t FNV_PRIME = 1099511628211ULL;
+  for (int i = 0; i < 8; ++i) {
+    io_hash ^= (in_value >> (8 * i)) & 0xFF;
+    io_hash *= FNV_PRIME;
+  }
+}
+
+// Hash of the network topology. The tensor ids are part of the topology since
+// the contraction sequence refers to them: the same circuit is always
+// converted to the same tensor ids, regardless of the gate parameters.
+inline uint64_t getTopologyHash(std::vector<TensorNode> in_nodes) {
+  // Tensor networks are unordered maps: sort by id.
+  std::sort(in_nodes.begin(), in_nodes.end(),
+            [](const TensorNode &lhs, const TensorNode &rhs) {
+              return lhs.id < rhs.id;
+            });
+  uint64_t hash = 14695981039346656037ULL;
+  hashCombine(hash, in_nodes.size());
+  for (const auto &node : in_nodes) {
+    hashCombine(hash, node.id);
+    hashCombine(hash, node.conjugated);
+    hashCombine(hash, node.extents.size());
+    for (const auto &extent : node.extents) {
+      hashCombine(hash, extent);
+    }
+    hashCombine(hash, node.legs.size());
+    for (const auto &[tensorId, dimId] : node.legs) {
+      hashCombine(hash, tensorId);
+      hashCombine(hash, dimId);
+    }
+  }
+  return hash;
+}
+
+inline std::string getHashString(uint64_t in_hash) {
+  char buffer[17];
+  std::snprintf(buffer, sizeof(buffer), "%016llx",
+                static_cast<unsigned long long>(in_hash));
+  return buffer;
+}
+
+inline std::string getSequenceFilePath(const std::string &in_cacheDir,
+                                       uint64_t in_hash,
+                                       const std::string &in_optimizerName) {
+  return in_cacheDir + "/" + getHashString(in_hash) + "." + in_optimizerName +
+         ".seq";
+}
+
+// Check that the sequence contracts the input tensors of the network (the
+// tensor nodes excluding the output tensor, id 0) down to a single tensor.
+// Guards against hash collisions and stale files.
+inline bool isValidSequence(const std::vector<TensorNode> &in_nodes,
+                            const std::vector<ContractionTriple> &in_sequence) {
+  std::set<unsigned int> available;
+  for (const auto &node : in_nodes) {
+    if (node.id != 0) {
+      available.emplace(node.id);
+    }
+  }
+  if (available.size() != in_sequence.size() + 1) {
+    return false;
+  }
+  for (const auto &triple : in_sequence) {
+    if (triple.left == triple.right || available.erase(triple.left) == 0 ||
+        available.erase(triple.right) == 0 ||
+        !available.emplace(triple.result).second) {
+      return false;
+    }
+  }
+  return available.size() == 1;
+}
+
+// Returns false if there is no (valid) cached sequence for this hash.
+inline bool loadSequence(const std::string &in_filePath, uint64_t in_hash,
+                         std::vector<ContractionTriple> &out_sequence,
+                         double &out_flops) {
+  std::ifstream file(in_filePath);
+  if (!file) {
+    return false;
+  }
+  std::string header;
+  std::string hashString;
+  if (!std::getline(file, header) || header != SEQUENCE_FILE_HEADER ||
+      !(file >> hashString) || hashString != getHashString(in_hash) ||
+      !(file >> out_flops)) {
+    return false;
+  }
+  out_sequence.clear();
+  ContractionTriple triple;
+  while (file >> triple.result >> triple.left >> triple.right) {
+    out_sequence.emplace_back(triple);
+  }
+  // Must have reached the end of the file (no trailing garbage).
+  return file.eof() && !out_sequence.empty();
+}
+
+// Create the directory and its parents (if needed).
+inline bool createDirectories(const std::string &in_dir) {
+  for (size_t pos = in_dir.find('/', 1);; pos = in_dir.find('/', pos + 1)) {
+    const std::string dir = in_dir.substr(0, pos);
+    if (!dir.empty() && ::mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+      return false;
+    }
+    if (pos == std::string::npos) {
+      return true;
+    }
+  }
+}
+
+// Write to a temporary file then rename it: concurrent jobs sharing the cache
+// directory never read a partially written file.
+inline bool storeSequence(const std::string &in_filePath, uint64_t in_hash,
+                          const std::vector<ContractionTriple> &in_sequence,
+                          double in_flops) {
+  const auto dirEnd = in_filePath.rfind('/');
+  if (dirEnd != std::string::npos &&
+      !createDirectories(in_filePath.substr(0, dirEnd))) {
+    return false;
+  }
+  std::ostringstream content;
+  content.precision(17);
+  content << SEQUENCE_FILE_HEADER << "\n"
+          << getHashString(in_hash) << "\n"
+          << in_flops << "\n";
+  for (const auto &triple : in_sequence) {
+    content << triple.result << " " << triple.left << " " << triple.right
+            << "\n";
+  }
+  // Unique per process and thread: concurrent writers (e.g. visitors of the
+  // same process) each use their own temporary file.
+  const std::string tempFilePath =
+      in_filePath + ".tmp" + std::to_string(::getpid()) + "-" +
+      std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+  {
+    std::ofstream file(tempFilePath, std::ios::trunc);
+    if (!(file << content.str()) || !file.flush()) {
+      std::remove(tempFilePath.c_str());
+      return false;
+    }
+  }
+  if (std::rename(tempFilePath.c_str(), in_filePath.c_str()) != 0) {
+    std::remove(tempFilePath.c_str());
+    return false;
+  }
+  return true;
+}
+
+// Portfolio search of tensor network contraction sequences: several
+// optimizers (and restarts of the randomized ones) are run within a wall-clock
+// budget and the cheapest sequence is kept. A run is an arbitrary functor.
+
+// Result of an optimizer run.
+struct PathCandidate {
+  // Optimizer name and restart index
+  std::string optimizer;
+  int restart;
+  // Estimated FMA flops and peak volume (elements) of the sequence
+  double flops;
+  double peakVolume;
+};
+
+// Index of the cheapest (flops) candidate whose peak volume is within the
+// limit. If none fits, the one with the smallest peak volume.
+inline size_t selectBestCandidate(const std::vector<PathCandidate> &in_candidates,
+                                  double in_maxPeakVolume) {
+  assert(!in_candidates.empty());
+  size_t bestIdx = 0;
+  bool bestFits = in_candidates[0].peakVolume <= in_maxPeakVolume;
+  for (size_t i = 1; i < in_candidates.size(); ++i) {
+    const auto &candidate = in_candidates[i];
+    const auto &best = in_candidates[bestIdx];
+    const bool fits = candidate.peakVolume <= in_maxPeakVolume;
+    const bool isBetter =
+        (fits && !bestFits) ||
+        (fits && bestFits && candidate.flops < best.flops) ||
+        (!fits && !bestFits && candidate.peakVolume < best.peakVolume);
+    if (isBetter) {
+      bestIdx = i;
+      bestFits = fits;
+    }
+  }
+  return bestIdx;
+}
+
+// Run the portfolio: restart r of optimizer k is the task r * nbOptimizers + k,
+// i.e. each optimizer runs once before any restart. The first run of each
+// optimizer is always done (there is always an answer); restarts are only
+// started before the deadline. Runs can't be interrupted, hence the wall-clock
+// time may exceed the limit by one run.
+// The runs are sequential, on the calling thread: the optimizers (ExaTN) are
+// not thread-safe, and an exception thrown by a run is propagated to the
+// caller.
+// Returns the completed candidates, in task order.
+inline std::vector<PathCandidate> runPortfolio(
+    const std::vector<std::string> &in_optimizers, int in_maxRestarts,
+    std::chrono::duration<double> in_timeLimit,
+    const std::function<PathCandidate(const std::string &, int)> &in_runFunc) {
+  const size_t nbOptimizers = in_optimizers.size();
+  const size_t nbTasks = nbOptimizers * std::max(in_maxRestarts, 1);
+  const auto deadline = std::chrono::steady_clock::now() +
+                        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                            in_timeLimit);
+  std::vector<PathCandidate> completed;
+  for (size_t taskIdx = 0; taskIdx < nbTasks; ++taskIdx) {
+    if (taskIdx >= nbOptimizers &&
+        std::chrono::steady_clock::now() >= deadline) {
+      break;
+    }
+    const int restart = taskIdx / nbOptimizers;
+    completed.emplace_back(
+        in_runFunc(in_optimizers[taskIdx % nbOptimizers], restart));
+  }
+  return completed;
+}
+} // namespace contraction
+} // namespace tnqvm
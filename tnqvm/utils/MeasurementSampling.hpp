@@ -0,0 +1,397 @@
+/***********************************************************************************
+ * Copyright (c) 2020, UT-Battelle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the xacc nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ **********************************************************************************/
+
+// Amplitude evaluation and measurement sampling strategies of the tensor
+// network visitors: header-only and independent of ExaTN (the contractions
+// are provided by the caller).
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <numeric>
+#include <random>
+#include <vector>
+
+namespace tnqvm {
+namespace batching {
+// Batched evaluation of bit string amplitudes: bit strings that share most of
+// their bits are evaluated by a single contraction, projecting the common
+// qubits and leaving the differing ones open (a wave-function slice).
+
+// Don't open more than this many legs per requested amplitude on average:
+// the output (and the contraction) of a slice grows with the open legs.
+constexpr size_t DEFAULT_MAX_AMPLITUDES_PER_BIT_STRING = 16;
+
+struct AmplitudeBatch {
+  // Bits of the slice: the common bits of the batch, -1 for open qubits.
+  std::vector<int> bitString;
+  // Index of each member in the input list and index of its amplitude in the
+  // slice (bit k is the value of the k-th open qubit in increasing order).
+  std::vector<size_t> members;
+  std::vector<uint64_t> sliceIndices;
+};
+
+// Qubits whose bit is not the same in all the bit strings of the group.
+inline std::vector<size_t>
+getVaryingQubits(const std::vector<std::vector<int>> &in_bitStrings,
+                 const std::vector<size_t> &in_group) {
+  assert(!in_group.empty());
+  const auto &first = in_bitStrings[in_group.front()];
+  std::vector<size_t> varyingQubits;
+  for (size_t qubit = 0; qubit < first.size(); ++qubit) {
+    if (std::any_of(in_group.begin(), in_group.end(), [&](size_t idx) {
+          return in_bitStrings[idx][qubit] != first[qubit];
+        })) {
+      varyingQubits.emplace_back(qubit);
+    }
+  }
+  return varyingQubits;
+}
+
+inline AmplitudeBatch makeBatch(const std::vector<std::vector<int>> &in_bitStrings,
+                                const std::vector<size_t> &in_group,
+                                const std::vector<size_t> &in_openQubits) {
+  AmplitudeBatch batch;
+  batch.bitString = in_bitStrings[in_group.front()];
+  for (const auto &qubit : in_openQubits) {
+    batch.bitString[qubit] = -1;
+  }
+  batch.members = in_group;
+  for (const auto &idx : in_group) {
+    uint64_t sliceIdx = 0;
+    for (size_t k = 0; k < in_openQubits.size(); ++k) {
+      if (in_bitStrings[idx][in_openQubits[k]] == 1) {
+        sliceIdx |= (1ULL << k);
+      }
+    }
+    batch.sliceIndices.emplace_back(sliceIdx);
+  }
+  return batch;
+}
+
+// Partition the bit strings (same length, 0/1 values) into batches:
+// a group is evaluated as one slice if it has at most in_maxOpenQubits varying
+// qubits and the slice has at most in_maxAmplitudesPerBitString amplitudes per
+// member. Otherwise, the group is split on the varying qubit that divides it
+// the most evenly.
+inline std::vector<AmplitudeBatch> planAmplitudeBatches(
+    const std::vector<std::vector<int>> &in_bitStrings, size_t in_maxOpenQubits,
+    size_t in_maxAmplitudesPerBitString = DEFAULT_MAX_AMPLITUDES_PER_BIT_STRING) {
+  std::vector<AmplitudeBatch> batches;
+  if (in_bitStrings.empty()) {
+    return batches;
+  }
+  std::vector<std::vector<size_t>> pendingGroups(1);
+  for (size_t i = 0; i < in_bitStrings.size(); ++i) {
+    pendingGroups.front().emplace_back(i);
+  }
+  while (!pendingGroups.empty()) {
+    const auto group = std::move(pendingGroups.back());
+    pendingGroups.pop_back();
+    const auto varyingQubits = getVaryingQubits(in_bitStrings, group);
+    if (varyingQubits.size() <= in_maxOpenQubits &&
+        varyingQubits.size() < 64 &&
+        (1ULL << varyingQubits.size()) <=
+            in_maxAmplitudesPerBitString * group.size()) {
+      batches.emplace_back(makeBatch(in_bitStrings, group, varyingQubits));
+      continue;
+    }
+    // Split on the most balanced varying qubit (both parts are non-empty).
+    size_t splitQubit = varyingQubits.front();
+    int64_t bestImbalance = group.size();
+    for (const auto &qubit : varyingQubits) {
+      const int64_t nbOnes =
+          std::count_if(group.begin(), group.end(), [&](size_t idx) {
+            return in_bitStrings[idx][qubit] == 1;
+          });
+      const int64_t imbalance = std::abs(2 * nbOnes - (int64_t)group.size());
+      if (imbalance < bestImbalance) {
+        bestImbalance = imbalance;
+        splitQubit = qubit;
+      }
+    }
+    std::vector<size_t> zeros;
+    std::vector<size_t> ones;
+    for (const auto &idx : group) {
+      (in_bitStrings[idx][splitQubit] == 1 ? ones : zeros).emplace_back(idx);
+    }
+    pendingGroups.emplace_back(std::move(ones));
+    pendingGroups.emplace_back(std::move(zeros));
+  }
+  // Deterministic order: by first member.
+  std::sort(batches.begin(), batches.end(),
+            [](const AmplitudeBatch &lhs, const AmplitudeBatch &rhs) {
+              return lhs.members.front() < rhs.members.front();
+            });
+  return batches;
+}
+} // namespace batching
+
+namespace sampling {
+// Frugal rejection sampling of bit strings from amplitudes, for circuits too
+// large for a state vector (e.g. random circuits).
+// Candidates are drawn uniformly: a wave-function slice (the other qubits
+// projected on random bits) provides the probabilities of all the completions
+// of the open qubits at once. A candidate x is accepted with probability
+// min(1, 2^n p(x) / M). For Porter-Thomas distributed probabilities (random
+// circuits), 2^n p(x) exceeds M with probability exp(-M), i.e. the samples
+// follow p(x) up to a truncation of weight ~ exp(-M), and each sample costs M
+// candidates on average, regardless of the number of qubits.
+
+constexpr double DEFAULT_FRUGAL_ACCEPTANCE_BOUND = 10.0;
+// Give up after this many times the expected number of candidates (the
+// probabilities are far from Porter-Thomas).
+constexpr double MAX_CANDIDATES_FACTOR = 100.0;
+
+struct FrugalSamplingStats {
+  // Number of slice evaluations and of candidate bit strings
+  size_t nbSlices = 0;
+  size_t nbCandidates = 0;
+  // Candidates whose probability exceeds the bound (truncated)
+  size_t nbOverBound = 0;
+};
+
+inline double getAcceptanceProbability(double in_prob, size_t in_nbQubits,
+                                       double in_bound) {
+  return std::min(1.0, std::ldexp(in_prob, in_nbQubits) / in_bound);
+}
+
+// Draw in_nbSamples bit strings (one value per qubit) of in_nbQubits qubits.
+// in_sliceProbabilities returns the probabilities of the slice of a bit
+// string (-1 for the open qubits): index bit k is the value of the k-th open
+// qubit in increasing order. Returns fewer samples if the max number of
+// candidates is reached.
+template <typename RandomEngine>
+std::vector<std::vector<uint8_t>> frugalRejectionSample(
+    size_t in_nbQubits, const std::vector<size_t> &in_openQubits,
+    size_t in_nbSamples, double in_bound, RandomEngine &io_rng,
+    const std::function<std::vector<double>(const std::vector<int> &)>
+        &in_sliceProbabilities,
+    FrugalSamplingStats &out_stats) {
+  assert(in_bound > 0.0);
+  assert(std::is_sorted(in_openQubits.begin(), in_openQubits.end()));
+  out_stats = FrugalSamplingStats();
+  const size_t sliceSize = 1ULL << in_openQubits.size();
+  const double maxCandidates = MAX_CANDIDATES_FACTOR * in_bound * in_nbSamples;
+  std::uniform_real_distribution<double> uniformDist(0.0, 1.0);
+  std::bernoulli_distribution bitDist(0.5);
+  std::vector<std::vector<uint8_t>> samples;
+  std::vector<size_t> candidateOrder(sliceSize);
+  while (samples.size() < in_nbSamples &&
+         out_stats.nbCandidates < maxCandidates) {
+    std::vector<int> bitString(in_nbQubits);
+    for (auto &bit : bitString) {
+      bit = bitDist(io_rng) ? 1 : 0;
+    }
+    for (const auto &qubit : in_openQubits) {
+      bitString[qubit] = -1;
+    }
+    const auto probs = in_sliceProbabilities(bitString);
+    assert(probs.size() == sliceSize);
+    ++out_stats.nbSlices;
+    // Random order: the last slice may only be partially used.
+    std::iota(candidateOrder.begin(), candidateOrder.end(), 0);
+    std::shuffle(candidateOrder.begin(), candidateOrder.end(), io_rng);
+    for (const auto &sliceIdx : candidateOrder) {
+      ++out_stats.nbCandidates;
+      const double acceptProb =
+          getAcceptanceProbability(probs[sliceIdx], in_nbQubits, in_bound);
+      if (acceptProb >= 1.0) {
+        ++out_stats.nbOverBound;
+      }
+      if (uniformDist(io_rng) < acceptProb) {
+        std::vector<uint8_t> sample(bitString.begin(), bitString.end());
+        for (size_t k = 0; k < in_openQubits.size(); ++k) {
+          sample[in_openQubits[k]] = (sliceIdx >> k) & 1;
+        }
+        samples.emplace_back(std::move(sample));
+        if (samples.size() == in_nbSamples) {
+          break;
+        }
+      }
+    }
+  }
+  return samples;
+}
+
+// Sampling of measurement outcomes block by block: the reduced density matrix
+// (RDM) of a block of qubits, conditioned on the outcomes of the previous
+// blocks, provides the marginal distribution of the whole block.
+
+// Max number of qubits of a block: the RDM has 4^k elements.
+constexpr size_t MAX_SAMPLING_BLOCK_SIZE = 8;
+
+// Split the measured qubits (in measurement order) into blocks of at most
+// in_blockSize qubits. A block never contains the same qubit twice, i.e. a
+// re-measured qubit starts a new block (conditioned on the first outcome).
+inline std::vector<std::vector<int>>
+getSamplingBlocks(const std::vector<int> &in_qubitIdx, size_t in_blockSize) {
+  assert(in_blockSize > 0);
+  std::vector<std::vector<int>> blocks;
+  for (const auto &qubit : in_qubitIdx) {
+    if (blocks.empty() || blocks.back().size() >= in_blockSize ||
+        std::find(blocks.back().begin(), blocks.back().end(), qubit) !=
+            blocks.back().end()) {
+      blocks.emplace_back();
+    }
+    blocks.back().emplace_back(qubit);
+  }
+  return blocks;
+}
+
+// Marginal probabilities (diagonal) of the RDM of in_nbQubits qubits.
+// The RDM legs are the ket legs then the bra legs, first leg fastest, i.e.
+// bit m of the outcome index is the m-th qubit of the block in increasing
+// qubit order.
+template <typename ComplexType>
+std::vector<double> getDiagonalProbabilities(const std::vector<ComplexType> &in_rdm,
+                                             size_t in_nbQubits) {
+  const uint64_t dim = 1ULL << in_nbQubits;
+  assert(in_rdm.size() == dim * dim);
+  std::vector<double> probs(dim);
+  for (uint64_t j = 0; j < dim; ++j) {
+    // Clamp the round-off
+    probs[j] = std::max(0.0, static_cast<double>(in_rdm[j * (dim + 1)].real()));
+  }
+  return probs;
+}
+
+// Outcome index for a random number in [0, 1) (inverse CDF). The
+// probabilities may not sum exactly to 1 (round-off).
+inline size_t sampleIndex(const std::vector<double> &in_probs,
+                          double in_randomNumber) {
+  assert(!in_probs.empty());
+  double total = 0.0;
+  for (const auto &prob : in_probs) {
+    total += prob;
+  }
+  const double target = in_randomNumber * total;
+  double cumulative = 0.0;
+  for (size_t j = 0; j < in_probs.size(); ++j) {
+    cumulative += in_probs[j];
+    if (target < cumulative) {
+      return j;
+    }
+  }
+  // Last outcome with a non-zero probability
+  size_t lastIdx = in_probs.size() - 1;
+  while (lastIdx > 0 && in_probs[lastIdx] <= 0.0) {
+    --lastIdx;
+  }
+  return lastIdx;
+}
+
+// Reuse across shots of sequential (qubit by qubit) sampling: the marginal of
+// the next qubit only depends on the bits sampled so far (the prefix), hence
+// shots sharing a prefix share the marginals. The conditioned networks are
+// reused too, only the projector tensor bodies (sampled bit and its
+// probability) need to be updated.
+
+// Max number of cached marginals (one per distinct sampled prefix).
+constexpr size_t MAX_CACHED_MARGINALS = 1ULL << 20;
+
+// Marginal (prob(0), prob(1)) of the next measured qubit for each sampled
+// prefix, i.e. the bits of the previous measured qubits.
+class MarginalCache {
+public:
+  explicit MarginalCache(size_t in_maxEntries = MAX_CACHED_MARGINALS)
+      : m_maxEntries(in_maxEntries) {}
+
+  // Returns false if the marginal of this prefix has not been computed.
+  bool find(const std::vector<uint8_t> &in_prefix,
+            std::array<double, 2> &out_marginal) {
+    const auto iter = m_marginals.find(in_prefix);
+    if (iter == m_marginals.end()) {
+      ++m_misses;
+      return false;
+    }
+    ++m_hits;
+    out_marginal = iter->second;
+    return true;
+  }
+
+  // Marginals beyond the max number of entries are not cached.
+  void insert(const std::vector<uint8_t> &in_prefix,
+              const std::array<double, 2> &in_marginal) {
+    if (m_marginals.size() < m_maxEntries) {
+      m_marginals.emplace(in_prefix, in_marginal);
+    }
+  }
+
+  void clear() {
+    m_marginals.clear();
+    m_hits = 0;
+    m_misses = 0;
+  }
+  size_t size() const { return m_marginals.size(); }
+  size_t getHits() const { return m_hits; }
+  size_t getMisses() const { return m_misses; }
+
+private:
+  size_t m_maxEntries;
+  std::map<std::vector<uint8_t>, std::array<double, 2>> m_marginals;
+  size_t m_hits = 0;
+  size_t m_misses = 0;
+};
+
+// Current body of each projector tensor (one per measured qubit except the
+// last one): sampled bit and its probability (renormalization).
+struct ProjectorState {
+  int bit = -1;
+  double prob = 0.0;
+};
+
+// Indices of the projectors (among the first in_nbProjectors) whose body must
+// be updated to condition on the sampled bits, and record their new state.
+inline std::vector<size_t>
+updateProjectorStates(std::vector<ProjectorState> &io_states,
+                      const std::vector<uint8_t> &in_sampledBits,
+                      const std::vector<double> &in_sampledProbs,
+                      size_t in_nbProjectors) {
+  assert(in_nbProjectors <= io_states.size());
+  assert(in_nbProjectors <= in_sampledBits.size());
+  assert(in_sampledBits.size() == in_sampledProbs.size());
+  std::vector<size_t> staleProjectors;
+  for (size_t i = 0; i < in_nbProjectors; ++i) {
+    if (io_states[i].bit != in_sampledBits[i] ||
+        io_states[i].prob != in_sampledProbs[i]) {
+      io_states[i].bit = in_sampledBits[i];
+      io_states[i].prob = in_sampledProbs[i];
+      staleProjectors.emplace_back(i);
+    }
+  }
+  return staleProjectors;
+}
+} // namespace sampling
+} // namespace tnqvm
@@ -0,0 +1,189 @@
+/***********************************************************************************
+ * Copyright (c) 2020, UT-Battelle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the xacc nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ **********************************************************************************/
+
+// In-place kernels operating on a (host) state vector or probability vector.
+// Header-only: all functions are inline templates so that this can be included
+// by multiple translation units/plugins.
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <complex>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace tnqvm {
+namespace kernels {
+// Don't spawn threads for vectors smaller than this (per thread).
+constexpr size_t MIN_ELEMENTS_PER_THREAD = 1ULL << 14;
+
+inline size_t getDefaultNumberOfThreads() {
+  static const size_t NB_THREADS =
+      std::max<size_t>(1, std::thread::hardware_concurrency());
+  return NB_THREADS;
+}
+
+// Number of worker threads (a power of two) to process a vector of the given
+// size, capped at the requested number of threads.
+inline size_t getNumberOfWorkers(size_t in_vectorSize, size_t in_maxThreads) {
+  size_t nbThreads = std::min(in_maxThreads, in_vectorSize / MIN_ELEMENTS_PER_THREAD);
+  if (nbThreads < 1) {
+    return 1;
+  }
+  // Round down to a power of two
+  while (nbThreads & (nbThreads - 1)) {
+    nbThreads &= (nbThreads - 1);
+  }
+  return nbThreads;
+}
+
+// Run the functor for each worker index [0, in_nbWorkers), in parallel.
+inline void runWorkers(size_t in_nbWorkers,
+                       const std::function<void(size_t)> &in_func) {
+  if (in_nbWorkers <= 1) {
+    in_func(0);
+    return;
+  }
+  std::vector<std::thread> threads;
+  threads.reserve(in_nbWorkers);
+  for (size_t t = 0; t < in_nbWorkers; ++t) {
+    threads.emplace_back(in_func, t);
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
+// In-place (unnormalized) fast Walsh-Hadamard transform:
+// io_data[mask] <- Sum_i (-1)^popcount(i & mask) * io_data[i]
+// When applied to a probability vector, io_data[mask] becomes the expectation
+// value <Z_S> of the Z-string on the set of qubits S encoded by the bit mask.
+// The size of the input vector must be a power of two.
+template <typename T>
+void fastWalshHadamardTransform(std::vector<T> &io_data,
+                                size_t in_maxThreads = getDefaultNumberOfThreads()) {
+  const size_t N = io_data.size();
+  assert((N & (N - 1)) == 0);
+  if (N < 2) {
+    return;
+  }
+
+  // Butterfly for all pairs (i, i + h) whose pair index is in [begin, end).
+  const auto butterflyStage = [&io_data](size_t h, size_t begin, size_t end) {
+    for (size_t j = begin; j < end; ++j) {
+      const size_t i = ((j & ~(h - 1)) << 1) | (j & (h - 1));
+      const T a = io_data[i];
+      const T b = io_data[i + h];
+      io_data[i] = a + b;
+      io_data[i + h] = a - b;
+    }
+  };
+
+  const size_t nbWorkers = getNumberOfWorkers(N, in_maxThreads);
+  const size_t chunkSize = N / nbWorkers;
+  // Stages whose stride is smaller than the chunk size are local to a chunk:
+  // each worker runs all of them on its own (contiguous) chunk.
+  runWorkers(nbWorkers, [&](size_t in_workerIdx) {
+    const size_t pairBegin = in_workerIdx * chunkSize / 2;
+    const size_t pairEnd = pairBegin + chunkSize / 2;
+    for (size_t h = 1; h < chunkSize; h <<= 1) {
+      butterflyStage(h, pairBegin, pairEnd);
+    }
+  });
+  // The remaining log2(nbWorkers) stages cross chunk boundaries:
+  // split the pairs evenly among workers for each stage.
+  for (size_t h = chunkSize; h < N; h <<= 1) {
+    runWorkers(nbWorkers, [&](size_t in_workerIdx) {
+      const size_t pairBegin = in_workerIdx * chunkSize / 2;
+      butterflyStage(h, pairBegin, pairBegin + chunkSize / 2);
+    });
+  }
+}
+
+// Apply a single-qubit gate (2x2 row-major matrix) to the state vector in-place:
+// (psi[i], psi[i + stride]) <- M * (psi[i], psi[i + stride]), stride = 2^qubit.
+// Pairs are processed in contiguous runs so that the inner loop vectorizes.
+template <typename ComplexType>
+void applySingleQubitGate(std::vector<ComplexType> &io_psi, size_t in_qubitIdx,
+                          const std::array<std::complex<double>, 4> &in_matrix,
+                          size_t in_maxThreads = getDefaultNumberOfThreads()) {
+  const size_t N = io_psi.size();
+  const size_t stride = 1ULL << in_qubitIdx;
+  assert(stride < N);
+  const ComplexType m00(in_matrix[0]);
+  const ComplexType m01(in_matrix[1]);
+  const ComplexType m10(in_matrix[2]);
+  const ComplexType m11(in_matrix[3]);
+  ComplexType *data = io_psi.data();
+  const size_t nbWorkers = getNumberOfWorkers(N, in_maxThreads);
+  const size_t pairsPerWorker = (N / 2) / nbWorkers;
+  runWorkers(nbWorkers, [&](size_t in_workerIdx) {
+    size_t j = in_workerIdx * pairsPerWorker;
+    const size_t end = j + pairsPerWorker;
+    while (j < end) {
+      // First amplitude index of this pair and the length of the contiguous run
+      const size_t i0 = ((j & ~(stride - 1)) << 1) | (j & (stride - 1));
+      const size_t runLength = std::min(end - j, stride - (j & (stride - 1)));
+      ComplexType *lo = data + i0;
+      ComplexType *hi = lo + stride;
+      for (size_t k = 0; k < runLength; ++k) {
+        const ComplexType a = lo[k];
+        const ComplexType b = hi[k];
+        lo[k] = m00 * a + m01 * b;
+        hi[k] = m10 * a + m11 * b;
+      }
+      j += runLength;
+    }
+  });
+}
+
+// Probability vector (squared norms) of the state vector.
+template <typename ComplexType>
+std::vector<double> getProbabilities(const std::vector<ComplexType> &in_psi) {
+  std::vector<double> probVec(in_psi.size());
+  for (size_t i = 0; i < in_psi.size(); ++i) {
+    probVec[i] = std::norm(in_psi[i]);
+  }
+  return probVec;
+}
+
+// Bit mask of the Z-string on the list of qubit indices: a qubit listed twice
+// contributes Z.Z = I, i.e. the bits are XOR'ed.
+template <typename IndexType>
+uint64_t getQubitMask(const std::vector<IndexType> &in_qubitIdx) {
+  uint64_t mask = 0;
+  for (const auto &bitIdx : in_qubitIdx) {
+    assert(bitIdx < 64);
+    mask ^= (1ULL << bitIdx);
+  }
+  return mask;
+}
+} // namespace kernels
+} // namespace tnqvm
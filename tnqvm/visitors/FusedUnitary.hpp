@@ -0,0 +1,99 @@
+/***********************************************************************************
+ * Copyright (c) 2020, UT-Battelle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the xacc nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ **********************************************************************************/
+#pragma once
+
+#include "TNQVMVisitor.hpp"
+#include <cassert>
+#include <functional>
+
+namespace tnqvm {
+// Custom (one- or two-qubit) unitary gate produced by the gate fusion pass
+// (see GateFusion.hpp). The matrix is row-major, the first qubit being the most
+// significant bit (same convention as the matrices of controlled gates, e.g.
+// CNOT).
+// Visitors which don't apply the matrix directly (see
+// TNQVMVisitor::visitFusedUnitary) visit the original gates instead.
+class FusedUnitary : public xacc::quantum::Gate {
+public:
+  FusedUnitary(const std::vector<std::size_t> &in_qubits,
+               std::vector<std::complex<double>> &&in_matrix,
+               std::vector<std::shared_ptr<xacc::Instruction>> &&in_sourceGates)
+      : Gate("FusedUnitary", in_qubits), m_nbQubits(in_qubits.size()),
+        m_matrix(std::move(in_matrix)), m_sourceGates(std::move(in_sourceGates)) {
+    assert(m_matrix.size() == (1ULL << (2 * m_nbQubits)));
+    // Tensor-name safe key of the matrix.
+    size_t hash = m_nbQubits;
+    for (const auto &val : m_matrix) {
+      for (const auto &part : {val.real(), val.imag()}) {
+        hash ^= std::hash<double>{}(part) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+      }
+    }
+    std::stringstream ss;
+    ss << "FUSED__" << std::hex << hash;
+    m_matrixKey = ss.str();
+  }
+
+  const std::vector<std::complex<double>> &getMatrix() const { return m_matrix; }
+  // Key of the matrix (e.g. to name a gate tensor body). Matrices with the same
+  // key are very likely (but not guaranteed) to be equal.
+  const std::string &getMatrixKey() const { return m_matrixKey; }
+  const std::vector<std::shared_ptr<xacc::Instruction>> &getSourceGates() const {
+    return m_sourceGates;
+  }
+
+  const int nRequiredBits() const override { return m_nbQubits; }
+  const std::string description() const override {
+    return "Unitary fusing a sequence of gates.";
+  }
+  const std::string toString() override {
+    std::string result = Gate::toString() + " {";
+    for (const auto &gate : m_sourceGates) {
+      result.append(" " + gate->toString() + ";");
+    }
+    return result + " }";
+  }
+  std::shared_ptr<xacc::Instruction> clone() override {
+    return std::make_shared<FusedUnitary>(*this);
+  }
+  void accept(std::shared_ptr<xacc::BaseInstructionVisitor> visitor) override {
+    auto tnqvmVisitor = std::dynamic_pointer_cast<TNQVMVisitor>(visitor);
+    if (tnqvmVisitor && tnqvmVisitor->visitFusedUnitary(*this)) {
+      return;
+    }
+    for (auto &gate : m_sourceGates) {
+      gate->accept(visitor);
+    }
+  }
+
+private:
+  int m_nbQubits;
+  std::vector<std::complex<double>> m_matrix;
+  std::string m_matrixKey;
+  std::vector<std::shared_ptr<xacc::Instruction>> m_sourceGates;
+};
+} // namespace tnqvm
@@ -0,0 +1,245 @@
+/***********************************************************************************
+ * Copyright (c) 2020, UT-Battelle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the xacc nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ **********************************************************************************/
+#include "InstructionTape.hpp"
+#include "base/Gates.hpp"
+#include "expression_parsing_util.hpp"
+#include "xacc_service.hpp"
+#include <algorithm>
+#include <cassert>
+
+namespace {
+double getParamValue(const xacc::InstructionParameter &in_param) {
+  if (in_param.which() == 0) {
+    return (double)in_param.as<int>();
+  }
+  return in_param.as<double>();
+}
+
+// Same format as the gate tensor names of the ExaTN visitor, e.g. Rx__0_500000__
+std::string getMatrixKey(const std::string &in_gateName,
+                         const std::vector<double> &in_params) {
+  if (in_params.empty()) {
+    return in_gateName;
+  }
+  std::string key = in_gateName + "__";
+  for (const auto &param : in_params) {
+    std::string paramStr = std::to_string(param);
+    std::replace(paramStr.begin(), paramStr.end(), '-', '_');
+    std::replace(paramStr.begin(), paramStr.end(), '.', '_');
+    paramStr.erase(std::remove(paramStr.begin(), paramStr.end(), '+'),
+                   paramStr.end());
+    key.append(paramStr + "__");
+  }
+  return key;
+}
+
+// Computes the gate matrix and its key from the (bound) gate parameters.
+// Leaves the matrix empty if this is not a gate we know the matrix of.
+void computeGateMatrix(tnqvm::TapeEntry &io_entry) {
+  io_entry.matrix = tnqvm::getFlatGateMatrix(*io_entry.gate);
+  if (io_entry.matrix.empty()) {
+    io_entry.matrixKey.clear();
+    return;
+  }
+  std::vector<double> params;
+  for (const auto &param : io_entry.gate->getParameters()) {
+    params.emplace_back(getParamValue(param));
+  }
+  io_entry.matrixKey = getMatrixKey(io_entry.gate->name(), params);
+}
+} // namespace
+
+namespace tnqvm {
+std::vector<std::complex<double>> getFlatGateMatrix(xacc::Instruction &in_gate) {
+  std::vector<double> params;
+  for (const auto &param : in_gate.getParameters()) {
+    if (param.which() == 2) {
+      // Unbound (symbolic) parameter
+      return {};
+    }
+    params.emplace_back(getParamValue(param));
+  }
+
+  std::vector<std::vector<std::complex<double>>> gateMatrix;
+  switch (GetGateType(in_gate.name())) {
+  case CommonGates::I: gateMatrix = GetGateMatrix<CommonGates::I>(); break;
+  case CommonGates::H: gateMatrix = GetGateMatrix<CommonGates::H>(); break;
+  case CommonGates::X: gateMatrix = GetGateMatrix<CommonGates::X>(); break;
+  case CommonGates::Y: gateMatrix = GetGateMatrix<CommonGates::Y>(); break;
+  case CommonGates::Z: gateMatrix = GetGateMatrix<CommonGates::Z>(); break;
+  case CommonGates::S: gateMatrix = GetGateMatrix<CommonGates::S>(); break;
+  case CommonGates::Sdg: gateMatrix = GetGateMatrix<CommonGates::Sdg>(); break;
+  case CommonGates::T: gateMatrix = GetGateMatrix<CommonGates::T>(); break;
+  case CommonGates::Tdg: gateMatrix = GetGateMatrix<CommonGates::Tdg>(); break;
+  case CommonGates::Rx: gateMatrix = GetGateMatrix<CommonGates::Rx>(params[0]); break;
+  case CommonGates::Ry: gateMatrix = GetGateMatrix<CommonGates::Ry>(params[0]); break;
+  case CommonGates::Rz: gateMatrix = GetGateMatrix<CommonGates::Rz>(params[0]); break;
+  case CommonGates::U:
+    gateMatrix = GetGateMatrix<CommonGates::U>(params[0], params[1], params[2]);
+    break;
+  case CommonGates::CNOT: gateMatrix = GetGateMatrix<CommonGates::CNOT>(); break;
+  case CommonGates::CZ: gateMatrix = GetGateMatrix<CommonGates::CZ>(); break;
+  case CommonGates::CY: gateMatrix = GetGateMatrix<CommonGates::CY>(); break;
+  case CommonGates::CH: gateMatrix = GetGateMatrix<CommonGates::CH>(); break;
+  case CommonGates::CPhase:
+    gateMatrix = GetGateMatrix<CommonGates::CPhase>(params[0]);
+    break;
+  case CommonGates::CRZ:
+    gateMatrix = GetGateMatrix<CommonGates::CRZ>(params[0]);
+    break;
+  case CommonGates::Swap: gateMatrix = GetGateMatrix<CommonGates::Swap>(); break;
+  case CommonGates::iSwap: gateMatrix = GetGateMatrix<CommonGates::iSwap>(); break;
+  case CommonGates::fSim:
+    gateMatrix = GetGateMatrix<CommonGates::fSim>(params[0], params[1]);
+    break;
+  default:
+    return {};
+  }
+
+  std::vector<std::complex<double>> result;
+  result.reserve(gateMatrix.size() * gateMatrix.size());
+  for (const auto &row : gateMatrix) {
+    result.insert(result.end(), row.begin(), row.end());
+  }
+  return result;
+}
+
+std::shared_ptr<InstructionTape>
+InstructionTape::compile(std::shared_ptr<xacc::CompositeInstruction> in_kernel) {
+  auto tape = std::make_shared<InstructionTape>();
+  tape->m_name = in_kernel->name();
+  tape->m_variables = in_kernel->getVariables();
+  const auto nbVars = tape->m_variables.size();
+  auto parsingUtil = xacc::getService<xacc::ExpressionParsingUtil>("exprtk");
+  const auto evaluate = [&](const std::string &in_expr,
+                            const std::vector<double> &in_values) {
+    double value = 0.0;
+    if (!parsingUtil->evaluate(in_expr, tape->m_variables, in_values, value)) {
+      xacc::error("Failed to evaluate gate parameter expression '" + in_expr +
+                  "'.");
+    }
+    return value;
+  };
+
+  xacc::InstructionIterator it(in_kernel);
+  while (it.hasNext()) {
+    auto nextInst = it.next();
+    if (!nextInst->isEnabled() || nextInst->isComposite()) {
+      continue;
+    }
+    TapeEntry entry;
+    entry.gate = nextInst->clone();
+    entry.qubits = nextInst->bits();
+    entry.isControlGate = IsControlGate(GetGateType(nextInst->name()));
+    for (size_t i = 0; i < nextInst->nParameters(); ++i) {
+      const auto param = nextInst->getParameter(i);
+      if (param.which() != 2) {
+        continue;
+      }
+      // Symbolic angle: try to reduce it to an affine form, so that
+      // re-binding doesn't need the expression parser.
+      TapeEntry::ParamSlot slot;
+      slot.paramIdx = i;
+      const auto expr = param.toString();
+      std::vector<double> values(nbVars, 0.0);
+      slot.offset = evaluate(expr, values);
+      for (size_t varIdx = 0; varIdx < nbVars; ++varIdx) {
+        values[varIdx] = 1.0;
+        const double coeff = evaluate(expr, values) - slot.offset;
+        values[varIdx] = 0.0;
+        if (coeff != 0.0) {
+          slot.coefficients.emplace_back(varIdx, coeff);
+        }
+      }
+      // Validate the affine form at an arbitrary point.
+      double affineValue = slot.offset;
+      for (size_t varIdx = 0; varIdx < nbVars; ++varIdx) {
+        values[varIdx] = 0.1 + 0.37 * varIdx;
+      }
+      for (const auto &[varIdx, coeff] : slot.coefficients) {
+        affineValue += coeff * values[varIdx];
+      }
+      if (std::abs(evaluate(expr, values) - affineValue) > 1e-9) {
+        slot.coefficients.clear();
+        slot.expression = expr;
+      }
+      entry.paramSlots.emplace_back(std::move(slot));
+    }
+
+    if (entry.isParametric()) {
+      tape->m_parametricEntries.emplace_back(tape->m_entries.size());
+    } else {
+      computeGateMatrix(entry);
+    }
+    tape->m_entries.emplace_back(std::move(entry));
+  }
+
+  tape->m_isBound = tape->m_parametricEntries.empty();
+  return tape;
+}
+
+void InstructionTape::bind(const std::vector<double> &in_params) {
+  if (in_params.size() != m_variables.size()) {
+    xacc::error("Invalid number of parameters: expected " +
+                std::to_string(m_variables.size()) + ", got " +
+                std::to_string(in_params.size()) + ".");
+  }
+  std::shared_ptr<xacc::ExpressionParsingUtil> parsingUtil;
+  for (const auto &entryIdx : m_parametricEntries) {
+    auto &entry = m_entries[entryIdx];
+    for (const auto &slot : entry.paramSlots) {
+      double value = slot.offset;
+      if (slot.expression.empty()) {
+        for (const auto &[varIdx, coeff] : slot.coefficients) {
+          value += coeff * in_params[varIdx];
+        }
+      } else {
+        if (!parsingUtil) {
+          parsingUtil =
+              xacc::getService<xacc::ExpressionParsingUtil>("exprtk");
+        }
+        parsingUtil->evaluate(slot.expression, m_variables, in_params, value);
+      }
+      entry.gate->setParameter(slot.paramIdx, value);
+    }
+    computeGateMatrix(entry);
+  }
+  m_isBound = true;
+}
+
+std::shared_ptr<InstructionTape>
+InstructionTape::bindCopy(const std::vector<double> &in_params) const {
+  auto tapeCopy = std::make_shared<InstructionTape>(*this);
+  for (const auto &entryIdx : m_parametricEntries) {
+    auto &entry = tapeCopy->m_entries[entryIdx];
+    entry.gate = entry.gate->clone();
+  }
+  tapeCopy->bind(in_params);
+  return tapeCopy;
+}
+} // namespace tnqvm
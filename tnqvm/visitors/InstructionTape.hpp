@@ -0,0 +1,97 @@
+/***********************************************************************************
+ * Copyright (c) 2020, UT-Battelle
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the xacc nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ **********************************************************************************/
+#pragma once
+
+#include "xacc.hpp"
+#include <complex>
+
+namespace tnqvm {
+// Flattened (row-major, first qubit as the most significant bit) matrix of a
+// gate with numerical parameters.
+// Empty if the gate is not a unitary known to TNQVM (e.g. Measure).
+std::vector<std::complex<double>> getFlatGateMatrix(xacc::Instruction &in_gate);
+
+// One gate of a compiled instruction tape.
+struct TapeEntry {
+  // Angle of a parametric gate, as a function of the kernel variables:
+  // offset + Sum_k coeff_k * x[varIdx_k] (affine), or a generic expression
+  // which is evaluated on (re-)binding.
+  struct ParamSlot {
+    size_t paramIdx;
+    double offset = 0.0;
+    std::vector<std::pair<size_t, double>> coefficients;
+    std::string expression;
+  };
+
+  // Gate instance (owned by the tape): parameters are re-bound in-place,
+  // so that visitors can still visit it as a regular gate.
+  std::shared_ptr<xacc::Instruction> gate;
+  std::vector<size_t> qubits;
+  bool isControlGate = false;
+  // Flattened (row-major) gate matrix: precomputed at compile time for fixed
+  // gates, re-computed on binding for parametric gates.
+  // Empty if the gate is not a unitary known to TNQVM (e.g. Measure).
+  std::vector<std::complex<double>> matrix;
+  // Unique (tensor-name safe) key of the gate matrix, i.e. gate name and
+  // parameter values, e.g. "Rx__0_500000__".
+  std::string matrixKey;
+  std::vector<ParamSlot> paramSlots;
+
+  bool isParametric() const { return !paramSlots.empty(); }
+};
+
+// A kernel lowered once into a flat list of gates (no composite nesting,
+// disabled instructions dropped), which can be replayed many times with
+// different parameter values. Re-binding only updates the parametric entries.
+class InstructionTape {
+public:
+  static std::shared_ptr<InstructionTape>
+  compile(std::shared_ptr<xacc::CompositeInstruction> in_kernel);
+  // Bind the kernel variables (same order as the kernel's getVariables()).
+  void bind(const std::vector<double> &in_params);
+  // Copy of the tape bound to the given values (this tape is unchanged), e.g.
+  // for concurrent replays with different parameters. Parametric gates are
+  // cloned, fixed ones are shared.
+  std::shared_ptr<InstructionTape>
+  bindCopy(const std::vector<double> &in_params) const;
+
+  const std::string &name() const { return m_name; }
+  const std::vector<std::string> &variables() const { return m_variables; }
+  const std::vector<TapeEntry> &entries() const { return m_entries; }
+  size_t nbParametricEntries() const { return m_parametricEntries.size(); }
+  bool isBound() const { return m_isBound; }
+
+private:
+  std::string m_name;
+  std::vector<std::string> m_variables;
+  std::vector<TapeEntry> m_entries;
+  // Indices of parametric entries
+  std::vector<size_t> m_parametricEntries;
+  bool m_isBound = false;
+};
+} // namespace tnqvm
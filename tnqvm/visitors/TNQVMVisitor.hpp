@@ -34,6 +34,8 @@
 #include "Identifiable.hpp"
 #include "AllGateVisitor.hpp"
 #include "xacc.hpp"
+#include "InstructionTape.hpp"
+#include <mutex>
 #include <sstream>
 
 using namespace xacc;
@@ -55,12 +57,41 @@ extern bool tnqvm_timing_log_enabled;
   xacc::ScopeTimer __telemetry__timer(concat("tnqvm::", NAME, " (", FILE, ":", LINE, ")"), xacc::verbose && tnqvm_timing_log_enabled);
 
 namespace tnqvm {
+class FusedUnitary;
+
+// Opaque snapshot of the simulated state of a visitor (see snapshotState()).
+struct TNQVMVisitorSnapshot {
+  virtual ~TNQVMVisitorSnapshot() = default;
+};
+
 class TNQVMVisitor : public AllGateVisitor, public OptionsProvider,
                      public xacc::Cloneable<TNQVMVisitor> {
 public:
   virtual void initialize(std::shared_ptr<AcceleratorBuffer> buffer, int nbShots = 1) = 0;
   virtual const double
   getExpectationValueZ(std::shared_ptr<CompositeInstruction> function) = 0;
+  // Batched version of getExpectationValueZ (VQE mode):
+  // evaluates all the observed sub-circuits (change of basis + measure) on top
+  // of the ansatz state. Visitors can override this to share work between
+  // sub-circuits; the default is one getExpectationValueZ call per sub-circuit.
+  virtual std::vector<double> getExpectationValueZBatch(
+      const std::vector<std::shared_ptr<CompositeInstruction>> &functions) {
+    std::vector<double> result;
+    result.reserve(functions.size());
+    for (auto &function : functions) {
+      result.emplace_back(getExpectationValueZ(function));
+    }
+    return result;
+  }
+
+  // Apply a gate of a compiled instruction tape, e.g. using its precomputed
+  // matrix. Returns false if the entry is not handled by the visitor, in which
+  // case the gate instance will be visited as usual.
+  virtual bool visitTapeEntry(const TapeEntry &in_entry) { return false; }
+  // Apply a unitary produced by the gate fusion pass (see FusedUnitary.hpp).
+  // Returns false if the visitor doesn't support it, in which case the
+  // original (fused) gates will be visited instead.
+  virtual bool visitFusedUnitary(const FusedUnitary &in_gate) { return false; }
 
   virtual const std::vector<std::complex<double>> getState() {
     return std::vector<std::complex<double>>{};
@@ -71,6 +102,21 @@ public:
   // Does this visitor implementation support VQE mode execution?
   // i.e. ability to cache the state vector after simulating the ansatz.
   virtual bool supportVqeMode() const { return false; }
+  // Snapshot the current state, e.g. to simulate a prefix shared by multiple
+  // kernels only once. Returns null if the visitor (or the current state)
+  // doesn't support snapshots.
+  virtual std::shared_ptr<TNQVMVisitorSnapshot> snapshotState() {
+    return nullptr;
+  }
+  // Restore a snapshot taken by this visitor type (after initialize(), on a
+  // buffer of the same size).
+  virtual void
+  restoreState(const std::shared_ptr<TNQVMVisitorSnapshot> &in_snapshot) {}
+  // Does this visitor implement snapshotState()/restoreState()?
+  virtual bool supportsStateSnapshot() const { return false; }
+  // Can different instances (clones) of this visitor execute kernels
+  // concurrently, i.e. no shared (global) backend state?
+  virtual bool isThreadSafe() const { return false; }
   // Execution information that visitor wants to persist.
   HeterogeneousMap getExecutionInfo() const { return executionInfo; }
 
@@ -81,6 +127,13 @@ protected:
   HeterogeneousMap executionInfo;
 };
 
+
+// Guards the lazy initialization of process-wide backend runtimes (e.g. ExaTN)
+// by concurrent visitor instances.
+inline std::mutex &getBackendInitMutex() {
+  static std::mutex backendInitMutex;
+  return backendInitMutex;
+}
 } // namespace tnqvm
 
 #endif /* TNQVM_TNQVMVISITOR_HPP_ */
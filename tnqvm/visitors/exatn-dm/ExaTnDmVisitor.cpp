@@ -303,6 +303,7 @@ ExaTnDmVisitor::ExaTnDmVisitor() {
 void ExaTnDmVisitor::initialize(std::shared_ptr<AcceleratorBuffer> buffer,
                                 int nbShots) {
   // Initialize ExaTN (if not already initialized)
+  std::unique_lock<std::mutex> initLock(getBackendInitMutex());
   if (!exatn::isInitialized()) {
 #ifdef TNQVM_EXATN_USES_MKL_BLAS
     // Fix for TNQVM bug #30
@@ -331,6 +332,7 @@ void ExaTnDmVisitor::initialize(std::shared_ptr<AcceleratorBuffer> buffer,
       exatn::resetRuntimeLoggingLevel(xacc::verbose ? level : 0);
     });
   }
+  initLock.unlock();
   m_buffer = buffer;
   m_tensorNetwork = buildInitialNetwork(buffer->size());
   m_tensorIdCounter = m_tensorNetwork.getMaxTensorId();
@@ -441,6 +441,7 @@ ExaTnPmpsVisitor::ExaTnPmpsVisitor()
 void ExaTnPmpsVisitor::initialize(std::shared_ptr<AcceleratorBuffer> buffer, int nbShots) 
 { 
     // Initialize ExaTN (if not already initialized)
+    std::unique_lock<std::mutex> initLock(getBackendInitMutex());
     if (!exatn::isInitialized()) 
     {
 #ifdef TNQVM_EXATN_USES_MKL_BLAS
@@ -469,6 +470,7 @@ void ExaTnPmpsVisitor::initialize(std::shared_ptr<AcceleratorBuffer> buffer, int
             exatn::resetRuntimeLoggingLevel(xacc::verbose ? level : 0);
         });
     }
+    initLock.unlock();
 
     m_buffer = buffer;
     m_pmpsTensorNetwork = buildInitialNetwork(buffer->size(), true);
@@ -130,6 +130,7 @@ void ExatnMpsVisitor::initialize(std::shared_ptr<AcceleratorBuffer> buffer, int
     }
 
     // Initialize ExaTN
+    std::unique_lock<std::mutex> initLock(getBackendInitMutex());
     if (!exatn::isInitialized()) {
 #ifdef TNQVM_EXATN_USES_MKL_BLAS
         // Fix for TNQVM bug #30
@@ -198,6 +199,7 @@ void ExatnMpsVisitor::initialize(std::shared_ptr<AcceleratorBuffer> buffer, int
             exatn::resetRuntimeLoggingLevel(xacc::verbose ? level : 0);
         });
     }
+    initLock.unlock();
 
     // Default SVD cut-off is the numerical limit, i.e. technically, no cut-off.
     m_svdCutoff = std::numeric_limits<double>::min();
@@ -33,6 +33,7 @@
 #define _DEBUG_DIL
 
 #include "ExatnVisitor.hpp"
+#include "FusedUnitary.hpp"
 #include "base/Gates.hpp"
 #include "exatn.hpp"
 #include "tensor_basic.hpp"
@@ -42,12 +43,26 @@
 #include <random>
 #include <chrono>
 #include <functional>
+#include <map>
 #include <unordered_set>
+#include <list>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <tuple>
 #include "utils/GateMatrixAlgebra.hpp"
+#include "utils/StateVectorKernels.hpp"
+#include "utils/CircuitAnalysis.hpp"
 
 #ifdef TNQVM_EXATN_USES_MKL_BLAS
 #include <dlfcn.h>
 #endif
+#ifdef MPI_ENABLED
+#include "mpi.h"
+#endif
 
 bool tnqvm_timing_log_enabled = true;
 
@@ -56,6 +71,12 @@ namespace {
 std::string generateQubitTensorName(int qubitIndex) {
   return "Q" + std::to_string(qubitIndex);
 };
+// Unique prefix of the tensor names of each visitor instance: instances
+// (e.g. concurrent executions) share the process-wide ExaTN tensor namespace.
+std::string generateTensorPrefix() {
+  static std::atomic<int> instanceCounter(0);
+  return "V" + std::to_string(instanceCounter++) + "_";
+}
 // The max number of qubits that we allow full state vector contraction.
 // Above this limit, only tensor-based calculation is allowed.
 // e.g. simulating bit-string measurement by tensor contraction.
@@ -117,6 +138,72 @@ double calcExpValueZ(const std::vector<int>& in_bits, const std::vector<TNQVM_CO
 
   return result;
 }
+
+// List of single-qubit gates (qubit index, 2x2 row-major matrix)
+using SingleQubitGateList =
+    std::vector<std::pair<size_t, std::array<std::complex<double>, 4>>>;
+
+// Retrieve the matrix of a single-qubit gate.
+// Returns false if this is not a supported single-qubit gate.
+bool getSingleQubitGateMatrix(const std::shared_ptr<xacc::Instruction> &in_inst,
+                              std::array<std::complex<double>, 4> &out_matrix) {
+  using namespace tnqvm;
+  if (in_inst->bits().size() != 1) {
+    return false;
+  }
+  const auto getParam = [&in_inst](size_t in_idx) {
+    return in_inst->getParameter(in_idx).as<double>();
+  };
+  std::vector<std::vector<std::complex<double>>> gateMatrix;
+  switch (GetGateType(in_inst->name())) {
+  case CommonGates::I: gateMatrix = GetGateMatrix<CommonGates::I>(); break;
+  case CommonGates::H: gateMatrix = GetGateMatrix<CommonGates::H>(); break;
+  case CommonGates::X: gateMatrix = GetGateMatrix<CommonGates::X>(); break;
+  case CommonGates::Y: gateMatrix = GetGateMatrix<CommonGates::Y>(); break;
+  case CommonGates::Z: gateMatrix = GetGateMatrix<CommonGates::Z>(); break;
+  case CommonGates::S: gateMatrix = GetGateMatrix<CommonGates::S>(); break;
+  case CommonGates::Sdg: gateMatrix = GetGateMatrix<CommonGates::Sdg>(); break;
+  case CommonGates::T: gateMatrix = GetGateMatrix<CommonGates::T>(); break;
+  case CommonGates::Tdg: gateMatrix = GetGateMatrix<CommonGates::Tdg>(); break;
+  case CommonGates::Rx: gateMatrix = GetGateMatrix<CommonGates::Rx>(getParam(0)); break;
+  case CommonGates::Ry: gateMatrix = GetGateMatrix<CommonGates::Ry>(getParam(0)); break;
+  case CommonGates::Rz: gateMatrix = GetGateMatrix<CommonGates::Rz>(getParam(0)); break;
+  case CommonGates::U:
+    gateMatrix = GetGateMatrix<CommonGates::U>(getParam(0), getParam(1), getParam(2));
+    break;
+  default:
+    return false;
+  }
+  out_matrix = {gateMatrix[0][0], gateMatrix[0][1], gateMatrix[1][0],
+                gateMatrix[1][1]};
+  return true;
+}
+
+// Split an observed sub-circuit (VQE mode) into its change-of-basis gates and
+// the list of measured qubits.
+// Returns false if the change of basis is not made of single-qubit gates only.
+bool getBasisChangeGates(std::shared_ptr<xacc::CompositeInstruction> in_function,
+                         SingleQubitGateList &out_gates,
+                         std::vector<int> &out_measureQbIdx) {
+  out_gates.clear();
+  out_measureQbIdx.clear();
+  xacc::InstructionIterator it(in_function);
+  while (it.hasNext()) {
+    auto nextInst = it.next();
+    if (nextInst->isEnabled() && !nextInst->isComposite()) {
+      if (nextInst->name() == "Measure") {
+        out_measureQbIdx.emplace_back(nextInst->bits()[0]);
+      } else {
+        std::array<std::complex<double>, 4> gateMatrix;
+        if (!getSingleQubitGateMatrix(nextInst, gateMatrix)) {
+          return false;
+        }
+        out_gates.emplace_back(nextInst->bits()[0], gateMatrix);
+      }
+    }
+  }
+  return true;
+}
 } // namespace
 
 namespace tnqvm {
@@ -378,14 +465,38 @@ void ExatnDebugLogger<TNQVM_COMPLEX_TYPE>::postMeasurement(tnqvm::ExatnVisitor<T
 
 template<typename TNQVM_COMPLEX_TYPE>
 ExatnVisitor<TNQVM_COMPLEX_TYPE>::ExatnVisitor()
-    : m_tensorNetwork("Quantum Circuit"), m_tensorIdCounter(0),
+    : m_tensorPrefix(generateTensorPrefix()),
+      m_tensorNetwork(m_tensorPrefix + "Quantum Circuit"), m_tensorIdCounter(0),
       m_hasEvaluated(false), m_isAppendingCircuitGates(true) {}
 
+template<typename TNQVM_COMPLEX_TYPE>
+ExatnVisitor<TNQVM_COMPLEX_TYPE>::~ExatnVisitor() {
+  // Release the persistent tensors of warm mode and the sampling networks
+  // (unless ExaTN has been torn down).
+  if (exatn::isInitialized()) {
+    releaseSamplingNetworkCache();
+  }
+  if (m_warmMode && exatn::isInitialized()) {
+    releaseWarmTensors(true);
+  }
+}
+
 template<typename TNQVM_COMPLEX_TYPE>
 void ExatnVisitor<TNQVM_COMPLEX_TYPE>::initialize(std::shared_ptr<AcceleratorBuffer> buffer,
                               int nbShots) {
   int64_t talshHostBufferSizeInBytes = MAX_TALSH_MEMORY_BUFFER_SIZE_BYTES;
-  if (!exatn::isInitialized()) {
+  // Warm mode: keep gate tensors and qubit register tensors alive between
+  // executions (of the same visitor instance).
+  const bool warmMode = options.keyExists<bool>("warm-mode") && options.get<bool>("warm-mode");
+  // Warm start: the backend has been set up by a previous execution of this
+  // visitor, and its register tensors are still valid.
+  const bool isWarmStart = m_warmMode && warmMode && m_warmNbQubits == buffer->size();
+  // Concurrent visitor instances may race to initialize ExaTN.
+  std::unique_lock<std::mutex> initLock(getBackendInitMutex(), std::defer_lock);
+  if (!isWarmStart) {
+    initLock.lock();
+  }
+  if (!isWarmStart && !exatn::isInitialized()) {
 #ifdef TNQVM_EXATN_USES_MKL_BLAS
     // Fix for TNQVM bug #30
     void *core_handle =
@@ -486,6 +597,21 @@ void ExatnVisitor<TNQVM_COMPLEX_TYPE>::initialize(std::shared_ptr<AcceleratorBuf
       exatn::resetRuntimeLoggingLevel(xacc::verbose ? level : 0);
     });
   }
+  if (initLock.owns_lock()) {
+    initLock.unlock();
+  }
+  // The conditioned networks of getMeasureSample reference the tensors of the
+  // previous execution.
+  releaseSamplingNetworkCache();
+
+  if (m_warmMode && (!warmMode || m_warmNbQubits != buffer->size())) {
+    // Gate tensors can be reused for a different register size.
+    releaseWarmTensors(!warmMode);
+  }
+  m_warmMode = warmMode;
+  // Cheap state reset (the previous execution may have left some data)
+  m_measureQbIdx.clear();
+  m_cacheStateVec.clear();
 
   m_hasEvaluated = false;
   m_buffer = std::move(buffer);
@@ -512,26 +638,76 @@ void ExatnVisitor<TNQVM_COMPLEX_TYPE>::initialize(std::shared_ptr<AcceleratorBuf
     m_maxQubit = options.get<int>("max-qubit");
     xacc::info("Set max qubit to " + m_maxQubit);
   }
-  // Create the qubit register tensor
-  for (int i = 0; i < m_buffer->size(); ++i) {
-    const bool created = exatn::createTensor(
-        generateQubitTensorName(i), getExatnElementType(),
-        TensorShape{2});
-    assert(created);
+  m_sliceOpenQubits = m_maxQubit;
+  m_memoryBudgetBytes = 0;
+  m_expValStrategyCache.clear();
+  if (options.keyExists<int>("memory-budget")) {
+    const int memoryBudgetMb = options.get<int>("memory-budget");
+    if (memoryBudgetMb < 1) {
+      xacc::error("Invalid 'memory-budget' parameter.");
+    }
+    m_memoryBudgetBytes = memoryBudgetMb * (1LL << 20);
+  }
+  m_contrSeqCacheDir = options.stringExists("exatn-contract-seq-cache-dir")
+                           ? options.getString("exatn-contract-seq-cache-dir")
+                           : "";
+  m_contrSeqCacheHits = 0;
+  m_contrSeqCacheMisses = 0;
+  m_contrSeqPortfolio.clear();
+  if (options.stringExists("exatn-contract-seq-portfolio")) {
+    std::stringstream optimizerList(
+        options.getString("exatn-contract-seq-portfolio"));
+    std::string optimizerName;
+    while (std::getline(optimizerList, optimizerName, ',')) {
+      if (!optimizerName.empty()) {
+        m_contrSeqPortfolio.emplace_back(optimizerName);
+      }
+    }
+    if (m_contrSeqPortfolio.empty()) {
+      xacc::error("Invalid 'exatn-contract-seq-portfolio' parameter.");
+    }
   }
+  m_contrSeqTimeLimit = options.keyExists<double>("exatn-contract-seq-timeout")
+                            ? options.get<double>("exatn-contract-seq-timeout")
+                            : 5.0;
+  m_contrSeqRestarts = options.keyExists<int>("exatn-contract-seq-restarts")
+                           ? options.get<int>("exatn-contract-seq-restarts")
+                           : 4;
+  if (m_contrSeqTimeLimit < 0.0 || m_contrSeqRestarts < 1) {
+    xacc::error("Invalid contraction sequence portfolio parameters.");
+  }
+  // Peak volume of the intermediate tensors allowed for the portfolio winner.
+  m_maxPeakVolume =
+      static_cast<double>(m_memoryBudgetBytes > 0 ? m_memoryBudgetBytes
+                                                  : exatnBufferSize) /
+      sizeof(TNQVM_COMPLEX_TYPE);
+  m_contrSeqWinner = contraction::PathCandidate{"", 0, -1.0, 0.0};
+  m_samplingBlockSize = 0;
+  // Qubit tensors are never modified by the evaluation, hence the warm ones (if
+  // any) are still in the zero state.
+  if (!m_warmMode || m_warmNbQubits != m_buffer->size()) {
+    // Create the qubit register tensor
+    for (int i = 0; i < m_buffer->size(); ++i) {
+      const bool created = exatn::createTensor(
+          m_tensorPrefix + generateQubitTensorName(i), getExatnElementType(),
+          TensorShape{2});
+      assert(created);
+    }
 
-  // Initialize the qubit register tensor to zero state
-  for (int i = 0; i < m_buffer->size(); ++i) {
-    // Define the tensor body for a zero-state qubit
-    const bool initialized = exatn::initTensorData(generateQubitTensorName(i), std::vector<TNQVM_COMPLEX_TYPE>{{1.0, 0.0}, {0.0, 0.0}});
-    assert(initialized);
+    // Initialize the qubit register tensor to zero state
+    for (int i = 0; i < m_buffer->size(); ++i) {
+      // Define the tensor body for a zero-state qubit
+      const bool initialized = exatn::initTensorData(m_tensorPrefix + generateQubitTensorName(i), std::vector<TNQVM_COMPLEX_TYPE>{{1.0, 0.0}, {0.0, 0.0}});
+      assert(initialized);
+    }
+    m_warmNbQubits = m_warmMode ? m_buffer->size() : 0;
   }
 
   // Append the qubit tensors to the tensor network
   for (int i = 0; i < m_buffer->size(); ++i) {
     m_tensorIdCounter++;
     m_tensorNetwork.appendTensor(
-        m_tensorIdCounter, exatn::getTensor(generateQubitTensorName(i)),
+        m_tensorIdCounter, exatn::getTensor(m_tensorPrefix + generateQubitTensorName(i)),
         std::vector<std::pair<unsigned int, unsigned int>>{});
   }
 
@@ -576,7 +752,8 @@ void ExatnVisitor<TNQVM_COMPLEX_TYPE>::evaluateNetwork() {
   // been visited.
   if (m_buffer->size() <= MAX_NUMBER_QUBITS_FOR_STATE_VEC){
     TNQVM_TELEMETRY_ZONE("exatn::evaluateSync", __FILE__, __LINE__);
-    m_tensorNetwork.rename(m_kernelName);
+    m_tensorNetwork.rename(m_tensorPrefix + m_kernelName);
+    determineContractionSequence(m_tensorNetwork);
     const bool evaluated = exatn::evaluateSync(m_tensorNetwork);
     assert(evaluated);
     // Synchronize:
@@ -589,22 +766,39 @@ void ExatnVisitor<TNQVM_COMPLEX_TYPE>::evaluateNetwork() {
 template<typename TNQVM_COMPLEX_TYPE>
 void ExatnVisitor<TNQVM_COMPLEX_TYPE>::resetExaTN() {
   TNQVM_TELEMETRY_ZONE(__FUNCTION__, __FILE__, __LINE__);
+  if (!m_contrSeqCacheDir.empty()) {
+    executionInfo.insert("exatn-contract-seq-cache-hits", m_contrSeqCacheHits);
+    executionInfo.insert("exatn-contract-seq-cache-misses",
+                         m_contrSeqCacheMisses);
+  }
+  if (m_contrSeqWinner.flops >= 0.0) {
+    executionInfo.insert("exatn-contract-seq-winner", m_contrSeqWinner.optimizer);
+    executionInfo.insert("exatn-contract-seq-restart", m_contrSeqWinner.restart);
+    executionInfo.insert("exatn-contract-seq-flops", m_contrSeqWinner.flops);
+    executionInfo.insert("exatn-contract-seq-peak-bytes",
+                         m_contrSeqWinner.peakVolume *
+                             sizeof(TNQVM_COMPLEX_TYPE));
+  }
 
   std::unordered_set<std::string> tensorList;
   for (auto iter = m_tensorNetwork.cbegin(); iter != m_tensorNetwork.cend();
        ++iter) {
     const auto &tensorName = iter->second.getTensor()->getName();
     // Not a root tensor
-    if (!tensorName.empty() && tensorName[0] != '_') {
+    if (!tensorName.empty() && tensorName[0] != '_' &&
+        !isPersistentTensor(tensorName)) {
       tensorList.emplace(iter->second.getTensor()->getName());
     }
   }
   // Add any tensors which have been created but are not in the tensor network.
   // e.g. temporary tensors for expectation calculation.
-  for (const auto &iter : m_gateTensorBodies) {
-    const auto &tensorName = iter.first;
-    if (tensorList.find(tensorName) == tensorList.end()) {
-      tensorList.emplace(tensorName);
+  // In warm mode, gate tensors are kept for the next execution.
+  if (!m_warmMode) {
+    for (const auto &iter : m_gateTensorBodies) {
+      const auto &tensorName = iter.first;
+      if (tensorList.find(tensorName) == tensorList.end()) {
+        tensorList.emplace(tensorName);
+      }
     }
   }
 
@@ -612,7 +806,9 @@ void ExatnVisitor<TNQVM_COMPLEX_TYPE>::resetExaTN() {
     const bool destroyed = exatn::destroyTensor(tensorName);
     assert(destroyed);
   }
-  m_gateTensorBodies.clear();
+  if (!m_warmMode) {
+    m_gateTensorBodies.clear();
+  }
   m_appendedGateTensors.clear();
   m_tensorIdCounter = 0;
   TensorNetwork emptyTensorNet;
@@ -621,17 +817,58 @@ void ExatnVisitor<TNQVM_COMPLEX_TYPE>::resetExaTN() {
   exatn::sync();
 }
 
+template<typename TNQVM_COMPLEX_TYPE>
+bool ExatnVisitor<TNQVM_COMPLEX_TYPE>::isPersistentTensor(const std::string& in_tensorName) const {
+  if (!m_warmMode) {
+    return false;
+  }
+  if (m_gateTensorBodies.find(in_tensorName) != m_gateTensorBodies.end()) {
+    return true;
+  }
+  // Qubit register tensors: <prefix>Q<i>
+  if (in_tensorName.compare(0, m_tensorPrefix.size(), m_tensorPrefix) != 0) {
+    return false;
+  }
+  const std::string baseName = in_tensorName.substr(m_tensorPrefix.size());
+  return baseName.size() > 1 && baseName[0] == 'Q' &&
+         std::all_of(baseName.begin() + 1, baseName.end(), ::isdigit) &&
+         std::stoi(baseName.substr(1)) < m_warmNbQubits;
+}
+
+template<typename TNQVM_COMPLEX_TYPE>
+void ExatnVisitor<TNQVM_COMPLEX_TYPE>::releaseWarmTensors(bool in_releaseGateTensors) {
+  TNQVM_TELEMETRY_ZONE(__FUNCTION__, __FILE__, __LINE__);
+  for (int i = 0; i < m_warmNbQubits; ++i) {
+    const bool destroyed = exatn::destroyTensor(m_tensorPrefix + generateQubitTensorName(i));
+    assert(destroyed);
+  }
+  m_warmNbQubits = 0;
+  if (in_releaseGateTensors) {
+    for (const auto &iter : m_gateTensorBodies) {
+      const bool destroyed = exatn::destroyTensor(iter.first);
+      assert(destroyed);
+    }
+    m_gateTensorBodies.clear();
+  }
+  exatn::sync();
+}
+
 template<typename TNQVM_COMPLEX_TYPE>
 void ExatnVisitor<TNQVM_COMPLEX_TYPE>::resetNetwork() {
   TNQVM_TELEMETRY_ZONE(__FUNCTION__, __FILE__, __LINE__);
 
   // We must have evaluated the tensor network.
   assert(m_hasEvaluated);
-  const auto stateVec = retrieveStateVector();
+  resetNetwork(retrieveStateVector());
+}
+
+template<typename TNQVM_COMPLEX_TYPE>
+void ExatnVisitor<TNQVM_COMPLEX_TYPE>::resetNetwork(std::vector<TNQVM_COMPLEX_TYPE> stateVec) {
+  TNQVM_TELEMETRY_ZONE(__FUNCTION__, __FILE__, __LINE__);
   // Re-initialize ExaTN
   resetExaTN();
   // The new qubit register tensor name will have name "RESET_"
-  const std::string resetTensorName = "RESET_";
+  const std::string resetTensorName = m_tensorPrefix + "RESET_";
   // The qubit register tensor shape is {2, 2, 2, ...}, 1 leg for each qubit
   std::vector<int> qubitRegResetTensorShape(m_buffer->size(), 2);
   const bool created =
@@ -656,6 +893,30 @@ void ExatnVisitor<TNQVM_COMPLEX_TYPE>::resetNetwork() {
   m_hasEvaluated = false;
 }
 
+template<typename TNQVM_COMPLEX_TYPE>
+std::shared_ptr<TNQVMVisitorSnapshot> ExatnVisitor<TNQVM_COMPLEX_TYPE>::snapshotState() {
+  TNQVM_TELEMETRY_ZONE(__FUNCTION__, __FILE__, __LINE__);
+  // Snapshot is the (full) state vector.
+  if (m_buffer->size() > m_maxQubit || m_buffer->size() > MAX_NUMBER_QUBITS_FOR_STATE_VEC) {
+    return nullptr;
+  }
+  if (!m_hasEvaluated) {
+    evaluateNetwork();
+  }
+  auto snapshot = std::make_shared<StateVectorSnapshot>();
+  snapshot->stateVec = retrieveStateVector();
+  return snapshot;
+}
+
+template<typename TNQVM_COMPLEX_TYPE>
+void ExatnVisitor<TNQVM_COMPLEX_TYPE>::restoreState(const std::shared_ptr<TNQVMVisitorSnapshot>& in_snapshot) {
+  TNQVM_TELEMETRY_ZONE(__FUNCTION__, __FILE__, __LINE__);
+  auto snapshot = std::dynamic_pointer_cast<StateVectorSnapshot>(in_snapshot);
+  assert(snapshot && snapshot->stateVec.size() == (1ULL << m_buffer->size()));
+  // Continue from the snapshot state (as the "RESET_" tensor).
+  resetNetwork(snapshot->stateVec);
+}
+
 template<typename TNQVM_COMPLEX_TYPE>
 void ExatnVisitor<TNQVM_COMPLEX_TYPE>::finalize() {
   TNQVM_TELEMETRY_ZONE(__FUNCTION__, __FILE__, __LINE__);
@@ -682,6 +943,7 @@ void ExatnVisitor<TNQVM_COMPLEX_TYPE>::finalize() {
 
     const std::string optimizerName = options.stringExists("exatn-contract-seq-optimizer") ? options.getString("exatn-contract-seq-optimizer") : "metis";
     const auto startOpt = std::chrono::system_clock::now();
+    determineContractionSequence(combinedTensorNetwork);
     combinedTensorNetwork.getOperationList(optimizerName);
     const auto endOpt = std::chrono::system_clock::now();
     const int elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(endOpt - startOpt).count();
@@ -770,6 +1032,38 @@ void ExatnVisitor<TNQVM_COMPLEX_TYPE>::finalize() {
     return;
   }
 
+  // Amplitudes of a batch of bit strings
+  if (options.keyExists<std::vector<int>>("bitstring-batch"))
+  {
+    const auto bitStringBatch = options.get<std::vector<int>>("bitstring-batch");
+    if (bitStringBatch.empty() || bitStringBatch.size() % m_buffer->size() != 0)
+    {
+      xacc::error("Bitstring batch size must be a multiple of the number of qubits.");
+      return;
+    }
+    std::vector<std::vector<int>> bitStrings;
+    for (auto iter = bitStringBatch.begin(); iter != bitStringBatch.end(); iter += m_buffer->size())
+    {
+      bitStrings.emplace_back(iter, iter + m_buffer->size());
+    }
+    const auto amplitudes = computeAmplitudes(bitStrings);
+    std::vector<double> amplReal;
+    std::vector<double> amplImag;
+    amplReal.reserve(amplitudes.size());
+    amplImag.reserve(amplitudes.size());
+    for (const auto& val : amplitudes)
+    {
+      amplReal.emplace_back(val.real());
+      amplImag.emplace_back(val.imag());
+    }
+    m_buffer->addExtraInfo("amplitudes-real", amplReal);
+    m_buffer->addExtraInfo("amplitudes-imag", amplImag);
+    m_buffer.reset();
+    m_hasEvaluated = true;
+    resetExaTN();
+    return;
+  }
+
   // Validates ExaTN numerical backend: contract tensor network and its conjugate
   if (options.keyExists<bool>("contract-with-conjugate"))
   {
@@ -782,27 +1076,54 @@ void ExatnVisitor<TNQVM_COMPLEX_TYPE>::finalize() {
     return;
   }
 
-  if (m_buffer->size() > MAX_NUMBER_QUBITS_FOR_STATE_VEC && !m_measureQbIdx.empty() && m_shots > 0 && !m_hasEvaluated)
+  const std::string samplingMethod = options.stringExists("sampling-method") ? options.getString("sampling-method") : "rdm";
+  // Frugal sampling only needs wave-function slices: use it as soon as the
+  // state vector is too large.
+  const bool largeSamplingCircuit = (m_buffer->size() > MAX_NUMBER_QUBITS_FOR_STATE_VEC) ||
+                                    (samplingMethod == "frugal" && m_buffer->size() > m_maxQubit);
+  if (largeSamplingCircuit && !m_measureQbIdx.empty() && m_shots > 0 && !m_hasEvaluated)
   {
     std::cout << "Simulating bit string by tensor contraction and projection \n";
-    for (int i = 0; i < m_shots; ++i)
+    const auto convertToBitString = [](const std::vector<uint8_t>& in_bitVec){
+        std::string result;
+        for (const auto& bit : in_bitVec)
+        {
+            result.append(std::to_string(bit));
+        }
+        return result;
+    };
+    if (samplingMethod == "frugal")
     {
-      const auto convertToBitString = [](const std::vector<uint8_t>& in_bitVec){
-          std::string result;
-          for (const auto& bit : in_bitVec)
-          {
-              result.append(std::to_string(bit));
-          }
-          return result;
-      };
-
-      m_buffer->appendMeasurement(convertToBitString(generateMeasureSample(m_tensorNetwork, m_measureQbIdx)));
+      for (const auto& sample : generateFrugalSamples(m_shots))
+      {
+        m_buffer->appendMeasurement(convertToBitString(sample));
+      }
+    }
+    else
+    {
+      if (samplingMethod != "rdm")
+      {
+        xacc::error("Unknown 'sampling-method' parameter: " + samplingMethod);
+      }
+      for (int i = 0; i < m_shots; ++i)
+      {
+        m_buffer->appendMeasurement(convertToBitString(generateMeasureSample(m_tensorNetwork, m_measureQbIdx)));
+      }
     }
   }
   else
   {
-    if (m_buffer->size() > m_maxQubit) {
-      m_buffer->addExtraInfo("exp-val-z", internalComputeExpectationValueZ());
+    // With a memory budget, the method is always selected from the cost
+    // estimates (no shots).
+    const bool selectExpValStrategy =
+        (m_buffer->size() > m_maxQubit) ||
+        (m_memoryBudgetBytes > 0 && m_shots <= 0 && !m_measureQbIdx.empty());
+    const ExpValStrategy strategy = selectExpValStrategy
+                                        ? getExpValStrategy(m_measureQbIdx)
+                                        : ExpValStrategy::Direct;
+    if (strategy != ExpValStrategy::Direct) {
+      m_buffer->addExtraInfo("exp-val-z",
+                             internalComputeExpectationValueZ(strategy));
     } else {
       if (!m_hasEvaluated) {
         // If we haven't evaluated the network, do it now (end of circuit).
@@ -967,10 +1288,12 @@ void ExatnVisitor<TNQVM_COMPLEX_TYPE>::visit(fSim& in_fsimGate) {
 template<typename TNQVM_COMPLEX_TYPE>
 void ExatnVisitor<TNQVM_COMPLEX_TYPE>::visit(Measure &in_MeasureGate) {
   TNQVM_TELEMETRY_ZONE(__FUNCTION__, __FILE__, __LINE__);
-  if (m_buffer->size() > m_maxQubit)
+  if (m_buffer->size() > m_maxQubit ||
+      (m_memoryBudgetBytes > 0 && m_shots <= 0))
   {
     // If the circuit contains many qubits, we can only
     // generate bit string samples by contracting tensors in the end.
+    // With a memory budget, the exp-val-z method is selected at the end.
     const int measQubit = in_MeasureGate.bits()[0];
     m_measureQbIdx.emplace_back(measQubit);
     return;
@@ -1018,55 +1341,23 @@ void ExatnVisitor<TNQVM_COMPLEX_TYPE>::appendGateTensor(const xacc::Instruction
 
   const auto gateName = GetGateName(GateType);
   const GateInstanceIdentifier gateInstanceId(gateName, in_params...);
-  const std::string uniqueGateName = gateInstanceId.toNameString();
+  const std::string uniqueGateName =
+      m_tensorPrefix + gateInstanceId.toNameString();
   // If the tensor data for this gate hasn't been initialized before,
   // then initialize it.
   if (m_gateTensorBodies.find(uniqueGateName) == m_gateTensorBodies.end()) {
     const auto gateMatrixRaw= GetGateMatrix<GateType>(in_params...);
-    std::vector<std::vector<TNQVM_COMPLEX_TYPE>> gateMatrix;
+    std::vector<TNQVM_COMPLEX_TYPE> flatMatrix;
     for (auto& row : gateMatrixRaw)
     {
-      std::vector<TNQVM_COMPLEX_TYPE> rowConverted(row.begin(), row.end());
-      gateMatrix.emplace_back(std::move(rowConverted));
+      flatMatrix.insert(flatMatrix.end(), row.begin(), row.end());
     }
-    m_gateTensorBodies[uniqueGateName] = flattenGateMatrix(gateMatrix);
     // Currently, we only support 2-qubit gates.
     assert(in_gateInstruction.nRequiredBits() > 0 &&
            in_gateInstruction.nRequiredBits() <= 2);
-    const auto gateTensorShape =
-        (in_gateInstruction.nRequiredBits() == 1 ? TensorShape{2, 2}
-                                                 : TensorShape{2, 2, 2, 2});
-    // Create the tensor
-    const bool created = exatn::createTensor(
-        uniqueGateName, getExatnElementType(), gateTensorShape);
-    assert(created);
-    // Init tensor body data
-    exatn::initTensorData(uniqueGateName, flattenGateMatrix(gateMatrix));
-    // Register tensor isometry:
-    // For rank-2 gate isometric leg groups are: {0}, {1}.
-    // For rank-4 gate isometric leg groups are: {0,1}, {2,3}.
-    if (in_gateInstruction.nRequiredBits() == 1) {
-      const bool registered =
-          exatn::registerTensorIsometry(uniqueGateName, {0}, {1});
-      assert(registered);
-    } else if (in_gateInstruction.nRequiredBits() == 2) {
-      const bool registered =
-          exatn::registerTensorIsometry(uniqueGateName, {0, 1}, {2, 3});
-      assert(registered);
-    }
-  }
-
-  // Helper to create unique tensor names in the format
-  // <GateTypeName>_<Counter>, e.g. H2, CNOT5, etc. Note: this is different from
-  // the gate instance unique name which is referencing *unique* gate matrices.
-  // Multiple tensors can just refer to the same tensor body,
-  // for example, all H_k (Hadamard gates) in the circuit will all refer to a
-  // single *H* tensor body data.
-  const auto generateTensorName = [&]() -> std::string {
-    return GetGateName(GateType) + "_" + std::to_string(m_tensorIdCounter);
-  };
-
-  m_tensorIdCounter++;
+    createGateTensor(uniqueGateName, in_gateInstruction.nRequiredBits(),
+                     std::move(flatMatrix));
+  }
 
   // Because the qubit location and gate pairing are of different integer types,
   // we need to reconstruct the qubit vector.
@@ -1076,38 +1367,133 @@ void ExatnVisitor<TNQVM_COMPLEX_TYPE>::appendGateTensor(const xacc::Instruction
     gatePairing.emplace_back(qbitLoc);
   }
 
+  appendGateTensorToNetwork(gateName, uniqueGateName, IsControlGate(GateType),
+                            gatePairing);
+}
+
+template <typename TNQVM_COMPLEX_TYPE>
+bool ExatnVisitor<TNQVM_COMPLEX_TYPE>::visitTapeEntry(const TapeEntry &in_entry) {
+  if (in_entry.matrix.empty() || in_entry.qubits.size() > 2) {
+    return false;
+  }
+  if (m_hasEvaluated) {
+    // See appendGateTensor: the network must be reset before any gate tensor
+    // body is created.
+    resetNetwork();
+  }
+  // Precomputed matrix: no parameter conversion or matrix construction here.
+  const std::string uniqueGateName = m_tensorPrefix + in_entry.matrixKey;
+  if (m_gateTensorBodies.find(uniqueGateName) == m_gateTensorBodies.end()) {
+    createGateTensor(uniqueGateName, in_entry.qubits.size(),
+                     std::vector<TNQVM_COMPLEX_TYPE>(in_entry.matrix.begin(),
+                                                     in_entry.matrix.end()));
+  }
+  const std::vector<unsigned int> gatePairing(in_entry.qubits.begin(),
+                                              in_entry.qubits.end());
+  appendGateTensorToNetwork(in_entry.gate->name(), uniqueGateName,
+                            in_entry.isControlGate, gatePairing);
+  return true;
+}
+
+template <typename TNQVM_COMPLEX_TYPE>
+bool ExatnVisitor<TNQVM_COMPLEX_TYPE>::visitFusedUnitary(const FusedUnitary &in_gate) {
+  const auto &matrix = in_gate.getMatrix();
+  std::vector<TNQVM_COMPLEX_TYPE> flatMatrix(matrix.begin(), matrix.end());
+  const std::string uniqueGateName = m_tensorPrefix + in_gate.getMatrixKey();
+  const auto iter = m_gateTensorBodies.find(uniqueGateName);
+  if (iter != m_gateTensorBodies.end() && iter->second != flatMatrix) {
+    // Key collision (different fused matrices): visit the original gates.
+    return false;
+  }
+  if (m_hasEvaluated) {
+    // See appendGateTensor: the network must be reset before any gate tensor
+    // body is created.
+    resetNetwork();
+  }
+  if (m_gateTensorBodies.find(uniqueGateName) == m_gateTensorBodies.end()) {
+    createGateTensor(uniqueGateName, in_gate.nRequiredBits(),
+                     std::move(flatMatrix));
+  }
+  auto qubits = const_cast<FusedUnitary &>(in_gate).bits();
+  const std::vector<unsigned int> gatePairing(qubits.begin(), qubits.end());
+  // The fused matrix uses the same (first qubit is the MSB) convention as the
+  // controlled gates.
+  appendGateTensorToNetwork(in_gate.name(), uniqueGateName, true,
+                            gatePairing);
+  return true;
+}
+
+template <typename TNQVM_COMPLEX_TYPE>
+void ExatnVisitor<TNQVM_COMPLEX_TYPE>::createGateTensor(
+    const std::string &in_uniqueGateName, size_t in_nbQubits,
+    std::vector<TNQVM_COMPLEX_TYPE> &&in_flatMatrix) {
+  const auto gateTensorShape =
+      (in_nbQubits == 1 ? TensorShape{2, 2} : TensorShape{2, 2, 2, 2});
+  // Create the tensor
+  const bool created = exatn::createTensor(
+      in_uniqueGateName, getExatnElementType(), gateTensorShape);
+  assert(created);
+  // Init tensor body data
+  exatn::initTensorData(in_uniqueGateName, in_flatMatrix);
+  m_gateTensorBodies[in_uniqueGateName] = std::move(in_flatMatrix);
+  // Register tensor isometry:
+  // For rank-2 gate isometric leg groups are: {0}, {1}.
+  // For rank-4 gate isometric leg groups are: {0,1}, {2,3}.
+  if (in_nbQubits == 1) {
+    const bool registered =
+        exatn::registerTensorIsometry(in_uniqueGateName, {0}, {1});
+    assert(registered);
+  } else if (in_nbQubits == 2) {
+    const bool registered =
+        exatn::registerTensorIsometry(in_uniqueGateName, {0, 1}, {2, 3});
+    assert(registered);
+  }
+}
+
+template <typename TNQVM_COMPLEX_TYPE>
+void ExatnVisitor<TNQVM_COMPLEX_TYPE>::appendGateTensorToNetwork(
+    const std::string &in_gateName, const std::string &in_uniqueGateName,
+    bool in_isControlGate, std::vector<unsigned int> in_gatePairing) {
+  // Note: tensors in the network are named in the format
+  // <GateTypeName>_<Counter>, e.g. H2, CNOT5, etc. This is different from
+  // the gate instance unique name which is referencing *unique* gate matrices.
+  // Multiple tensors can just refer to the same tensor body,
+  // for example, all H_k (Hadamard gates) in the circuit will all refer to a
+  // single *H* tensor body data.
+  m_tensorIdCounter++;
+
   // For control gates (e.g. CNOT), we need to reverse the leg pairing because
   // the (Control Index, Target Index) convention is the opposite of the
   // MSB->LSB bit order when the CNOT matrix is specified. e.g. the state vector
   // is indexed by q1q0.
-  if (IsControlGate(GateType)) {
-    std::reverse(gatePairing.begin(), gatePairing.end());
+  if (in_isControlGate) {
+    std::reverse(in_gatePairing.begin(), in_gatePairing.end());
   }
 
   if (m_isAppendingCircuitGates) {
     // Append the gate tensor to the tracking list to apply inverse
     m_appendedGateTensors.emplace_back(
-        std::make_pair(uniqueGateName, gatePairing));
+        std::make_pair(in_uniqueGateName, in_gatePairing));
   }
 
   // Append the tensor for this gate to the network
   const bool appended = m_tensorNetwork.appendTensorGate(
       m_tensorIdCounter,
       // Get the gate tensor data which must have been initialized.
-      exatn::getTensor(uniqueGateName),
+      exatn::getTensor(in_uniqueGateName),
       // which qubits that the gate is acting on
-      gatePairing);
+      in_gatePairing);
   if (!appended) {
-    const std::string gatePairingString = [&gatePairing](){
+    const std::string gatePairingString = [&in_gatePairing](){
       std::stringstream ss;
       ss << "{";
-      for (const auto& pairIdx : gatePairing) {
+      for (const auto& pairIdx : in_gatePairing) {
         ss << pairIdx << ",";
       }
       ss << "}";
       return ss.str();
     }();
-    xacc::error("Failed to append tensor for gate " + in_gateInstruction.name() + ", pairing = " + gatePairingString);
+    xacc::error("Failed to append tensor for gate " + in_gateName + ", pairing = " + gatePairingString);
   }
 }
 
@@ -1123,7 +1509,7 @@ TNQVM_COMPLEX_TYPE ExatnVisitor<TNQVM_COMPLEX_TYPE>::observableExpValCalc(
     std::shared_ptr<CompositeInstruction> &in_function,
     const std::vector<ObservableTerm> &in_observableExpression) {
   TNQVM_TELEMETRY_ZONE(__FUNCTION__, __FILE__, __LINE__);
-  if (!m_appendedGateTensors.empty() || !m_gateTensorBodies.empty()) {
+  if (!m_appendedGateTensors.empty() || (!m_gateTensorBodies.empty() && !m_warmMode)) {
     // We don't support mixing this *observable* mode of execution with the
     // regular mode.
     xacc::error("observableExpValCalc can only be called on an ExatnVisitor "
@@ -1134,16 +1520,60 @@ TNQVM_COMPLEX_TYPE ExatnVisitor<TNQVM_COMPLEX_TYPE>::observableExpValCalc(
   BaseInstructionVisitor *visitorCast =
       static_cast<BaseInstructionVisitor *>(this);
   this->initialize(in_buffer, -1);
-  // Walk the IR tree, and visit each node
+  std::vector<std::shared_ptr<Instruction>> gates;
+  std::vector<std::vector<size_t>> gateQubits;
   InstructionIterator it(in_function);
   while (it.hasNext()) {
     auto nextInst = it.next();
-    if (nextInst->isEnabled()) {
-      nextInst->accept(visitorCast);
+    if (nextInst->isEnabled() && !nextInst->isComposite()) {
+      gates.emplace_back(nextInst);
+      gateQubits.emplace_back(nextInst->bits());
+    }
+  }
+
+  // Light-cone pruning: gates outside the backward light cone of the qubits
+  // of a term cancel out in <psi|Term|psi>. Terms with the same light cone
+  // are evaluated on the same (reduced) circuit network.
+  // Otherwise, a single group: all terms on the full circuit network.
+  const bool lightCone =
+      options.keyExists<bool>("light-cone") && options.get<bool>("light-cone");
+  std::vector<std::vector<size_t>> cones;
+  std::vector<std::vector<ObservableTerm>> coneTerms;
+  if (lightCone) {
+    std::map<std::vector<size_t>, size_t> coneToGroup;
+    for (const auto &term : in_observableExpression) {
+      std::vector<size_t> termQubits;
+      for (const auto &op : term.operators) {
+        const auto bits = op->bits();
+        termQubits.insert(termQubits.end(), bits.begin(), bits.end());
+      }
+      auto cone = lightcone::computeLightCone(gateQubits, termQubits);
+      const auto [iter, isNewCone] = coneToGroup.emplace(cone, cones.size());
+      if (isNewCone) {
+        cones.emplace_back(std::move(cone));
+        coneTerms.emplace_back();
+      }
+      coneTerms[iter->second].emplace_back(term);
     }
+  } else {
+    cones.emplace_back(gates.size());
+    std::iota(cones.back().begin(), cones.back().end(), 0);
+    coneTerms.emplace_back(in_observableExpression);
   }
 
-  const auto result = expVal(in_observableExpression);
+  // Network of the qubit register only
+  const auto initialNetwork = m_tensorNetwork;
+  const auto initialIdCounter = m_tensorIdCounter;
+  TNQVM_COMPLEX_TYPE result = 0.0;
+  for (size_t coneIdx = 0; coneIdx < cones.size(); ++coneIdx) {
+    m_tensorNetwork = initialNetwork;
+    m_tensorIdCounter = initialIdCounter;
+    m_appendedGateTensors.clear();
+    for (const auto &gateIdx : cones[coneIdx]) {
+      gates[gateIdx]->accept(visitorCast);
+    }
+    result += expVal(coneTerms[coneIdx]);
+  }
   // Set Evaluated flag, hence no need to evaluate the original circuit anymore.
   // (we have calculated the expectation value by closing the entire tensor
   // network)
@@ -1187,7 +1617,7 @@ TNQVM_COMPLEX_TYPE ExatnVisitor<TNQVM_COMPLEX_TYPE>::evaluateTerm(
 
   {
     TNQVM_TELEMETRY_ZONE("exatn::evaluateSync", __FILE__, __LINE__);
-
+    determineContractionSequence(m_tensorNetwork);
     if (exatn::evaluateSync(m_tensorNetwork)) {
       exatn::sync();
       auto talsh_tensor =
@@ -1245,7 +1675,7 @@ std::vector<TNQVM_COMPLEX_TYPE> ExatnVisitor<TNQVM_COMPLEX_TYPE>::getReducedDens
     std::shared_ptr<CompositeInstruction> &in_function,
     const std::vector<size_t> &in_qubitIdx) {
   TNQVM_TELEMETRY_ZONE(__FUNCTION__, __FILE__, __LINE__);
-  if (!m_appendedGateTensors.empty() || !m_gateTensorBodies.empty()) {
+  if (!m_appendedGateTensors.empty() || (!m_gateTensorBodies.empty() && !m_warmMode)) {
     // We don't support mixing this *RDM* mode of execution with the regular
     // mode.
     // TODO: Adding runtime logic to determine if we need to use this mode on
@@ -1291,6 +1721,7 @@ std::vector<TNQVM_COMPLEX_TYPE> ExatnVisitor<TNQVM_COMPLEX_TYPE>::getReducedDens
     combinedNetwork.appendTensorNetwork(std::move(inverseTensorNetwork),
                                         pairings);
     const bool collapsed = combinedNetwork.collapseIsometries();
+    determineContractionSequence(combinedNetwork);
 
     if (exatn::evaluateSync(combinedNetwork)) {
       exatn::sync();
@@ -1318,119 +1749,54 @@ std::vector<uint8_t> ExatnVisitor<TNQVM_COMPLEX_TYPE>::getMeasureSample(
     std::shared_ptr<CompositeInstruction> &in_function,
     const std::vector<size_t> &in_qubitIdx) {
   TNQVM_TELEMETRY_ZONE(__FUNCTION__, __FILE__, __LINE__);
-  if (!m_appendedGateTensors.empty() || !m_gateTensorBodies.empty()) {
+  if (!m_appendedGateTensors.empty() || (!m_gateTensorBodies.empty() && !m_warmMode)) {
     xacc::error("getMeasureSample can only be called on an ExatnVisitor that "
                 "is not executing a circuit.");
     return {};
   }
 
-  std::vector<uint8_t> resultBitString;
-  std::vector<ExatnVisitor<TNQVM_COMPLEX_TYPE>::TNQVM_FLOAT_TYPE> resultProbs;
-  for (const auto &qubitIdx : in_qubitIdx) {
-    std::vector<TNQVM_COMPLEX_TYPE> resultRDM;
-
-    BaseInstructionVisitor *visitorCast =
-        static_cast<BaseInstructionVisitor *>(this);
-    this->initialize(in_buffer, -1);
-    // Walk the IR tree, and visit each node
-    InstructionIterator it(in_function);
-    while (it.hasNext()) {
-      auto nextInst = it.next();
-      if (nextInst->isEnabled() && nextInst->name() != "Measure") {
-        nextInst->accept(visitorCast);
-      }
-    }
-
-    auto inverseTensorNetwork = m_tensorNetwork;
-    inverseTensorNetwork.rename("Inverse Tensor Network");
-    inverseTensorNetwork.conjugate();
-
-    {
-      {
-        // Adding collapse tensors based on previous measurement results.
-        // i.e. condition/renormalize the tensor network to be consistent with
-        // previous result.
-        for (size_t measIdx = 0; measIdx < resultBitString.size(); ++measIdx) {
-          const unsigned int qId = in_qubitIdx[measIdx];
-          m_tensorIdCounter++;
-          // If it was a "0":
-          if (resultBitString[measIdx] == 0) {
-            const std::vector<TNQVM_COMPLEX_TYPE> COLLAPSE_0{
-                // Renormalize based on the probability of this outcome
-                {1.0f / resultProbs[measIdx], 0.0},
-                {0.0, 0.0},
-                {0.0, 0.0},
-                {0.0, 0.0}};
-
-            const std::string tensorName =
-                "COLLAPSE_0_" + std::to_string(measIdx);
-            const bool created = exatn::createTensor(
-                tensorName, getExatnElementType(),
-                TensorShape{2, 2});
-            assert(created);
-            const bool registered =
-                (exatn::registerTensorIsometry(tensorName, {0}, {1}));
-            assert(registered);
-            const bool initialized =
-                exatn::initTensorData(tensorName, COLLAPSE_0);
-            assert(initialized);
-            const bool appended = m_tensorNetwork.appendTensorGate(
-                m_tensorIdCounter, exatn::getTensor(tensorName), {qId});
-            assert(appended);
-          } else {
-            assert(resultBitString[measIdx] == 1);
-            // Renormalize based on the probability of this outcome
-            const std::vector<TNQVM_COMPLEX_TYPE> COLLAPSE_1{
-                {0.0, 0.0},
-                {0.0, 0.0},
-                {0.0, 0.0},
-                {1.0f / resultProbs[measIdx], 0.0}};
-
-            const std::string tensorName =
-                "COLLAPSE_1_" + std::to_string(measIdx);
-            const bool created = exatn::createTensor(
-                tensorName, getExatnElementType(),
-                TensorShape{2, 2});
-            assert(created);
-            const bool registered =
-                (exatn::registerTensorIsometry(tensorName, {0}, {1}));
-            assert(registered);
-            const bool initialized =
-                exatn::initTensorData(tensorName, COLLAPSE_1);
-            assert(initialized);
-            const bool appended = m_tensorNetwork.appendTensorGate(
-                m_tensorIdCounter, exatn::getTensor(tensorName), {qId});
-            assert(appended);
-          }
-        }
-      }
-
-      auto combinedNetwork = m_tensorNetwork;
-      combinedNetwork.rename("Combined Tensor Network");
-      {
-        // Append the conjugate network to calculate the RDM of the measure
-        // qubit
-        std::vector<std::pair<unsigned int, unsigned int>> pairings;
-        for (size_t i = 0; i < m_buffer->size(); ++i) {
-          // Connect the original tensor network with its inverse
-          // but leave the measure qubit line open.
-          if (i != qubitIdx) {
-            pairings.emplace_back(std::make_pair(i, i));
-          }
-        }
+  auto &cache = m_samplingNetworkCache;
+  // Only the first shot builds the conditioned networks: the next shots of the
+  // same circuit only update the projector tensor bodies.
+  const std::string circuitKey = in_function->toString();
+  if (cache.conditionedNetworks.empty() || cache.circuitKey != circuitKey ||
+      cache.nbQubits != in_buffer->size() || cache.qubitIdx != in_qubitIdx) {
+    buildSamplingNetworkCache(in_buffer, in_function, in_qubitIdx, circuitKey);
+  }
 
-        combinedNetwork.appendTensorNetwork(std::move(inverseTensorNetwork),
-                                            pairings);
-        const bool collapsed = combinedNetwork.collapseIsometries();
+  std::vector<uint8_t> resultBitString;
+  std::vector<double> resultProbs;
+  for (size_t measIdx = 0; measIdx < in_qubitIdx.size(); ++measIdx) {
+    const auto qubitIdx = in_qubitIdx[measIdx];
+    // Marginal of this qubit conditioned on the sampled prefix (previous shots
+    // may have computed it).
+    std::array<double, 2> marginal{0.0, 0.0};
+    if (!cache.marginals.find(resultBitString, marginal)) {
+      // Condition the network on the previous measurement results: update the
+      // projector tensors (in-place) which differ from the previous evaluation.
+      for (const auto &projIdx : sampling::updateProjectorStates(
+               cache.projectorStates, resultBitString, resultProbs, measIdx)) {
+        // Renormalize based on the probability of this outcome
+        const TNQVM_COMPLEX_TYPE normFactor(1.0 / resultProbs[projIdx], 0.0);
+        const std::vector<TNQVM_COMPLEX_TYPE> PROJECTOR =
+            (resultBitString[projIdx] == 0)
+                ? std::vector<TNQVM_COMPLEX_TYPE>{normFactor, {0.0, 0.0}, {0.0, 0.0}, {0.0, 0.0}}
+                : std::vector<TNQVM_COMPLEX_TYPE>{{0.0, 0.0}, {0.0, 0.0}, {0.0, 0.0}, normFactor};
+        const bool initialized =
+            exatn::initTensorData(cache.projectorNames[projIdx], PROJECTOR);
+        assert(initialized);
       }
 
+      std::vector<TNQVM_COMPLEX_TYPE> resultRDM;
+      auto &conditionedNetwork = cache.conditionedNetworks[measIdx];
       // Evaluate
       {
         TNQVM_TELEMETRY_ZONE("exatn::evaluateSync", __FILE__, __LINE__);
-        if (exatn::evaluateSync(combinedNetwork)) {
+        if (exatn::evaluateSync(conditionedNetwork)) {
           exatn::sync();
-          auto talsh_tensor =
-              exatn::getLocalTensor(combinedNetwork.getTensor(0)->getName());
+          const std::string outputTensorName =
+              conditionedNetwork.getTensor(0)->getName();
+          auto talsh_tensor = exatn::getLocalTensor(outputTensorName);
           const auto tensorVolume = talsh_tensor->getVolume();
           // Single qubit density matrix
           assert(tensorVolume == 4);
@@ -1438,7 +1804,7 @@ std::vector<uint8_t> ExatnVisitor<TNQVM_COMPLEX_TYPE>::getMeasureSample(
           if (talsh_tensor->getDataAccessHostConst(&body_ptr)) {
             resultRDM.assign(body_ptr, body_ptr + tensorVolume);
           }
-  #ifdef _DEBUG_LOG_ENABLED
+#ifdef _DEBUG_LOG_ENABLED
           // Debug: print out RDM data
           {
             std::cout << "RDM @q" << qubitIdx << " = [";
@@ -1448,19 +1814,25 @@ std::vector<uint8_t> ExatnVisitor<TNQVM_COMPLEX_TYPE>::getMeasureSample(
             }
             std::cout << "]\n";
           }
-  #endif
+#endif
+          // The network is evaluated again by the next shots: its output
+          // tensor is created by each evaluation.
+          talsh_tensor.reset();
+          const bool destroyed = exatn::destroyTensorSync(outputTensorName);
+          assert(destroyed);
         }
       }
+      assert(resultRDM.size() == 4);
+      marginal = {resultRDM.front().real(), resultRDM.back().real()};
+      assert(marginal[0] >= 0.0 && marginal[1] >= 0.0);
+      assert(std::fabs(1.0 - marginal[0] - marginal[1]) < 1e-12);
+      cache.marginals.insert(resultBitString, marginal);
     }
 
     {
       // Perform the measurement
-      assert(resultRDM.size() == 4);
-      const double prob_0 = resultRDM.front().real();
-      const double prob_1 = resultRDM.back().real();
-      assert(prob_0 >= 0.0 && prob_1 >= 0.0);
-      assert(std::fabs(1.0 - prob_0 - prob_1) < 1e-12);
-
+      const double prob_0 = marginal[0];
+      const double prob_1 = marginal[1];
       // Generate a random number
       const double randProbPick = generateRandomProbability();
       // If radom number < probability of 0 state -> pick zero, and vice versa.
@@ -1479,77 +1851,351 @@ std::vector<uint8_t> ExatnVisitor<TNQVM_COMPLEX_TYPE>::getMeasureSample(
       }
 #endif
     }
-
-    {
-      m_hasEvaluated = true;
-      finalize();
-    }
   }
 
+  // Number of conditioned network contractions (misses) and of marginals
+  // reused from the previous shots (hits).
+  executionInfo.insert("sampling-marginal-cache-hits",
+                       static_cast<int>(cache.marginals.getHits()));
+  executionInfo.insert("sampling-marginal-cache-misses",
+                       static_cast<int>(cache.marginals.getMisses()));
   return resultBitString;
 }
 
 template<typename TNQVM_COMPLEX_TYPE>
-const double ExatnVisitor<TNQVM_COMPLEX_TYPE>::getExpectationValueZ(
-    std::shared_ptr<CompositeInstruction> in_function) {
+void ExatnVisitor<TNQVM_COMPLEX_TYPE>::buildSamplingNetworkCache(
+    std::shared_ptr<AcceleratorBuffer> &in_buffer,
+    std::shared_ptr<CompositeInstruction> &in_function,
+    const std::vector<size_t> &in_qubitIdx, const std::string &in_circuitKey) {
   TNQVM_TELEMETRY_ZONE(__FUNCTION__, __FILE__, __LINE__);
-  if (!m_buffer) {
-    xacc::error("Please initialize the visitor backend before calling "
-                "getExpectationValueZ()!");
-    return 0.0;
-  }
-  // The number of qubits exceed the limit for full wave-function contraction,
-  // hence we cannot cache the wavefunction.
-  if (m_buffer->size() > m_maxQubit) {
-    // Need to slice.
-    m_kernelName = in_function->name();
-    return internalComputeExpectationValueZ(in_function);
+  BaseInstructionVisitor *visitorCast =
+      static_cast<BaseInstructionVisitor *>(this);
+  // Note: this releases the previous cache (if any).
+  this->initialize(in_buffer, -1);
+  // Walk the IR tree, and visit each node
+  InstructionIterator it(in_function);
+  while (it.hasNext()) {
+    auto nextInst = it.next();
+    if (nextInst->isEnabled() && nextInst->name() != "Measure") {
+      nextInst->accept(visitorCast);
+    }
   }
 
-  // The new qubit register tensor name will have name "RESET_"
-  const std::string resetTensorName = "RESET_";
-  if (!m_hasEvaluated)
-  {
-    {
-      TNQVM_TELEMETRY_ZONE("exatn::evaluateSync", __FILE__, __LINE__);
-      const bool evaluated = exatn::evaluateSync(m_tensorNetwork);
-      assert(evaluated);
-      // Synchronize:
-      exatn::sync();
-      m_cacheStateVec = retrieveStateVector();
+  auto &cache = m_samplingNetworkCache;
+  cache.circuitKey = in_circuitKey;
+  cache.nbQubits = m_buffer->size();
+  cache.qubitIdx = in_qubitIdx;
+  // The cache takes over the tensors of the circuit network (except the
+  // persistent ones of warm mode), i.e. they outlive this execution.
+  std::unordered_set<std::string> tensorList;
+  for (auto iter = m_tensorNetwork.cbegin(); iter != m_tensorNetwork.cend();
+       ++iter) {
+    const auto &tensorName = iter->second.getTensor()->getName();
+    // Not a root tensor
+    if (!tensorName.empty() && tensorName[0] != '_' &&
+        !isPersistentTensor(tensorName)) {
+      tensorList.emplace(tensorName);
     }
+  }
+  if (!m_warmMode) {
+    for (const auto &iter : m_gateTensorBodies) {
+      tensorList.emplace(iter.first);
+    }
+    m_gateTensorBodies.clear();
+  }
+  cache.tensorNames.assign(tensorList.begin(), tensorList.end());
+  const TensorNetwork circuitNetwork = m_tensorNetwork;
+  m_appendedGateTensors.clear();
+  m_tensorNetwork = TensorNetwork();
+  m_hasEvaluated = true;
+  m_buffer.reset();
+  // Nothing left to destroy.
+  resetExaTN();
 
-    // State vector after the base ansatz
-    assert(m_cacheStateVec.size() == (1ULL << m_buffer->size()));
-
-    // The qubit register tensor shape is {2, 2, 2, ...}, 1 leg for each qubit
-    std::vector<int> qubitRegResetTensorShape(m_buffer->size(), 2);
-    const bool created = exatn::createTensor(resetTensorName, getExatnElementType(), qubitRegResetTensorShape);
+  // Projector tensors of all but the last measured qubit: their bodies are set
+  // (in-place) before each evaluation.
+  for (size_t measIdx = 0; measIdx + 1 < in_qubitIdx.size(); ++measIdx) {
+    const std::string tensorName =
+        m_tensorPrefix + "PROJECTOR_" + std::to_string(measIdx);
+    const bool created = exatn::createTensor(
+        tensorName, getExatnElementType(), TensorShape{2, 2});
     assert(created);
-    // Initialize the tensor body with the state vector from the previous
-    // evaluation.
-    const bool initialized = exatn::initTensorData(resetTensorName, m_cacheStateVec);
-    assert(initialized);
-    for (auto iter = m_qubitRegTensor.cbegin(); iter != m_qubitRegTensor.cend(); ++iter)
-    {
-      const auto& tensorName = iter->second.getTensor()->getName();
-      // Not a root tensor
-      if (!tensorName.empty() && tensorName[0] != '_')
-      {
-        const bool destroyed = exatn::destroyTensorSync(tensorName);
-        assert(destroyed);
+    cache.projectorNames.emplace_back(tensorName);
+    cache.tensorNames.emplace_back(tensorName);
+  }
+  cache.projectorStates.resize(cache.projectorNames.size());
+
+  // Network of the RDM of each measured qubit, conditioned on the results of
+  // the previous ones.
+  for (size_t measIdx = 0; measIdx < in_qubitIdx.size(); ++measIdx) {
+    TensorNetwork combinedNetwork(circuitNetwork);
+    combinedNetwork.rename("Combined Tensor Network " + std::to_string(measIdx));
+    auto tensorIdCounter = combinedNetwork.getMaxTensorId();
+    for (size_t projIdx = 0; projIdx < measIdx; ++projIdx) {
+      const unsigned int qId = in_qubitIdx[projIdx];
+      tensorIdCounter++;
+      const bool appended = combinedNetwork.appendTensorGate(
+          tensorIdCounter, exatn::getTensor(cache.projectorNames[projIdx]),
+          {qId});
+      assert(appended);
+    }
+
+    auto inverseTensorNetwork = circuitNetwork;
+    inverseTensorNetwork.rename("Inverse Tensor Network");
+    inverseTensorNetwork.conjugate();
+    // Append the conjugate network to calculate the RDM of the measure qubit
+    std::vector<std::pair<unsigned int, unsigned int>> pairings;
+    for (size_t i = 0; i < cache.nbQubits; ++i) {
+      // Connect the original tensor network with its inverse
+      // but leave the measure qubit line open.
+      if (i != in_qubitIdx[measIdx]) {
+        pairings.emplace_back(std::make_pair(i, i));
       }
     }
+    combinedNetwork.appendTensorNetwork(std::move(inverseTensorNetwork),
+                                        pairings);
+    combinedNetwork.collapseIsometries();
+    // The contraction sequence is determined by the first evaluation and kept
+    // by the network for the next shots.
+    determineContractionSequence(combinedNetwork);
+    cache.conditionedNetworks.emplace_back(std::move(combinedNetwork));
   }
+}
 
-  // Create a new tensor network
-  m_tensorNetwork = TensorNetwork(in_function->name());
-  // Reset counter
-  m_tensorIdCounter = 1;
-  m_measureQbIdx.clear();
-  // Use the root tensor from previous evaluation as the initial tensor
-  m_tensorNetwork.appendTensor(m_tensorIdCounter, exatn::getTensor(resetTensorName), std::vector<std::pair<unsigned int, unsigned int>>{});
-  // Walk the remaining circuit and visit all gates
+template<typename TNQVM_COMPLEX_TYPE>
+void ExatnVisitor<TNQVM_COMPLEX_TYPE>::releaseSamplingNetworkCache() {
+  TNQVM_TELEMETRY_ZONE(__FUNCTION__, __FILE__, __LINE__);
+  const bool hasTensors = !m_samplingNetworkCache.tensorNames.empty();
+  for (const auto &tensorName : m_samplingNetworkCache.tensorNames) {
+    const bool destroyed = exatn::destroyTensor(tensorName);
+    assert(destroyed);
+  }
+  m_samplingNetworkCache = SamplingNetworkCache();
+  if (hasTensors) {
+    exatn::sync();
+  }
+}
+
+template<typename TNQVM_COMPLEX_TYPE>
+const double ExatnVisitor<TNQVM_COMPLEX_TYPE>::getExpectationValueZ(
+    std::shared_ptr<CompositeInstruction> in_function) {
+  TNQVM_TELEMETRY_ZONE(__FUNCTION__, __FILE__, __LINE__);
+  if (!m_buffer) {
+    xacc::error("Please initialize the visitor backend before calling "
+                "getExpectationValueZ()!");
+    return 0.0;
+  }
+  // The number of qubits exceed the limit for full wave-function contraction
+  // (or the memory budget), hence we cannot cache the wavefunction.
+  if (m_buffer->size() > m_maxQubit || m_memoryBudgetBytes > 0) {
+    std::vector<int> measureQubits;
+    InstructionIterator it(in_function);
+    while (it.hasNext()) {
+      auto nextInst = it.next();
+      if (nextInst->isEnabled() && nextInst->name() == "Measure") {
+        measureQubits.emplace_back(nextInst->bits()[0]);
+      }
+    }
+    const ExpValStrategy strategy = getExpValStrategy(measureQubits);
+    if (strategy != ExpValStrategy::Direct) {
+      m_kernelName = in_function->name();
+      return internalComputeExpectationValueZ(strategy, in_function);
+    }
+  }
+
+  cacheAnsatzStateVector();
+  {
+    // Apply the change of basis in-place on a copy of the cached state vector
+    // (no tensor network construction and evaluation).
+    SingleQubitGateList basisChangeGates;
+    std::vector<int> measureQbIdx;
+    if (getBasisChangeGates(in_function, basisChangeGates, measureQbIdx)) {
+      assert(!measureQbIdx.empty());
+      if (basisChangeGates.empty()) {
+        return calcExpValueZ(measureQbIdx, m_cacheStateVec);
+      }
+      auto stateVec = m_cacheStateVec;
+      for (const auto &gate : basisChangeGates) {
+        kernels::applySingleQubitGate(stateVec, gate.first, gate.second);
+      }
+      return calcExpValueZ(measureQbIdx, stateVec);
+    }
+  }
+
+  // Fallback: evaluate the change of basis as a tensor network.
+  const size_t nbBasisChangeInsts = constructBasisChangeNetwork(in_function);
+  assert(!m_measureQbIdx.empty());
+  // If there are basis change instructions:
+  // i.e. not Z basis
+  if (nbBasisChangeInsts > 0)
+  {
+    TNQVM_TELEMETRY_ZONE("exatn::evaluateSync", __FILE__, __LINE__);
+    determineContractionSequence(m_tensorNetwork);
+    const bool evaluated = exatn::evaluateSync(m_tensorNetwork);
+    assert(evaluated);
+  }
+  m_hasEvaluated = true;
+  const double exp_val_z = (nbBasisChangeInsts > 0) ? calcExpValueZ(m_measureQbIdx, retrieveStateVector()) :  calcExpValueZ(m_measureQbIdx, m_cacheStateVec);
+  m_measureQbIdx.clear();
+  return exp_val_z;
+}
+
+template<typename TNQVM_COMPLEX_TYPE>
+std::vector<double> ExatnVisitor<TNQVM_COMPLEX_TYPE>::getExpectationValueZBatch(
+    const std::vector<std::shared_ptr<CompositeInstruction>>& in_functions) {
+  TNQVM_TELEMETRY_ZONE(__FUNCTION__, __FILE__, __LINE__);
+  if (!m_buffer) {
+    xacc::error("Please initialize the visitor backend before calling "
+                "getExpectationValueZBatch()!");
+    return {};
+  }
+  // Large circuits: no state vector, evaluate term-by-term.
+  if (m_buffer->size() > m_maxQubit) {
+    return TNQVMVisitor::getExpectationValueZBatch(in_functions);
+  }
+
+  // Group the observed sub-circuits by their change-of-basis signature,
+  // i.e. the sequence of non-measure instructions.
+  std::vector<std::string> basisSignatures;
+  std::unordered_map<std::string, std::vector<size_t>> basisGroups;
+  for (size_t i = 0; i < in_functions.size(); ++i) {
+    std::string signature;
+    InstructionIterator it(in_functions[i]);
+    while (it.hasNext()) {
+      auto nextInst = it.next();
+      if (nextInst->isEnabled() && !nextInst->isComposite() &&
+          nextInst->name() != "Measure") {
+        signature.append(nextInst->toString() + ";");
+      }
+    }
+    auto &group = basisGroups[signature];
+    if (group.empty()) {
+      basisSignatures.emplace_back(signature);
+    }
+    group.emplace_back(i);
+  }
+
+  std::vector<double> result(in_functions.size(), 0.0);
+  for (const auto &signature : basisSignatures) {
+    const auto &group = basisGroups[signature];
+    cacheAnsatzStateVector();
+    // All sub-circuits in the group have the same change of basis:
+    // use the first one to compute the probability vector in that basis.
+    std::vector<double> probVec;
+    SingleQubitGateList basisChangeGates;
+    std::vector<int> measureQbIdx;
+    if (getBasisChangeGates(in_functions[group.front()], basisChangeGates,
+                            measureQbIdx)) {
+      if (basisChangeGates.empty()) {
+        probVec = kernels::getProbabilities(m_cacheStateVec);
+      } else {
+        auto stateVec = m_cacheStateVec;
+        for (const auto &gate : basisChangeGates) {
+          kernels::applySingleQubitGate(stateVec, gate.first, gate.second);
+        }
+        probVec = kernels::getProbabilities(stateVec);
+      }
+    } else {
+      // Fallback: evaluate the change of basis as a tensor network.
+      const size_t nbBasisChangeInsts =
+          constructBasisChangeNetwork(in_functions[group.front()]);
+      m_measureQbIdx.clear();
+      if (nbBasisChangeInsts > 0) {
+        TNQVM_TELEMETRY_ZONE("exatn::evaluateSync", __FILE__, __LINE__);
+        determineContractionSequence(m_tensorNetwork);
+        const bool evaluated = exatn::evaluateSync(m_tensorNetwork);
+        assert(evaluated);
+      }
+      m_hasEvaluated = true;
+      probVec = kernels::getProbabilities(
+          (nbBasisChangeInsts > 0) ? retrieveStateVector() : m_cacheStateVec);
+    }
+
+    // After the transform, element at index 'mask' is the expectation value
+    // of the Z-string on qubits in 'mask'.
+    {
+      TNQVM_TELEMETRY_ZONE("fastWalshHadamardTransform", __FILE__, __LINE__);
+      kernels::fastWalshHadamardTransform(probVec);
+    }
+    for (const auto &functionIdx : group) {
+      std::vector<int> measureQbIdx;
+      InstructionIterator it(in_functions[functionIdx]);
+      while (it.hasNext()) {
+        auto nextInst = it.next();
+        if (nextInst->isEnabled() && !nextInst->isComposite() &&
+            nextInst->name() == "Measure") {
+          measureQbIdx.emplace_back(nextInst->bits()[0]);
+        }
+      }
+      assert(!measureQbIdx.empty());
+      result[functionIdx] = probVec[kernels::getQubitMask(measureQbIdx)];
+    }
+  }
+
+  return result;
+}
+
+template<typename TNQVM_COMPLEX_TYPE>
+void ExatnVisitor<TNQVM_COMPLEX_TYPE>::cacheAnsatzStateVector() {
+  TNQVM_TELEMETRY_ZONE(__FUNCTION__, __FILE__, __LINE__);
+  // Already cached (evaluated)
+  if (m_hasEvaluated) {
+    return;
+  }
+
+  // The new qubit register tensor name will have name "RESET_"
+  const std::string resetTensorName = m_tensorPrefix + "RESET_";
+  {
+    TNQVM_TELEMETRY_ZONE("exatn::evaluateSync", __FILE__, __LINE__);
+    determineContractionSequence(m_tensorNetwork);
+    const bool evaluated = exatn::evaluateSync(m_tensorNetwork);
+    assert(evaluated);
+    // Synchronize:
+    exatn::sync();
+    m_cacheStateVec = retrieveStateVector();
+  }
+
+  // State vector after the base ansatz
+  assert(m_cacheStateVec.size() == (1ULL << m_buffer->size()));
+
+  // The qubit register tensor shape is {2, 2, 2, ...}, 1 leg for each qubit
+  std::vector<int> qubitRegResetTensorShape(m_buffer->size(), 2);
+  const bool created = exatn::createTensor(resetTensorName, getExatnElementType(), qubitRegResetTensorShape);
+  assert(created);
+  // Initialize the tensor body with the state vector from the previous
+  // evaluation.
+  const bool initialized = exatn::initTensorData(resetTensorName, m_cacheStateVec);
+  assert(initialized);
+  for (auto iter = m_qubitRegTensor.cbegin(); iter != m_qubitRegTensor.cend(); ++iter)
+  {
+    const auto& tensorName = iter->second.getTensor()->getName();
+    // Not a root tensor (qubit tensors are kept alive in warm mode)
+    if (!tensorName.empty() && tensorName[0] != '_' && !isPersistentTensor(tensorName))
+    {
+      const bool destroyed = exatn::destroyTensorSync(tensorName);
+      assert(destroyed);
+    }
+  }
+  // The base network is now just the cached state:
+  // the qubit register tensors are no longer referenced.
+  m_tensorNetwork = TensorNetwork(m_tensorPrefix + m_kernelName);
+  m_tensorIdCounter = 1;
+  m_tensorNetwork.appendTensor(m_tensorIdCounter, exatn::getTensor(resetTensorName), std::vector<std::pair<unsigned int, unsigned int>>{});
+  m_hasEvaluated = true;
+}
+
+template<typename TNQVM_COMPLEX_TYPE>
+size_t ExatnVisitor<TNQVM_COMPLEX_TYPE>::constructBasisChangeNetwork(
+    std::shared_ptr<CompositeInstruction> in_function) {
+  const std::string resetTensorName = m_tensorPrefix + "RESET_";
+  // Create a new tensor network
+  m_tensorNetwork = TensorNetwork(m_tensorPrefix + in_function->name());
+  // Reset counter
+  m_tensorIdCounter = 1;
+  m_measureQbIdx.clear();
+  // Use the root tensor from previous evaluation as the initial tensor
+  m_tensorNetwork.appendTensor(m_tensorIdCounter, exatn::getTensor(resetTensorName), std::vector<std::pair<unsigned int, unsigned int>>{});
+  // Walk the remaining circuit and visit all gates
   InstructionIterator it(in_function);
   m_hasEvaluated = false;
   size_t nbBasisChangeInsts = 0;
@@ -1569,19 +2215,7 @@ const double ExatnVisitor<TNQVM_COMPLEX_TYPE>::getExpectationValueZ(
       }
     }
   }
-  assert(!m_measureQbIdx.empty());
-  // If there are basis change instructions:
-  // i.e. not Z basis
-  if (nbBasisChangeInsts > 0)
-  {
-    TNQVM_TELEMETRY_ZONE("exatn::evaluateSync", __FILE__, __LINE__);
-    const bool evaluated = exatn::evaluateSync(m_tensorNetwork);
-    assert(evaluated);
-  }
-  m_hasEvaluated = true;
-  const double exp_val_z = (nbBasisChangeInsts > 0) ? calcExpValueZ(m_measureQbIdx, retrieveStateVector()) :  calcExpValueZ(m_measureQbIdx, m_cacheStateVec);
-  m_measureQbIdx.clear();
-  return exp_val_z;
+  return nbBasisChangeInsts;
 }
 
 template <typename TNQVM_COMPLEX_TYPE>
@@ -1607,137 +2241,281 @@ double ExatnVisitor<TNQVM_COMPLEX_TYPE>::getExpectationValueZBySlicing(
 
 template <typename TNQVM_COMPLEX_TYPE>
 double ExatnVisitor<TNQVM_COMPLEX_TYPE>::getExpectationValueZBySlicing() {
-  // Number of qubits we need to project.
-  const size_t nbProjectedQubits = m_buffer->size() - m_maxQubit;
-  // The number of paths we need to reduce.
-  const int64_t nbProjectedPaths = (1ULL << nbProjectedQubits);
   // Strategy:
-  // Q0 -> Q(m_maxQubit - 1): compute slice
-  // The rest (nbProjectedQubits): we sequence through nbProjectedPaths to
-  // compute partial expectations for all slices then reduce.
-  // Loop to be parallelized
+  // The sliced indices (projected output qubits and cut internal bonds) are
+  // given by the slice plan; the remaining (open) qubits form the slice.
+  // We sequence through all the projections (slices) to compute partial
+  // expectations for all slices then reduce.
+  // Slices of the cut bonds are partial amplitudes of the same projection:
+  // they are summed before computing its exp-val-z.
+  // Bit string of a projection: open legs (-1) for the open qubits, the
+  // projected qubits are set to the bits of the projection index. The parity
+  // of the projected measured qubits gives the sign of its contribution.
+  const auto getSliceBitString = [this](int64_t in_projectionIdx,
+                                        const SlicePlan &in_plan,
+                                        bool &out_evenParity) {
+    std::vector<int> bitString(m_buffer->size(), -1);
+    out_evenParity = true;
+    for (size_t i = 0; i < in_plan.projectedQubits.size(); ++i) {
+      const int globalQid = in_plan.projectedQubits[i];
+      const int bit = (in_projectionIdx >> i) & 1;
+      bitString[globalQid] = bit;
+      if (bit == 1 && xacc::container::contains(m_measureQbIdx, globalQid)) {
+        // Flip even parity flag
+        out_evenParity = !out_evenParity;
+      }
+    }
+    return bitString;
+  };
+  // Bit positions of the measured open qubits in the slice, i.e. the index
+  // of the qubit among the open qubits.
+  const auto getSliceMeasureBits = [this](const SlicePlan &in_plan) {
+    std::vector<int> sliceMeasureBits;
+    for (const auto &qubitIdx : m_measureQbIdx) {
+      const size_t qubit = qubitIdx;
+      if (!xacc::container::contains(in_plan.projectedQubits, qubit)) {
+        const auto nbProjectedBelow = std::count_if(
+            in_plan.projectedQubits.begin(), in_plan.projectedQubits.end(),
+            [qubit](size_t projected) { return projected < qubit; });
+        sliceMeasureBits.emplace_back(qubit - nbProjectedBelow);
+      }
+    }
+    return sliceMeasureBits;
+  };
+  // Cut tensors: basis vectors closing both sides of a cut bond.
+  const std::array<std::string, 2> cutTensorNames{m_tensorPrefix + "CUT0",
+                                                  m_tensorPrefix + "CUT1"};
+  const auto createCutTensors = [&](const SlicePlan &in_plan) {
+    std::array<std::shared_ptr<exatn::Tensor>, 2> cutTensors;
+    if (in_plan.cutBonds.empty()) {
+      return cutTensors;
+    }
+    for (int bit = 0; bit < 2; ++bit) {
+      const bool created = exatn::createTensor(
+          cutTensorNames[bit], getExatnElementType(), TensorShape{2});
+      assert(created);
+      std::vector<TNQVM_COMPLEX_TYPE> body{{0.0, 0.0}, {0.0, 0.0}};
+      body[bit] = {1.0, 0.0};
+      const bool initialized = exatn::initTensorData(cutTensorNames[bit], body);
+      assert(initialized);
+      cutTensors[bit] = exatn::getTensor(cutTensorNames[bit]);
+    }
+    return cutTensors;
+  };
+  const auto destroyCutTensors = [&](const SlicePlan &in_plan) {
+    if (!in_plan.cutBonds.empty()) {
+      for (const auto &tensorName : cutTensorNames) {
+        const bool destroyed = exatn::destroyTensorSync(tensorName);
+        assert(destroyed);
+      }
+    }
+  };
+  const auto recordSlicePlan = [this](const SlicePlan &in_plan,
+                                      int64_t in_nbSlices) {
+    executionInfo.insert("exatn-slices", (int)in_nbSlices);
+    executionInfo.insert("exatn-sliced-qubits",
+                         (int)in_plan.projectedQubits.size());
+    executionInfo.insert("exatn-sliced-bonds", (int)in_plan.cutBonds.size());
+  };
+
   if (getNumMpiProcs() <= 1) {
-    std::vector<double> partialExpectationValues(nbProjectedPaths);
-    bool evenParity = true;
-    for (int i = 0; i < nbProjectedPaths; ++i) {
-      // Open legs: 0-m_maxQubit
-      std::vector<int> bitString(m_maxQubit, -1);
-      for (int64_t bitIdx = 0; bitIdx < nbProjectedQubits; ++bitIdx) {
-        const int globalQid = bitIdx + m_maxQubit;
-        const int64_t bitMask = 1ULL << bitIdx;
-        if ((i & bitMask) == bitMask) {
-          bitString.emplace_back(1);
-          if (xacc::container::contains(m_measureQbIdx, globalQid)) {
-            // Flip even parity flag
-            evenParity = !evenParity;
-          }
-        } else {
-          bitString.emplace_back(0);
+    // Slices are evaluated concurrently in lanes (slices in flight in the
+    // ExaTN runtime, each lane with its own tensor names).
+    int nbLanes = 1;
+    if (options.keyExists<int>("exatn-slice-lanes")) {
+      nbLanes = options.get<int>("exatn-slice-lanes");
+      if (nbLanes < 1) {
+        xacc::error("Invalid 'exatn-slice-lanes' parameter.");
+      }
+    }
+    // Memory sub-budget: the lanes share the memory of a single full-size
+    // slice, i.e. one more qubit is projected for each doubling of the number
+    // of lanes.
+    size_t nbOpenQubits = m_sliceOpenQubits;
+    while (nbOpenQubits > 1 &&
+           (1LL << (m_sliceOpenQubits - nbOpenQubits)) < nbLanes) {
+      --nbOpenQubits;
+    }
+    const SlicePlan plan = getSlicePlan(nbOpenQubits);
+    const int64_t nbBondSlices = 1LL << plan.cutBonds.size();
+    const int64_t nbProjections = 1LL << plan.projectedQubits.size();
+    const int64_t nbSlices = nbProjections * nbBondSlices;
+    nbLanes = std::min<int64_t>(nbLanes, nbSlices);
+    const auto getLaneTag = [nbLanes](int64_t in_sliceIdx) {
+      return (nbLanes > 1) ? "L" + std::to_string(in_sliceIdx % nbLanes) + "_"
+                           : std::string();
+    };
+    const auto sliceMeasureBits = getSliceMeasureBits(plan);
+    const auto cutTensors = createCutTensors(plan);
+
+    std::vector<double> partialExpectationValues(nbProjections);
+    std::vector<std::string> laneOutputTensors(nbLanes);
+    std::vector<char> laneEvenParity(nbLanes, 1);
+    // Slice index: projection index x bond slices + bond values.
+    const auto submitSlice = [&](int64_t in_sliceIdx) {
+      bool evenParity = true;
+      const auto bitString =
+          getSliceBitString(in_sliceIdx / nbBondSlices, plan, evenParity);
+      laneEvenParity[in_sliceIdx % nbLanes] = evenParity;
+      laneOutputTensors[in_sliceIdx % nbLanes] = submitWaveFuncSlice(
+          plan.cutBonds.empty()
+              ? m_tensorNetwork
+              : cutNetworkBonds(m_tensorNetwork, plan.cutBonds,
+                                in_sliceIdx % nbBondSlices, cutTensors),
+          bitString, exatn::getDefaultProcessGroup(), getLaneTag(in_sliceIdx));
+    };
+    // Rolling window: once the result of a slice is collected, its lane
+    // takes the next slice.
+    for (int64_t i = 0; i < nbLanes; ++i) {
+      submitSlice(i);
+    }
+    std::vector<TNQVM_COMPLEX_TYPE> projectionWaveFunc;
+    for (int64_t i = 0; i < nbSlices; ++i) {
+      const int64_t lane = i % nbLanes;
+      std::vector<TNQVM_COMPLEX_TYPE> waveFuncSlice =
+          collectWaveFuncSlice(laneOutputTensors[lane], getLaneTag(i));
+      if (i % nbBondSlices == 0) {
+        projectionWaveFunc = std::move(waveFuncSlice);
+      } else {
+        assert(projectionWaveFunc.size() == waveFuncSlice.size());
+        for (size_t k = 0; k < waveFuncSlice.size(); ++k) {
+          projectionWaveFunc[k] += waveFuncSlice[k];
         }
       }
-      std::vector<TNQVM_COMPLEX_TYPE> waveFuncSlice = computeWaveFuncSlice(
-          m_tensorNetwork, bitString, exatn::getDefaultProcessGroup());
-      const double exp_val_z = calcExpValueZ(m_measureQbIdx, waveFuncSlice);
-      partialExpectationValues[i] = evenParity ? exp_val_z : -exp_val_z;
+      if (i % nbBondSlices == nbBondSlices - 1) {
+        const double exp_val_z =
+            calcExpValueZ(sliceMeasureBits, projectionWaveFunc);
+        partialExpectationValues[i / nbBondSlices] =
+            laneEvenParity[lane] ? exp_val_z : -exp_val_z;
+      }
+      if (i + nbLanes < nbSlices) {
+        submitSlice(i + nbLanes);
+      }
     }
+    destroyCutTensors(plan);
+    recordSlicePlan(plan, nbSlices);
+    executionInfo.insert("exatn-slice-lanes", nbLanes);
     const auto finalExpVal = std::accumulate(
         partialExpectationValues.begin(), partialExpectationValues.end(), 0.0);
     return finalExpVal;
   } else {
     // Multiple MPI processes:
-    // Note: if the number of MPI processes > total number of paths,
-    // just use enough processes (each process handles 1 path), the rest is
-    // unused.
-    const auto nbMpiProcsToUse = (nbProjectedPaths > getNumMpiProcs())
-                                     ? getNumMpiProcs()
-                                     : nbProjectedPaths;
+    const SlicePlan plan = getSlicePlan(m_sliceOpenQubits);
+    const int64_t nbBondSlices = 1LL << plan.cutBonds.size();
+    // The number of paths (projections) we need to reduce.
+    const int64_t nbProjectedPaths = 1LL << plan.projectedQubits.size();
+    const int nbProcs = getNumMpiProcs();
     const auto processRank = exatn::getProcessRank();
-    const auto nbProjectedPathsPerProcess = nbProjectedPaths / nbMpiProcsToUse;
-    // If not evenly divided, process 0 to get the remain.
-    // i.e. process 0 always has the largest partial exp-val vectors.
-    const auto nbProjectedPathsProcess0 =
-        nbProjectedPathsPerProcess + nbProjectedPaths % nbMpiProcsToUse;
-    assert((nbProjectedPathsProcess0 +
-            (nbMpiProcsToUse - 1) * nbProjectedPathsPerProcess) ==
-           nbProjectedPaths);
-    std::vector<double> partialExpectationValues(nbProjectedPathsPerProcess);
-    if (processRank == 0) {
-      partialExpectationValues.resize(nbProjectedPathsProcess0);
-    }
-    // Name of the tensor to hold the accumulated exp-value of the process.
-    const std::string accumulatedTensorName = "ExpVal";
-
-    // These processes need to do work:
-    if (processRank < nbMpiProcsToUse) {
-      const int64_t processStartIdx =
-          (processRank == 0) ? 0
-                             : (nbProjectedPathsProcess0 +
-                                (processRank - 1) * nbProjectedPathsPerProcess);
-      const int64_t processEndIdx =
-          (processRank == 0) ? nbProjectedPathsProcess0
-                             : (processStartIdx + nbProjectedPathsPerProcess);
+    const auto sliceMeasureBits = getSliceMeasureBits(plan);
+    const auto cutTensors = createCutTensors(plan);
+    // Slice schedule: by default, processes claim chunks of slices
+    // dynamically so that faster processes take on more slices.
+    std::string sliceSchedule = "dynamic";
+    if (options.stringExists("exatn-slice-schedule")) {
+      sliceSchedule = options.getString("exatn-slice-schedule");
+      if (sliceSchedule != "dynamic" && sliceSchedule != "static") {
+        xacc::error("Invalid 'exatn-slice-schedule' parameter: " +
+                    sliceSchedule);
+      }
+    }
+
+    double localAccumulateExpVal = 0.0;
+    int nbLocalSlices = 0;
+    const auto evaluateSlices = [&](int64_t in_begin, int64_t in_end) {
       std::stringstream ss;
-      ss << "Process [" << processRank
-                << "]: Start = " << processStartIdx
-                << "; End = " << processEndIdx << "\n";
+      ss << "Process [" << processRank << "]: Start = " << in_begin
+         << "; End = " << in_end << "\n";
       xacc::info(ss.str());
-      bool evenParity = true;
-      int64_t vectorIdx = 0;
-      for (int64_t i = processStartIdx; i < processEndIdx; ++i) {
-        // Open legs: 0-m_maxQubit
-        std::vector<int> bitString(m_maxQubit, -1);
-        for (int64_t bitIdx = 0; bitIdx < nbProjectedQubits; ++bitIdx) {
-          const int globalQid = bitIdx + m_maxQubit;
-          const int64_t bitMask = 1ULL << bitIdx;
-          if ((i & bitMask) == bitMask) {
-            bitString.emplace_back(1);
-            if (xacc::container::contains(m_measureQbIdx, globalQid)) {
-              // Flip even parity flag
-              evenParity = !evenParity;
-            }
+      for (int64_t i = in_begin; i < in_end; ++i) {
+        bool evenParity = true;
+        const auto bitString = getSliceBitString(i, plan, evenParity);
+        std::vector<TNQVM_COMPLEX_TYPE> waveFuncSlice;
+        for (int64_t bondValues = 0; bondValues < nbBondSlices; ++bondValues) {
+          const auto bondSlice = computeWaveFuncSlice(
+              plan.cutBonds.empty()
+                  ? m_tensorNetwork
+                  : cutNetworkBonds(m_tensorNetwork, plan.cutBonds, bondValues,
+                                    cutTensors),
+              bitString, exatn::getCurrentProcessGroup());
+          if (waveFuncSlice.empty()) {
+            waveFuncSlice = bondSlice;
           } else {
-            bitString.emplace_back(0);
+            for (size_t k = 0; k < bondSlice.size(); ++k) {
+              waveFuncSlice[k] += bondSlice[k];
+            }
           }
         }
-        std::vector<TNQVM_COMPLEX_TYPE> waveFuncSlice = computeWaveFuncSlice(
-            m_tensorNetwork, bitString, exatn::getCurrentProcessGroup());
-        const double exp_val_z = calcExpValueZ(m_measureQbIdx, waveFuncSlice);
-        assert(vectorIdx < partialExpectationValues.size());
-        partialExpectationValues[vectorIdx] =
-            evenParity ? exp_val_z : -exp_val_z;
-        ++vectorIdx;
+        const double exp_val_z = calcExpValueZ(sliceMeasureBits, waveFuncSlice);
+        localAccumulateExpVal += evenParity ? exp_val_z : -exp_val_z;
+        nbLocalSlices += nbBondSlices;
       }
+    };
 
-      // Compute local accumulate:
-      const double localAccumulateExpVal =
-          std::accumulate(partialExpectationValues.begin(),
-                          partialExpectationValues.end(), 0.0);
-
-      // MPI Reduce: We don't want to explicitly use MPI API here,
-      // hence using exatn::allreduceTensor API.
-      // Each process will just construct an one-element tensor which
-      // contains the local accumulated exp-val.
-      const bool created = exatn::createTensor(accumulatedTensorName,
-                                               exatn::TensorElementType::REAL64,
-                                               exatn::TensorShape{1});
-      assert(created);
-      std::stringstream ssLog;
-      ssLog << "Process [" << processRank
-                << "]: Local accumulated exp-val = "
-                << localAccumulateExpVal << "\n";
-      xacc::info(ssLog.str());
-      // Init tensor body data
-      exatn::initTensorData(accumulatedTensorName,
-                            std::vector<double>{localAccumulateExpVal});
-    } else {
-      // These processes are excess (in case there are too many processes)
-      const bool created = exatn::createTensor(accumulatedTensorName,
-                                               exatn::TensorElementType::REAL64,
-                                               exatn::TensorShape{1});
-      assert(created);
-      // Init zero tensor body data
-      exatn::initTensorData(accumulatedTensorName, std::vector<double>{0.0});
+    const auto startTime = std::chrono::steady_clock::now();
+#ifdef MPI_ENABLED
+    if (sliceSchedule == "dynamic") {
+      // Shared slice counter hosted on process 0, incremented with MPI
+      // one-sided atomics (no master process needed).
+      auto commProxy = exatn::getDefaultProcessGroup().getMPICommProxy();
+      MPI_Comm comm = commProxy.getRef<MPI_Comm>();
+      int64_t *counterPtr = nullptr;
+      MPI_Win counterWin;
+      MPI_Win_allocate((processRank == 0) ? sizeof(int64_t) : 0,
+                       sizeof(int64_t), MPI_INFO_NULL, comm, &counterPtr,
+                       &counterWin);
+      if (processRank == 0) {
+        MPI_Win_lock(MPI_LOCK_EXCLUSIVE, 0, 0, counterWin);
+        *counterPtr = 0;
+        MPI_Win_unlock(0, counterWin);
+      }
+      MPI_Barrier(comm);
+      slicing::DynamicChunkScheduler scheduler(
+          nbProjectedPaths, nbProcs, [&counterWin](int64_t in_chunkSize) {
+            int64_t previousCount = 0;
+            MPI_Win_lock(MPI_LOCK_SHARED, 0, 0, counterWin);
+            MPI_Fetch_and_op(&in_chunkSize, &previousCount, MPI_INT64_T, 0, 0,
+                             MPI_SUM, counterWin);
+            MPI_Win_unlock(0, counterWin);
+            return previousCount;
+          });
+      int64_t chunkBegin = 0;
+      int64_t chunkEnd = 0;
+      while (scheduler.claimChunk(chunkBegin, chunkEnd)) {
+        evaluateSlices(chunkBegin, chunkEnd);
+      }
+      // Collective: also waits for all processes to stop claiming.
+      MPI_Win_free(&counterWin);
+    } else
+#endif
+    {
+      const auto block =
+          slicing::getStaticBlock(nbProjectedPaths, processRank, nbProcs);
+      evaluateSlices(block.first, block.second);
     }
+    const std::chrono::duration<double> busyTime =
+        std::chrono::steady_clock::now() - startTime;
+
+    // MPI Reduce: We don't want to explicitly use MPI API here,
+    // hence using exatn::allreduceTensor API.
+    // Each process will construct a tensor which contains the local
+    // accumulated exp-val, followed by the number of slices and the busy time
+    // of each process (zero except for its own entries).
+    const std::string accumulatedTensorName = m_tensorPrefix + "ExpVal";
+    const bool created = exatn::createTensor(
+        accumulatedTensorName, exatn::TensorElementType::REAL64,
+        exatn::TensorShape{static_cast<exatn::DimExtent>(1 + 2 * nbProcs)});
+    assert(created);
+    std::stringstream ssLog;
+    ssLog << "Process [" << processRank
+          << "]: Local accumulated exp-val = " << localAccumulateExpVal
+          << "; Slices = " << nbLocalSlices << "\n";
+    xacc::info(ssLog.str());
+    std::vector<double> localData(1 + 2 * nbProcs, 0.0);
+    localData[0] = localAccumulateExpVal;
+    localData[1 + processRank] = nbLocalSlices;
+    localData[1 + nbProcs + processRank] = busyTime.count();
+    // Init tensor body data
+    exatn::initTensorData(accumulatedTensorName, localData);
 
     // All-reduce the accumulated tensor across all processes in the group.
     const bool allReduced = exatn::allreduceTensorSync(
@@ -1746,15 +2524,29 @@ double ExatnVisitor<TNQVM_COMPLEX_TYPE>::getExpectationValueZBySlicing() {
 
     // Done:
     auto talsh_tensor = exatn::getLocalTensor(accumulatedTensorName);
-    assert(talsh_tensor->getVolume() == 1);
+    assert(talsh_tensor->getVolume() == localData.size());
     const double *body_ptr;
     // Invalid value to detect any problems.
     double finalExpVal = -9999.99;
     if (talsh_tensor->getDataAccessHostConst(&body_ptr)) {
-      finalExpVal = *body_ptr;
+      finalExpVal = body_ptr[0];
+      // Idle time of a process: time waiting for the slowest process.
+      const double maxBusyTime =
+          *std::max_element(body_ptr + 1 + nbProcs, body_ptr + 1 + 2 * nbProcs);
+      std::vector<int> rankSlices(nbProcs);
+      std::vector<double> rankIdleTimes(nbProcs);
+      for (int rank = 0; rank < nbProcs; ++rank) {
+        rankSlices[rank] = static_cast<int>(body_ptr[1 + rank]);
+        rankIdleTimes[rank] = maxBusyTime - body_ptr[1 + nbProcs + rank];
+      }
+      recordSlicePlan(plan, nbProjectedPaths * nbBondSlices);
+      executionInfo.insert("exatn-slice-schedule", sliceSchedule);
+      executionInfo.insert("exatn-rank-slices", rankSlices);
+      executionInfo.insert("exatn-rank-idle-time", rankIdleTimes);
     }
     const bool destroyed = exatn::destroyTensorSync(accumulatedTensorName);
     assert(destroyed);
+    destroyCutTensors(plan);
     return finalExpVal;
   }
 }
@@ -1805,99 +2597,122 @@ ExatnVisitor<TNQVM_COMPLEX_TYPE>::getExpectationValueZByAppendingConjugate() {
 }
 
 template<typename TNQVM_COMPLEX_TYPE>
-std::vector<uint8_t> ExatnVisitor<TNQVM_COMPLEX_TYPE>::generateMeasureSample(const TensorNetwork& in_tensorNetwork, const std::vector<int>& in_qubitIdx)
+TensorNetwork ExatnVisitor<TNQVM_COMPLEX_TYPE>::buildSamplingBlockNetwork(const TensorNetwork& in_tensorNetwork, const std::vector<int>& in_qubitIdx,
+                                                                          const std::vector<uint8_t>& in_sampledBits, const std::vector<TNQVM_FLOAT_TYPE>& in_sampledProbs,
+                                                                          const std::vector<int>& in_blockQubits, std::vector<std::string>& out_tensorsToDestroy) const
 {
-    TNQVM_TELEMETRY_ZONE(__FUNCTION__, __FILE__, __LINE__);
-    std::vector<uint8_t> resultBitString;
-    std::vector<ExatnVisitor<TNQVM_COMPLEX_TYPE>::TNQVM_FLOAT_TYPE> resultProbs;
-    for (const auto& qubitIdx : in_qubitIdx)
+    exatn::TensorNetwork ket(in_tensorNetwork);
+    ket.rename("MPSket");
+
+    exatn::TensorNetwork bra(ket);
+    bra.conjugate();
+    bra.rename("MPSbra");
+    auto tensorIdCounter = ket.getMaxTensorId();
+    // Adding collapse tensors based on previous measurement results.
+    // i.e. condition/renormalize the tensor network to be consistent with
+    // previous result.
+    for (size_t measIdx = 0; measIdx < in_sampledBits.size(); ++measIdx)
     {
-        std::vector<std::string> tensorsToDestroy;
-        std::vector<TNQVM_COMPLEX_TYPE> resultRDM;
-        exatn::TensorNetwork ket(in_tensorNetwork);
-        ket.rename("MPSket");
-
-        exatn::TensorNetwork bra(ket);
-        bra.conjugate();
-        bra.rename("MPSbra");
-        auto tensorIdCounter = ket.getMaxTensorId();
-        // Adding collapse tensors based on previous measurement results.
-        // i.e. condition/renormalize the tensor network to be consistent with
-        // previous result.
-        for (size_t measIdx = 0; measIdx < resultBitString.size(); ++measIdx)
+        const unsigned int qId = in_qubitIdx[measIdx];
+        // Renormalize based on the probability of this outcome
+        const TNQVM_COMPLEX_TYPE normFactor{1.0f / in_sampledProbs[measIdx], 0.0};
+        const std::vector<TNQVM_COMPLEX_TYPE> COLLAPSE = (in_sampledBits[measIdx] == 0) ?
+            std::vector<TNQVM_COMPLEX_TYPE>{normFactor, {0.0, 0.0}, {0.0, 0.0}, {0.0, 0.0}} :
+            std::vector<TNQVM_COMPLEX_TYPE>{{0.0, 0.0}, {0.0, 0.0}, {0.0, 0.0}, normFactor};
+        assert(in_sampledBits[measIdx] == 0 || in_sampledBits[measIdx] == 1);
+
+        const std::string tensorName = m_tensorPrefix + "COLLAPSE_" + std::to_string(in_sampledBits[measIdx]) + "_" + std::to_string(measIdx);
+        const bool created = exatn::createTensor(tensorName, getExatnElementType(), exatn::TensorShape{2, 2});
+        assert(created);
+        out_tensorsToDestroy.emplace_back(tensorName);
+        const bool registered = exatn::registerTensorIsometry(tensorName, {0}, {1});
+        assert(registered);
+        const bool initialized = exatn::initTensorData(tensorName, COLLAPSE);
+        assert(initialized);
+        tensorIdCounter++;
+        const bool appended = ket.appendTensorGate(tensorIdCounter, exatn::getTensor(tensorName), {qId});
+        assert(appended);
+    }
+
+    auto combinedNetwork = ket;
+    combinedNetwork.rename("Combined Tensor Network");
+    {
+        // Append the conjugate network to calculate the RDM of the block
+        // qubits
+        std::vector<std::pair<unsigned int, unsigned int>> pairings;
+        for (size_t i = 0; i < m_buffer->size(); ++i)
         {
-            const unsigned int qId = in_qubitIdx[measIdx];
-            // If it was a "0":
-            if (resultBitString[measIdx] == 0)
+            // Connect the original tensor network with its inverse
+            // but leave the block qubit lines open.
+            if (std::find(in_blockQubits.begin(), in_blockQubits.end(), i) == in_blockQubits.end())
             {
-                const std::vector<TNQVM_COMPLEX_TYPE> COLLAPSE_0{
-                    // Renormalize based on the probability of this outcome
-                    {1.0f / resultProbs[measIdx], 0.0},
-                    {0.0, 0.0},
-                    {0.0, 0.0},
-                    {0.0, 0.0}};
-
-                const std::string tensorName = "COLLAPSE_0_" + std::to_string(measIdx);
-                const bool created = exatn::createTensor(tensorName, getExatnElementType(), exatn::TensorShape{2, 2});
-                assert(created);
-                tensorsToDestroy.emplace_back(tensorName);
-                const bool registered = exatn::registerTensorIsometry(tensorName, {0}, {1});
-                assert(registered);
-                const bool initialized = exatn::initTensorData(tensorName, COLLAPSE_0);
-                assert(initialized);
-                tensorIdCounter++;
-                const bool appended = ket.appendTensorGate(tensorIdCounter, exatn::getTensor(tensorName), {qId});
-                assert(appended);
-            }
-            else
-            {
-                assert(resultBitString[measIdx] == 1);
-                // Renormalize based on the probability of this outcome
-                const std::vector<TNQVM_COMPLEX_TYPE> COLLAPSE_1{
-                    {0.0, 0.0},
-                    {0.0, 0.0},
-                    {0.0, 0.0},
-                    {1.0f / resultProbs[measIdx], 0.0}};
-
-                const std::string tensorName = "COLLAPSE_1_" + std::to_string(measIdx);
-                const bool created = exatn::createTensor(tensorName, getExatnElementType(), exatn::TensorShape{2, 2});
-                assert(created);
-                tensorsToDestroy.emplace_back(tensorName);
-                const bool registered = exatn::registerTensorIsometry(tensorName, {0}, {1});
-                assert(registered);
-                const bool initialized = exatn::initTensorData(tensorName, COLLAPSE_1);
-                assert(initialized);
-                tensorIdCounter++;
-                const bool appended = ket.appendTensorGate(tensorIdCounter, exatn::getTensor(tensorName), {qId});
-                assert(appended);
+                pairings.emplace_back(std::make_pair(i, i));
             }
         }
 
-        auto combinedNetwork = ket;
-        combinedNetwork.rename("Combined Tensor Network");
-        {
-            // Append the conjugate network to calculate the RDM of the measure
-            // qubit
-            std::vector<std::pair<unsigned int, unsigned int>> pairings;
-            for (size_t i = 0; i < m_buffer->size(); ++i)
-            {
-                // Connect the original tensor network with its inverse
-                // but leave the measure qubit line open.
-                if (i != qubitIdx)
-                {
-                    pairings.emplace_back(std::make_pair(i, i));
-                }
-            }
+        combinedNetwork.appendTensorNetwork(std::move(bra), pairings);
+    }
 
-            combinedNetwork.appendTensorNetwork(std::move(bra), pairings);
+    const bool isoCollapsed = combinedNetwork.collapseIsometries();
+    return combinedNetwork;
+}
+
+template<typename TNQVM_COMPLEX_TYPE>
+size_t ExatnVisitor<TNQVM_COMPLEX_TYPE>::getSamplingBlockSize(const TensorNetwork& in_tensorNetwork, const std::vector<int>& in_qubitIdx)
+{
+    if (m_samplingBlockSize > 0)
+    {
+        return m_samplingBlockSize;
+    }
+    if (options.keyExists<int>("sampling-block-size"))
+    {
+        const int blockSize = options.get<int>("sampling-block-size");
+        if (blockSize < 1)
+        {
+            xacc::error("Invalid 'sampling-block-size' parameter.");
         }
+        m_samplingBlockSize = blockSize;
+        return m_samplingBlockSize;
+    }
+    // Largest block whose (unconditioned) RDM network fits in the memory
+    // budget (or the ExaTN buffer), based on the contraction cost estimate.
+    size_t blockSize = std::min(sampling::MAX_SAMPLING_BLOCK_SIZE, in_qubitIdx.size());
+    for (; blockSize > 1; --blockSize)
+    {
+        std::vector<std::string> tensorsToDestroy;
+        const auto blockQubits = sampling::getSamplingBlocks(in_qubitIdx, blockSize).front();
+        const auto cost = estimateContractionCost(buildSamplingBlockNetwork(in_tensorNetwork, in_qubitIdx, {}, {}, blockQubits, tensorsToDestroy));
+        assert(tensorsToDestroy.empty());
+        if (cost.peakVolume <= m_maxPeakVolume)
+        {
+            break;
+        }
+    }
+    m_samplingBlockSize = std::max<size_t>(blockSize, 1);
+    executionInfo.insert("sampling-block-size", (int)m_samplingBlockSize);
+    return m_samplingBlockSize;
+}
 
-        const bool isoCollapsed = combinedNetwork.collapseIsometries();
+template<typename TNQVM_COMPLEX_TYPE>
+std::vector<uint8_t> ExatnVisitor<TNQVM_COMPLEX_TYPE>::generateMeasureSample(const TensorNetwork& in_tensorNetwork, const std::vector<int>& in_qubitIdx)
+{
+    TNQVM_TELEMETRY_ZONE(__FUNCTION__, __FILE__, __LINE__);
+    std::vector<uint8_t> resultBitString;
+    std::vector<ExatnVisitor<TNQVM_COMPLEX_TYPE>::TNQVM_FLOAT_TYPE> resultProbs;
+    // Sample a block of qubits at once from its RDM (conditioned on the
+    // previous blocks): one contraction per block.
+    const size_t blockSize = getSamplingBlockSize(in_tensorNetwork, in_qubitIdx);
+    for (const auto& blockQubits : sampling::getSamplingBlocks(in_qubitIdx, blockSize))
+    {
+        std::vector<std::string> tensorsToDestroy;
+        std::vector<TNQVM_COMPLEX_TYPE> resultRDM;
+        auto combinedNetwork = buildSamplingBlockNetwork(in_tensorNetwork, in_qubitIdx, resultBitString, resultProbs, blockQubits, tensorsToDestroy);
         {
           // DEBUG:
           {
             const std::string optimizerName = options.stringExists("exatn-contract-seq-optimizer") ? options.getString("exatn-contract-seq-optimizer") : "metis";
             const auto startOpt = std::chrono::system_clock::now();
+            determineContractionSequence(combinedNetwork);
             combinedNetwork.getOperationList(optimizerName);
             const auto endOpt = std::chrono::system_clock::now();
               std::cout << "getOperationList() took: "
@@ -1926,43 +2741,35 @@ std::vector<uint8_t> ExatnVisitor<TNQVM_COMPLEX_TYPE>::generateMeasureSample(con
               exatn::sync();
               auto talsh_tensor = exatn::getLocalTensor(combinedNetwork.getTensor(0)->getName());
               const auto tensorVolume = talsh_tensor->getVolume();
-              // Single qubit density matrix
-              assert(tensorVolume == 4);
+              // Block density matrix
+              assert(tensorVolume == (1ULL << (2 * blockQubits.size())));
               const TNQVM_COMPLEX_TYPE* body_ptr;
               if (talsh_tensor->getDataAccessHostConst(&body_ptr))
               {
                   resultRDM.assign(body_ptr, body_ptr + tensorVolume);
               }
-              // Debug: print out RDM data
-              {
-                  std::cout << "RDM @q" << qubitIdx << " = [";
-                  for (int i = 0; i < talsh_tensor->getVolume(); ++i)
-                  {
-                      const TNQVM_COMPLEX_TYPE element = body_ptr[i];
-                      std::cout << element;
-                  }
-                  std::cout << "]\n";
-              }
           }
         }
         {
-            // Perform the measurement
-            assert(resultRDM.size() == 4);
-            const double prob_0 = resultRDM.front().real();
-            const double prob_1 = resultRDM.back().real();
-            assert(prob_0 >= 0.0 && prob_1 >= 0.0);
-            assert(std::fabs(1.0 - prob_0 - prob_1) < 1e-12);
-
+            // Perform the measurement of the block
+            const auto probs = sampling::getDiagonalProbabilities(resultRDM, blockQubits.size());
+            assert(std::fabs(1.0 - std::accumulate(probs.begin(), probs.end(), 0.0)) < 1e-6);
             // Generate a random number
             const double randProbPick = generateRandomProbability();
-            // If radom number < probability of 0 state -> pick zero, and vice versa.
-            resultBitString.emplace_back(randProbPick <= prob_0 ? 0 : 1);
-            resultProbs.emplace_back(randProbPick <= prob_0 ? prob_0 : prob_1);
-
-            std::cout << ">> Measure @q" << qubitIdx << " prob(0) = " << prob_0 << "\n";
-            std::cout << ">> Measure @q" << qubitIdx << " prob(1) = " << prob_1 << "\n";
-            std::cout << ">> Measure @q" << qubitIdx << " random number = " << randProbPick << "\n";
-            std::cout << ">> Measure @q" << qubitIdx << " pick " << std::to_string(resultBitString.back()) << "\n";
+            const size_t outcome = sampling::sampleIndex(probs, randProbPick);
+            // Bit m of the outcome is the m-th block qubit in increasing order.
+            auto sortedBlockQubits = blockQubits;
+            std::sort(sortedBlockQubits.begin(), sortedBlockQubits.end());
+            const size_t blockBegin = resultBitString.size();
+            for (const auto& qubitIdx : blockQubits)
+            {
+                const auto bitPos = std::distance(sortedBlockQubits.begin(), std::find(sortedBlockQubits.begin(), sortedBlockQubits.end(), qubitIdx));
+                resultBitString.emplace_back((outcome >> bitPos) & 1);
+                // The whole block is renormalized by its outcome probability
+                // (first collapse tensor of the block).
+                resultProbs.emplace_back(resultBitString.size() == blockBegin + 1 ? probs[outcome] : 1.0);
+                std::cout << ">> Measure @q" << qubitIdx << " pick " << std::to_string(resultBitString.back()) << "\n";
+            }
         }
 
         for (const auto& tensorName : tensorsToDestroy)
@@ -1985,7 +2792,7 @@ std::vector<std::pair<double, double>> ExatnVisitor<TNQVM_COMPLEX_TYPE>::calcFlo
   resultData.reserve(m_buffer->size());
   // Create the collapse tensor:
   const std::vector<TNQVM_COMPLEX_TYPE> COLLAPSE_TEMP { {1.0, 0.0}, {0.0, 0.0}, {0.0, 0.0}, {0.0, 0.0} };
-  const std::string tensorName = "COLLAPSE_TENSOR_TEMP";
+  const std::string tensorName = m_tensorPrefix + "COLLAPSE_TENSOR_TEMP";
   const bool created = exatn::createTensor(tensorName, getExatnElementType(), exatn::TensorShape{2, 2});
   assert(created);
   const bool registered = exatn::registerTensorIsometry(tensorName, {0}, {1});
@@ -2027,7 +2834,9 @@ std::vector<std::pair<double, double>> ExatnVisitor<TNQVM_COMPLEX_TYPE>::calcFlo
     combinedNetwork.appendTensorNetwork(std::move(bra), pairings);
     const bool isoCollapsed = combinedNetwork.collapseIsometries();
     const std::string optimizerName = options.stringExists("exatn-contract-seq-optimizer") ? options.getString("exatn-contract-seq-optimizer") : "metis";
-    // Get the tensor operation list, i.e. run the tensor optimizer.
+    // Get the tensor operation list, i.e. run the tensor optimizer (unless the
+    // sequence is cached).
+    determineContractionSequence(combinedNetwork);
     combinedNetwork.getOperationList(optimizerName);
     const double flops = combinedNetwork.getFMAFlops();
     const double intermediatesVolume = combinedNetwork.getMaxIntermediatePresenceVolume();
@@ -2086,11 +2895,547 @@ bool ExatnVisitor<TNQVM_COMPLEX_TYPE>::validateTensorNetworkContraction(TensorNe
   return false;
 }
 
+template <typename TNQVM_COMPLEX_TYPE>
+std::vector<typename ExatnVisitor<TNQVM_COMPLEX_TYPE>::SlicedBond>
+ExatnVisitor<TNQVM_COMPLEX_TYPE>::getInternalBonds(
+    const TensorNetwork &in_tensorNetwork) const {
+  std::vector<SlicedBond> bonds;
+  for (auto iter = in_tensorNetwork.cbegin(); iter != in_tensorNetwork.cend();
+       ++iter) {
+    const unsigned int tensorId = iter->first;
+    // Tensor 0 is the output tensor.
+    if (tensorId == 0 || iter->second.getTensor()->getRank() < 2) {
+      continue;
+    }
+    const auto &legs = iter->second.getTensorLegs();
+    for (unsigned int legId = 0; legId < legs.size(); ++legId) {
+      const unsigned int otherTensorId = legs[legId].getTensorId();
+      const unsigned int otherLegId = legs[legId].getDimensionId();
+      if (otherTensorId == 0 ||
+          in_tensorNetwork.getTensor(otherTensorId)->getRank() < 2) {
+        continue;
+      }
+      // Each bond once:
+      if (std::make_pair(tensorId, legId) <
+          std::make_pair(otherTensorId, otherLegId)) {
+        bonds.emplace_back(
+            SlicedBond{tensorId, legId, otherTensorId, otherLegId});
+      }
+    }
+  }
+  // Deterministic order (e.g. the same on all MPI processes)
+  std::sort(bonds.begin(), bonds.end(),
+            [](const SlicedBond &lhs, const SlicedBond &rhs) {
+              return std::make_pair(lhs.tensorId, lhs.legId) <
+                     std::make_pair(rhs.tensorId, rhs.legId);
+            });
+  return bonds;
+}
+
+template <typename TNQVM_COMPLEX_TYPE>
+TensorNetwork ExatnVisitor<TNQVM_COMPLEX_TYPE>::cutNetworkBonds(
+    const TensorNetwork &in_tensorNetwork,
+    const std::vector<SlicedBond> &in_bonds, int64_t in_bondValues,
+    const std::array<std::shared_ptr<exatn::Tensor>, 2> &in_cutTensors)
+    const {
+  // New connection of each side of a cut bond: the leg of its cut tensor.
+  std::map<std::pair<unsigned int, unsigned int>, exatn::TensorLeg> cutLegs;
+  // Cut tensors to place: id, tensor and (single) connection.
+  std::vector<std::tuple<unsigned int, std::shared_ptr<exatn::Tensor>,
+                         exatn::TensorLeg>>
+      cutTensorConns;
+  unsigned int tensorIdCounter = in_tensorNetwork.getMaxTensorId();
+  for (size_t k = 0; k < in_bonds.size(); ++k) {
+    const auto &bond = in_bonds[k];
+    const auto &cutTensor = in_cutTensors[(in_bondValues >> k) & 1];
+    const auto &leg =
+        (*in_tensorNetwork.getTensorConnections(bond.tensorId))[bond.legId];
+    const auto &otherLeg = (*in_tensorNetwork.getTensorConnections(
+        bond.otherTensorId))[bond.otherLegId];
+    const unsigned int cutId = ++tensorIdCounter;
+    const unsigned int otherCutId = ++tensorIdCounter;
+    // Leg directions are kept: the cut tensor takes the place of the other
+    // side of the bond.
+    cutLegs[std::make_pair(bond.tensorId, bond.legId)] =
+        exatn::TensorLeg(cutId, 0, leg.getDirection());
+    cutLegs[std::make_pair(bond.otherTensorId, bond.otherLegId)] =
+        exatn::TensorLeg(otherCutId, 0, otherLeg.getDirection());
+    cutTensorConns.emplace_back(
+        cutId, cutTensor,
+        exatn::TensorLeg(bond.tensorId, bond.legId, otherLeg.getDirection()));
+    cutTensorConns.emplace_back(otherCutId, cutTensor,
+                                exatn::TensorLeg(bond.otherTensorId,
+                                                 bond.otherLegId,
+                                                 leg.getDirection()));
+  }
+
+  // Same output tensor (open legs), tensors placed with the new connections.
+  TensorNetwork result(in_tensorNetwork.getName(),
+                       in_tensorNetwork.getTensor(0),
+                       *in_tensorNetwork.getTensorConnections(0));
+  for (auto iter = in_tensorNetwork.cbegin(); iter != in_tensorNetwork.cend();
+       ++iter) {
+    if (iter->first == 0) {
+      continue;
+    }
+    auto legs = iter->second.getTensorLegs();
+    for (unsigned int legId = 0; legId < legs.size(); ++legId) {
+      const auto cutIter = cutLegs.find(std::make_pair(iter->first, legId));
+      if (cutIter != cutLegs.end()) {
+        legs[legId] = cutIter->second;
+      }
+    }
+    const bool placed =
+        result.placeTensor(iter->first, iter->second.getTensor(), legs,
+                           iter->second.isComplexConjugated());
+    assert(placed);
+  }
+  for (const auto &[cutId, cutTensor, cutLeg] : cutTensorConns) {
+    const bool placed = result.placeTensor(
+        cutId, cutTensor, std::vector<exatn::TensorLeg>{cutLeg}, false);
+    assert(placed);
+  }
+  const bool finalized = result.finalize();
+  assert(finalized);
+  return result;
+}
+
+template <typename TNQVM_COMPLEX_TYPE>
+void ExatnVisitor<TNQVM_COMPLEX_TYPE>::determineContractionSequence(
+    TensorNetwork &io_tensorNetwork) const {
+  // Without a persistent cache or a portfolio search, the sequence is
+  // determined by ExaTN on evaluation (with its in-process cache).
+  if (m_contrSeqCacheDir.empty() && m_contrSeqPortfolio.empty()) {
+    return;
+  }
+  // Sequences of the portfolio search are cached under the "portfolio" name.
+  const std::string optimizerName =
+      !m_contrSeqPortfolio.empty()
+          ? "portfolio"
+          : (options.stringExists("exatn-contract-seq-optimizer")
+                 ? options.getString("exatn-contract-seq-optimizer")
+                 : "metis");
+
+  // Topology of the network: tensor shapes and connectivity.
+  std::vector<contraction::TensorNode> tensorNodes;
+  for (auto iter = io_tensorNetwork.cbegin(); iter != io_tensorNetwork.cend();
+       ++iter) {
+    contraction::TensorNode tensorNode;
+    tensorNode.id = iter->first;
+    const auto tensor = iter->second.getTensor();
+    for (unsigned int i = 0; i < tensor->getRank(); ++i) {
+      tensorNode.extents.emplace_back(tensor->getDimExtent(i));
+    }
+    for (const auto &leg : iter->second.getTensorLegs()) {
+      tensorNode.legs.emplace_back(leg.getTensorId(), leg.getDimensionId());
+    }
+    tensorNode.conjugated = iter->second.isComplexConjugated();
+    tensorNodes.emplace_back(std::move(tensorNode));
+  }
+  const uint64_t topologyHash = contraction::getTopologyHash(tensorNodes);
+  const std::string filePath = contraction::getSequenceFilePath(
+      m_contrSeqCacheDir, topologyHash, optimizerName);
+
+  // Note: without a cache directory, this is only an in-process cache key.
+  auto cacheIter = m_contrSeqCache.find(filePath);
+  if (cacheIter == m_contrSeqCache.end() && !m_contrSeqCacheDir.empty()) {
+    std::vector<contraction::ContractionTriple> sequence;
+    double flops = 0.0;
+    if (contraction::loadSequence(filePath, topologyHash, sequence, flops)) {
+      cacheIter = m_contrSeqCache
+                      .emplace(filePath, std::make_pair(std::move(sequence), flops))
+                      .first;
+    }
+  }
+  if (cacheIter != m_contrSeqCache.end() &&
+      contraction::isValidSequence(tensorNodes, cacheIter->second.first)) {
+    std::list<exatn::ContrTriple> sequence;
+    for (const auto &triple : cacheIter->second.first) {
+      sequence.emplace_back(
+          exatn::ContrTriple{triple.result, triple.left, triple.right});
+    }
+    io_tensorNetwork.importContractionSequence(sequence,
+                                               cacheIter->second.second);
+    ++m_contrSeqCacheHits;
+    return;
+  }
+
+  // Cache miss (or stale entry): run the optimizer(s) and save the result.
+  if (m_contrSeqPortfolio.empty()) {
+    io_tensorNetwork.getOperationList(optimizerName);
+  } else {
+    searchContractionSequence(io_tensorNetwork);
+  }
+  double flops = 0.0;
+  const auto &exportedSequence =
+      io_tensorNetwork.exportContractionSequence(&flops);
+  std::vector<contraction::ContractionTriple> sequence;
+  sequence.reserve(exportedSequence.size());
+  for (const auto &triple : exportedSequence) {
+    sequence.emplace_back(contraction::ContractionTriple{
+        triple.result_id, triple.left_id, triple.right_id});
+  }
+  ++m_contrSeqCacheMisses;
+  // All processes compute the same networks: only one writes the file.
+  if (!m_contrSeqCacheDir.empty() && exatn::getProcessRank() == 0 &&
+      !contraction::storeSequence(filePath, topologyHash, sequence, flops)) {
+    xacc::warning("Failed to write the contraction sequence cache file '" +
+                  filePath + "'.");
+  }
+  m_contrSeqCache[filePath] = std::make_pair(std::move(sequence), flops);
+}
+
+template <typename TNQVM_COMPLEX_TYPE>
+void ExatnVisitor<TNQVM_COMPLEX_TYPE>::searchContractionSequence(
+    TensorNetwork &io_tensorNetwork) const {
+  // Each run optimizes its own copy of the network (the tensors are shared,
+  // read-only). The runs are sequential (ExaTN is not thread-safe).
+  std::map<std::pair<std::string, int>, std::list<exatn::ContrTriple>> sequences;
+  const auto runOptimizer = [&](const std::string &in_optimizerName,
+                                int in_restart) {
+    auto tensorNetwork = io_tensorNetwork;
+    tensorNetwork.getOperationList(in_optimizerName);
+    contraction::PathCandidate candidate{
+        in_optimizerName, in_restart, tensorNetwork.getFMAFlops(),
+        tensorNetwork.getMaxIntermediatePresenceVolume()};
+    sequences[std::make_pair(in_optimizerName, in_restart)] =
+        tensorNetwork.exportContractionSequence();
+    return candidate;
+  };
+  const auto startTime = std::chrono::system_clock::now();
+  const auto candidates = contraction::runPortfolio(
+      m_contrSeqPortfolio, m_contrSeqRestarts,
+      std::chrono::duration<double>(m_contrSeqTimeLimit), runOptimizer);
+  const auto &winner =
+      candidates[contraction::selectBestCandidate(candidates, m_maxPeakVolume)];
+  const auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                             std::chrono::system_clock::now() - startTime)
+                             .count();
+  xacc::info("Contraction sequence portfolio: " +
+             std::to_string(candidates.size()) + " runs in " +
+             std::to_string(elapsedMs) + " ms, best: '" + winner.optimizer +
+             "' (restart " + std::to_string(winner.restart) + ") with " +
+             std::to_string(winner.flops) + " flops.");
+  if (winner.peakVolume > m_maxPeakVolume) {
+    xacc::warning("No contraction sequence fits in memory, using the one with "
+                  "the smallest intermediate tensors.");
+  }
+  io_tensorNetwork.importContractionSequence(
+      sequences[std::make_pair(winner.optimizer, winner.restart)],
+      winner.flops);
+  // Report the largest network of the execution.
+  if (winner.flops > m_contrSeqWinner.flops) {
+    m_contrSeqWinner = winner;
+  }
+}
+
+template <typename TNQVM_COMPLEX_TYPE>
+slicing::SliceCost ExatnVisitor<TNQVM_COMPLEX_TYPE>::estimateContractionCost(
+    TensorNetwork in_tensorNetwork) const {
+  const std::string optimizerName =
+      options.stringExists("exatn-contract-seq-optimizer")
+          ? options.getString("exatn-contract-seq-optimizer")
+          : "metis";
+  in_tensorNetwork.collapseIsometries();
+  determineContractionSequence(in_tensorNetwork);
+  in_tensorNetwork.getOperationList(optimizerName);
+  return slicing::SliceCost{in_tensorNetwork.getFMAFlops(),
+                            in_tensorNetwork.getMaxIntermediatePresenceVolume()};
+}
+
+template <typename TNQVM_COMPLEX_TYPE>
+slicing::SliceCost ExatnVisitor<TNQVM_COMPLEX_TYPE>::estimateSliceCost(
+    const std::vector<int> &in_bitString,
+    const std::vector<SlicedBond> &in_cutBonds) const {
+  // Cost estimates only need the tensor shapes (no tensor bodies).
+  const auto cutTensor =
+      std::make_shared<exatn::Tensor>(m_tensorPrefix + "CUT", TensorShape{2});
+  const auto projectTensor =
+      std::make_shared<exatn::Tensor>(m_tensorPrefix + "QB", TensorShape{2});
+  const auto openTensor =
+      std::make_shared<exatn::Tensor>(m_tensorPrefix + "QB", TensorShape{2, 2});
+  auto combinedNetwork = cutNetworkBonds(m_tensorNetwork, in_cutBonds, 0,
+                                         {cutTensor, cutTensor});
+  // Closing the tensor network with the bra (see submitWaveFuncSlice)
+  TensorNetwork braTensorNet("bra");
+  std::vector<std::pair<unsigned int, unsigned int>> pairings;
+  unsigned int nbOpenLegs = 0;
+  for (unsigned int i = 0; i < in_bitString.size(); ++i) {
+    pairings.emplace_back(std::make_pair(i, i + nbOpenLegs));
+    const bool isOpen = (in_bitString[i] == -1);
+    if (isOpen) {
+      nbOpenLegs++;
+    }
+    braTensorNet.appendTensor(
+        i + 1, isOpen ? openTensor : projectTensor,
+        std::vector<std::pair<unsigned int, unsigned int>>{});
+  }
+  combinedNetwork.appendTensorNetwork(std::move(braTensorNet), pairings);
+  return estimateContractionCost(std::move(combinedNetwork));
+}
+
+template <typename TNQVM_COMPLEX_TYPE>
+void ExatnVisitor<TNQVM_COMPLEX_TYPE>::shareFromProcess0(
+    std::vector<double> &io_data) const {
+  if (getNumMpiProcs() <= 1) {
+    return;
+  }
+  // All-reduce of the data, zero on the other processes.
+  if (exatn::getProcessRank() != 0) {
+    std::fill(io_data.begin(), io_data.end(), 0.0);
+  }
+  const std::string sharedTensorName = m_tensorPrefix + "Shared";
+  const bool created = exatn::createTensor(
+      sharedTensorName, exatn::TensorElementType::REAL64,
+      exatn::TensorShape{static_cast<exatn::DimExtent>(io_data.size())});
+  assert(created);
+  exatn::initTensorData(sharedTensorName, io_data);
+  const bool allReduced = exatn::allreduceTensorSync(
+      exatn::getDefaultProcessGroup(), sharedTensorName);
+  assert(allReduced);
+  auto talsh_tensor = exatn::getLocalTensor(sharedTensorName);
+  const double *body_ptr;
+  if (talsh_tensor->getDataAccessHostConst(&body_ptr)) {
+    io_data.assign(body_ptr, body_ptr + io_data.size());
+  }
+  const bool destroyed = exatn::destroyTensorSync(sharedTensorName);
+  assert(destroyed);
+}
+
+template <typename TNQVM_COMPLEX_TYPE>
+typename ExatnVisitor<TNQVM_COMPLEX_TYPE>::SlicePlan
+ExatnVisitor<TNQVM_COMPLEX_TYPE>::getSlicePlan(size_t in_maxOpenQubits) {
+  const size_t nbQubits = m_buffer->size();
+  SlicePlan topQubitsPlan;
+  for (size_t qubit = in_maxOpenQubits; qubit < nbQubits; ++qubit) {
+    topQubitsPlan.projectedQubits.emplace_back(qubit);
+  }
+  const std::string selection = options.stringExists("exatn-slice-selection")
+                                    ? options.getString("exatn-slice-selection")
+                                    : "qubits";
+  if (selection == "qubits") {
+    return topQubitsPlan;
+  }
+  if (selection != "cost") {
+    xacc::error("Invalid 'exatn-slice-selection' parameter: " + selection);
+  }
+
+  const auto bonds = getInternalBonds(m_tensorNetwork);
+  // Selection mask of the candidates (qubits then bonds), the last entry is
+  // set if the selection is not within budget.
+  std::vector<double> selectionMask(nbQubits + bonds.size() + 1, 0.0);
+  // The contraction sequence optimizer may not be deterministic: the plan is
+  // computed by process 0 only.
+  if (exatn::getProcessRank() == 0) {
+    int maxEvaluationsPerStep = 16;
+    if (options.keyExists<int>("exatn-slice-candidates")) {
+      maxEvaluationsPerStep = options.get<int>("exatn-slice-candidates");
+      if (maxEvaluationsPerStep < 1) {
+        xacc::error("Invalid 'exatn-slice-candidates' parameter.");
+      }
+    }
+    const auto getSliceCost = [&](const std::vector<size_t> &in_sliced) {
+      std::vector<int> bitString(nbQubits, -1);
+      std::vector<SlicedBond> cutBonds;
+      for (const auto &idx : in_sliced) {
+        if (idx < nbQubits) {
+          bitString[idx] = 0;
+        } else {
+          cutBonds.emplace_back(bonds[idx - nbQubits]);
+        }
+      }
+      return estimateSliceCost(bitString, cutBonds);
+    };
+
+    // Memory budget (number of elements): half of the host buffer share of a
+    // full-size slice, the rest is for the input tensors.
+    const double maxPeakVolume = std::pow(2.0, in_maxOpenQubits + 3);
+    const size_t minProjectedQubits = topQubitsPlan.projectedQubits.size();
+    slicing::SliceCost cost{0.0, 0.0};
+    const auto sliced = slicing::selectSlicedIndices(
+        nbQubits, bonds.size(), minProjectedQubits, maxPeakVolume,
+        getSliceCost, maxEvaluationsPerStep, cost);
+    const size_t nbProjected = std::count_if(
+        sliced.begin(), sliced.end(),
+        [nbQubits](size_t idx) { return idx < nbQubits; });
+    for (const auto &idx : sliced) {
+      selectionMask[idx] = 1.0;
+    }
+    if (cost.peakVolume > maxPeakVolume || nbProjected < minProjectedQubits) {
+      selectionMask.back() = 1.0;
+    }
+    std::stringstream ss;
+    ss << "Slice selection: " << nbProjected << " qubits and "
+       << sliced.size() - nbProjected << " bonds; " << cost.flops
+       << " FMA flops and " << cost.peakVolume
+       << " elements (peak) per slice.\n";
+    xacc::info(ss.str());
+    executionInfo.insert("exatn-slice-flops", cost.flops);
+  }
+
+  shareFromProcess0(selectionMask);
+
+  if (selectionMask.back() != 0.0) {
+    xacc::warning("No slice selection within the memory budget was found, "
+                  "slicing the highest-index qubits.");
+    return topQubitsPlan;
+  }
+  SlicePlan plan;
+  for (size_t idx = 0; idx + 1 < selectionMask.size(); ++idx) {
+    if (selectionMask[idx] != 0.0) {
+      if (idx < nbQubits) {
+        plan.projectedQubits.emplace_back(idx);
+      } else {
+        plan.cutBonds.emplace_back(bonds[idx - nbQubits]);
+      }
+    }
+  }
+  return plan;
+}
+
+template <typename TNQVM_COMPLEX_TYPE>
+typename ExatnVisitor<TNQVM_COMPLEX_TYPE>::ExpValStrategy
+ExatnVisitor<TNQVM_COMPLEX_TYPE>::getExpValStrategy(
+    const std::vector<int> &in_measureQubits) {
+  const size_t nbQubits = m_buffer->size();
+  // key 'exp-val-by-conjugate' is present and set to true
+  const bool useDoubleDepth = options.keyExists<bool>("exp-val-by-conjugate") &&
+                              options.get<bool>("exp-val-by-conjugate");
+  if (m_memoryBudgetBytes <= 0) {
+    if (nbQubits <= m_maxQubit) {
+      return ExpValStrategy::Direct;
+    }
+    return useDoubleDepth ? ExpValStrategy::Conjugate : ExpValStrategy::Slicing;
+  }
+  if (useDoubleDepth) {
+    return ExpValStrategy::Conjugate;
+  }
+  const auto cacheIter = m_expValStrategyCache.find(in_measureQubits);
+  if (cacheIter != m_expValStrategyCache.end()) {
+    m_sliceOpenQubits = cacheIter->second.second;
+    return cacheIter->second.first;
+  }
+
+  // Decision of process 0: strategy and number of open qubits of a slice.
+  // (The contraction sequence optimizer may not be deterministic.)
+  std::vector<double> decision(2, 0.0);
+  if (exatn::getProcessRank() == 0) {
+    struct Candidate {
+      ExpValStrategy strategy;
+      std::string name;
+      slicing::SliceCost cost;
+      size_t sliceOpenQubits;
+    };
+    std::vector<Candidate> candidates;
+    const double budgetVolume =
+        static_cast<double>(m_memoryBudgetBytes) / sizeof(TNQVM_COMPLEX_TYPE);
+    // (1) Full state vector (also copied to the host).
+    if (nbQubits <= MAX_NUMBER_QUBITS_FOR_STATE_VEC) {
+      auto cost = estimateContractionCost(m_tensorNetwork);
+      cost.peakVolume += std::pow(2.0, nbQubits);
+      candidates.emplace_back(
+          Candidate{ExpValStrategy::Direct, "direct", cost, nbQubits});
+    }
+    // (2) Slicing: the largest slice (i.e. fewest slices) within budget.
+    const auto maxOpenQubits = std::min<size_t>(
+        nbQubits - 1, static_cast<size_t>(std::log2(budgetVolume)));
+    for (size_t openQubits = maxOpenQubits; openQubits >= 1; --openQubits) {
+      std::vector<int> bitString(nbQubits, -1);
+      std::fill(bitString.begin() + openQubits, bitString.end(), 0);
+      auto cost = estimateSliceCost(bitString, {});
+      // Each slice is also copied to the host.
+      cost.peakVolume += std::pow(2.0, openQubits);
+      if (cost.peakVolume <= budgetVolume || openQubits == 1) {
+        cost.flops *= std::pow(2.0, nbQubits - openQubits);
+        candidates.emplace_back(
+            Candidate{ExpValStrategy::Slicing, "slicing", cost, openQubits});
+        break;
+      }
+    }
+    // (3) Double-depth network: <psi| Z...Z |psi>
+    {
+      auto combinedNetwork = m_tensorNetwork;
+      const auto zTensor = std::make_shared<exatn::Tensor>(
+          m_tensorPrefix + "Z", TensorShape{2, 2});
+      auto tensorIdCounter = combinedNetwork.getMaxTensorId();
+      for (const auto &qubitIdx : in_measureQubits) {
+        combinedNetwork.appendTensorGate(
+            ++tensorIdCounter, zTensor,
+            std::vector<unsigned int>{static_cast<unsigned int>(qubitIdx)});
+      }
+      auto bra = m_tensorNetwork;
+      bra.conjugate();
+      std::vector<std::pair<unsigned int, unsigned int>> pairings;
+      for (unsigned int i = 0; i < nbQubits; ++i) {
+        pairings.emplace_back(std::make_pair(i, i));
+      }
+      combinedNetwork.appendTensorNetwork(std::move(bra), pairings);
+      candidates.emplace_back(Candidate{ExpValStrategy::Conjugate, "conjugate",
+                                        estimateContractionCost(combinedNetwork),
+                                        m_maxQubit});
+    }
+
+    // Fewest flops within budget; if none fits, the smallest peak memory.
+    const auto isWithinBudget = [budgetVolume](const Candidate &in_candidate) {
+      return in_candidate.cost.peakVolume <= budgetVolume;
+    };
+    auto bestIter = candidates.end();
+    for (auto iter = candidates.begin(); iter != candidates.end(); ++iter) {
+      if (isWithinBudget(*iter) &&
+          (bestIter == candidates.end() ||
+           iter->cost.flops < bestIter->cost.flops)) {
+        bestIter = iter;
+      }
+    }
+    if (bestIter == candidates.end()) {
+      bestIter = std::min_element(
+          candidates.begin(), candidates.end(),
+          [](const Candidate &lhs, const Candidate &rhs) {
+            return lhs.cost.peakVolume < rhs.cost.peakVolume;
+          });
+      xacc::warning("No exp-val-z method within the memory budget of " +
+                    std::to_string(m_memoryBudgetBytes) + " bytes, using '" +
+                    bestIter->name + "'.");
+    }
+    std::stringstream ss;
+    ss << "Exp-val-z method: " << bestIter->name << "; " << bestIter->cost.flops
+       << " FMA flops and "
+       << bestIter->cost.peakVolume * sizeof(TNQVM_COMPLEX_TYPE)
+       << " bytes (peak).\n";
+    xacc::info(ss.str());
+    executionInfo.insert("exp-val-strategy", bestIter->name);
+    executionInfo.insert("exp-val-estimated-flops", bestIter->cost.flops);
+    executionInfo.insert("exp-val-estimated-bytes",
+                         bestIter->cost.peakVolume * sizeof(TNQVM_COMPLEX_TYPE));
+    decision[0] = static_cast<int>(bestIter->strategy);
+    decision[1] = bestIter->sliceOpenQubits;
+  }
+  shareFromProcess0(decision);
+
+  const auto strategy =
+      static_cast<ExpValStrategy>(static_cast<int>(decision[0]));
+  m_sliceOpenQubits = decision[1];
+  m_expValStrategyCache.emplace(in_measureQubits,
+                                std::make_pair(strategy, m_sliceOpenQubits));
+  return strategy;
+}
+
 template <typename TNQVM_COMPLEX_TYPE>
 std::vector<TNQVM_COMPLEX_TYPE>
 ExatnVisitor<TNQVM_COMPLEX_TYPE>::computeWaveFuncSlice(
     const TensorNetwork &in_tensorNetwork, const std::vector<int> &bitString,
     const exatn::ProcessGroup &in_processGroup) const {
+  TNQVM_TELEMETRY_ZONE("exatn::evaluateSync", __FILE__, __LINE__);
+  const auto outputTensorName =
+      submitWaveFuncSlice(in_tensorNetwork, bitString, in_processGroup, "");
+  return collectWaveFuncSlice(outputTensorName, "");
+}
+
+template <typename TNQVM_COMPLEX_TYPE>
+std::string ExatnVisitor<TNQVM_COMPLEX_TYPE>::submitWaveFuncSlice(
+    const TensorNetwork &in_tensorNetwork, const std::vector<int> &bitString,
+    const exatn::ProcessGroup &in_processGroup,
+    const std::string &in_laneTag) const {
   // Closing the tensor network with the bra
   std::vector<std::pair<unsigned int, unsigned int>> pairings;
   int nbOpenLegs = 0;
@@ -2100,7 +3445,8 @@ ExatnVisitor<TNQVM_COMPLEX_TYPE>::computeWaveFuncSlice(
     // Create the qubit register tensor
     for (int i = 0; i < in_bitString.size(); ++i) {
       const auto bitVal = in_bitString[i];
-      const std::string braQubitName = "QB" + std::to_string(i);
+      const std::string braQubitName =
+          m_tensorPrefix + in_laneTag + "QB" + std::to_string(i);
       if (bitVal == 0) {
         const bool created =
             exatn::createTensor(in_processGroup, braQubitName,
@@ -2154,32 +3500,127 @@ ExatnVisitor<TNQVM_COMPLEX_TYPE>::computeWaveFuncSlice(
   assert(pairings.size() == m_buffer->size());
   combinedTensorNetwork.appendTensorNetwork(std::move(braTensors), pairings);
   combinedTensorNetwork.collapseIsometries();
+  combinedTensorNetwork.rename(m_tensorPrefix + in_laneTag + m_kernelName);
+  // std::cout << "SUBMIT TENSOR NETWORK FOR EVALUATION\n";
   // combinedTensorNetwork.printIt();
+  const auto outputTensorName = combinedTensorNetwork.getTensor(0)->getName();
+  determineContractionSequence(combinedTensorNetwork);
+  if (!exatn::evaluate(in_processGroup, combinedTensorNetwork)) {
+    return "";
+  }
+  return outputTensorName;
+}
+
+template <typename TNQVM_COMPLEX_TYPE>
+std::vector<TNQVM_COMPLEX_TYPE>
+ExatnVisitor<TNQVM_COMPLEX_TYPE>::collectWaveFuncSlice(
+    const std::string &in_outputTensorName,
+    const std::string &in_laneTag) const {
   std::vector<TNQVM_COMPLEX_TYPE> waveFnSlice;
-  {
-    TNQVM_TELEMETRY_ZONE("exatn::evaluateSync", __FILE__, __LINE__);
-    // std::cout << "SUBMIT TENSOR NETWORK FOR EVALUATION\n";
-    // combinedTensorNetwork.printIt();
-    combinedTensorNetwork.rename(m_kernelName);
-    if (exatn::evaluateSync(in_processGroup, combinedTensorNetwork)) {
-      exatn::sync();
-      auto talsh_tensor =
-          exatn::getLocalTensor(combinedTensorNetwork.getTensor(0)->getName());
-      const TNQVM_COMPLEX_TYPE *body_ptr;
-      if (talsh_tensor->getDataAccessHostConst(&body_ptr)) {
-        waveFnSlice.assign(body_ptr, body_ptr + talsh_tensor->getVolume());
-      }
+  if (!in_outputTensorName.empty() && exatn::sync(in_outputTensorName)) {
+    auto talsh_tensor = exatn::getLocalTensor(in_outputTensorName);
+    const TNQVM_COMPLEX_TYPE *body_ptr;
+    if (talsh_tensor->getDataAccessHostConst(&body_ptr)) {
+      waveFnSlice.assign(body_ptr, body_ptr + talsh_tensor->getVolume());
     }
   }
   // Destroy bra tensors
   for (int i = 0; i < m_buffer->size(); ++i) {
-    const std::string braQubitName = "QB" + std::to_string(i);
+    const std::string braQubitName =
+        m_tensorPrefix + in_laneTag + "QB" + std::to_string(i);
     const bool destroyed = exatn::destroyTensor(braQubitName);
     assert(destroyed);
   }
   return waveFnSlice;
 }
 
+template <typename TNQVM_COMPLEX_TYPE>
+std::vector<std::vector<uint8_t>>
+ExatnVisitor<TNQVM_COMPLEX_TYPE>::generateFrugalSamples(int in_nbSamples) {
+  const size_t nbQubits = m_buffer->size();
+  int nbOpenQubits = options.keyExists<int>("frugal-open-qubits")
+                         ? options.get<int>("frugal-open-qubits")
+                         : 10;
+  const double acceptanceBound =
+      options.keyExists<double>("frugal-acceptance-bound")
+          ? options.get<double>("frugal-acceptance-bound")
+          : sampling::DEFAULT_FRUGAL_ACCEPTANCE_BOUND;
+  if (nbOpenQubits < 0 || acceptanceBound <= 0.0) {
+    xacc::error("Invalid frugal sampling parameters.");
+  }
+  nbOpenQubits = std::min<int>({nbOpenQubits, (int)m_maxQubit, (int)nbQubits});
+  // Open the highest-index qubits: the same slice topology for all the
+  // candidates, i.e. a single contraction sequence.
+  std::vector<size_t> openQubits;
+  for (size_t qubit = nbQubits - nbOpenQubits; qubit < nbQubits; ++qubit) {
+    openQubits.emplace_back(qubit);
+  }
+  const auto sliceProbabilities = [this](const std::vector<int> &in_bitString) {
+    const auto waveFuncSlice = computeWaveFuncSlice(
+        m_tensorNetwork, in_bitString, exatn::getDefaultProcessGroup());
+    std::vector<double> probs;
+    probs.reserve(waveFuncSlice.size());
+    for (const auto &amplitude : waveFuncSlice) {
+      probs.emplace_back(std::norm(amplitude));
+    }
+    return probs;
+  };
+  std::mt19937_64 rng(
+      std::chrono::high_resolution_clock::now().time_since_epoch().count());
+  sampling::FrugalSamplingStats stats;
+  const auto samples = sampling::frugalRejectionSample(
+      nbQubits, openQubits, in_nbSamples, acceptanceBound, rng,
+      sliceProbabilities, stats);
+  if (samples.size() < static_cast<size_t>(in_nbSamples)) {
+    xacc::warning("Frugal sampling: only " + std::to_string(samples.size()) +
+                  " samples were accepted out of " +
+                  std::to_string(stats.nbCandidates) +
+                  " candidates. The output distribution is not Porter-Thomas.");
+  }
+  executionInfo.insert("frugal-slices", (int)stats.nbSlices);
+  executionInfo.insert("frugal-candidates", (int)stats.nbCandidates);
+  executionInfo.insert("frugal-over-bound", (int)stats.nbOverBound);
+
+  // Keep the bits of the measured qubits.
+  std::vector<std::vector<uint8_t>> measureSamples;
+  measureSamples.reserve(samples.size());
+  for (const auto &sample : samples) {
+    std::vector<uint8_t> measureBits;
+    for (const auto &qubitIdx : m_measureQbIdx) {
+      measureBits.emplace_back(sample[qubitIdx]);
+    }
+    measureSamples.emplace_back(std::move(measureBits));
+  }
+  return measureSamples;
+}
+
+template <typename TNQVM_COMPLEX_TYPE>
+std::vector<TNQVM_COMPLEX_TYPE> ExatnVisitor<TNQVM_COMPLEX_TYPE>::computeAmplitudes(
+    const std::vector<std::vector<int>> &in_bitStrings) {
+  for (const auto &bitString : in_bitStrings) {
+    if (bitString.size() != m_buffer->size() ||
+        std::any_of(bitString.begin(), bitString.end(),
+                    [](int bit) { return bit != 0 && bit != 1; })) {
+      xacc::error("Invalid bit string in the batch: 0/1 values for all qubits "
+                  "are expected.");
+    }
+  }
+  // The open legs of a slice are limited by the max wave-function size.
+  const auto batches = batching::planAmplitudeBatches(
+      in_bitStrings, std::min<size_t>(m_maxQubit, m_buffer->size()));
+  std::vector<TNQVM_COMPLEX_TYPE> amplitudes(in_bitStrings.size());
+  for (const auto &batch : batches) {
+    const auto waveFuncSlice = computeWaveFuncSlice(
+        m_tensorNetwork, batch.bitString, exatn::getDefaultProcessGroup());
+    for (size_t i = 0; i < batch.members.size(); ++i) {
+      assert(batch.sliceIndices[i] < waveFuncSlice.size());
+      amplitudes[batch.members[i]] = waveFuncSlice[batch.sliceIndices[i]];
+    }
+  }
+  executionInfo.insert("exatn-amplitude-contractions", (int)batches.size());
+  return amplitudes;
+}
+
 template <typename TNQVM_COMPLEX_TYPE>
 size_t ExatnVisitor<TNQVM_COMPLEX_TYPE>::getNumMpiProcs() const {
   auto &process_group = exatn::getDefaultProcessGroup();
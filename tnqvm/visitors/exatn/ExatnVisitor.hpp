@@ -33,12 +33,16 @@
 
 #ifdef TNQVM_HAS_EXATN
 
+#include <array>
+#include <map>
 #include <cstdlib>
 #include <complex>
 #include <vector>
 #include <utility>
 #include "TNQVMVisitor.hpp"
 #include "tensor_network.hpp"
+#include "utils/ContractionPlanning.hpp"
+#include "utils/MeasurementSampling.hpp"
 
 using namespace xacc;
 using namespace xacc::quantum;
@@ -71,6 +75,28 @@ using TensorFunctor = talsh::TensorFunctor<exatn::Identifiable>;
 // |                             | - `amplitude-real`/`amplitude-real-vec`: Real part of the result.      |             |                          |
 // |                             | - `amplitude-imag`/`amplitude-imag-vec`: Imaginary part of the result. |             |                          |
 // +-----------------------------+------------------------------------------------------------------------+-------------+--------------------------+
+// | sampling-method             | Method to generate the shots of circuits too large for a state vector: |   string    | rdm                      |
+// |                             | "rdm" (sample qubit by qubit from reduced density matrices) or         |             |                          |
+// |                             | "frugal" (rejection sampling of amplitudes of wave-function slices,    |             |                          |
+// |                             | suitable for random circuits, i.e. Porter-Thomas distributions).       |             |                          |
+// +-----------------------------+------------------------------------------------------------------------+-------------+--------------------------+
+// | sampling-block-size         | Number of qubits sampled at once ("rdm" sampling method), i.e. one     |    int      | <auto>                   |
+// |                             | contraction per block per shot. Default: the largest block (up to 8)   |             |                          |
+// |                             | whose RDM contraction fits in the memory budget (or ExaTN buffer).     |             |                          |
+// +-----------------------------+------------------------------------------------------------------------+-------------+--------------------------+
+// | frugal-open-qubits          | Number of open qubits of the wave-function slices of frugal sampling,  |    int      | 10                       |
+// |                             | i.e. candidates per amplitude evaluation = 2^frugal-open-qubits.       |             |                          |
+// +-----------------------------+------------------------------------------------------------------------+-------------+--------------------------+
+// | frugal-acceptance-bound     | Frugal sampling bound M: a candidate x is accepted with probability    |   double    | 10.0                     |
+// |                             | min(1, 2^n p(x) / M), i.e. ~M candidates per sample.                   |             |                          |
+// +-----------------------------+------------------------------------------------------------------------+-------------+--------------------------+
+// | bitstring-batch             | If provided, the amplitudes of a batch of bit strings (0/1 values,     | vector<int> | <unused>                 |
+// |                             | concatenated) are computed. Bit strings sharing most of their bits are |             |                          |
+// |                             | evaluated by a single contraction (the differing qubits left open).    |             |                          |
+// |                             | Returned values in the AcceleratorBuffer (in the batch order):         |             |                          |
+// |                             | - `amplitudes-real`: Real parts of the amplitudes.                     |             |                          |
+// |                             | - `amplitudes-imag`: Imaginary parts of the amplitudes.                |             |                          |
+// +-----------------------------+------------------------------------------------------------------------+-------------+--------------------------+
 // | contract-with-conjugate     | If true, we append the conjugate of the input circuit.                 |    bool     | false                    |
 // |                             | This is used to validate internal tensor contraction.                  |             |                          |
 // |                             | `contract-with-conjugate-result` key in the AcceleratorBuffer will be  |             |                          |
@@ -82,8 +108,54 @@ using TensorFunctor = talsh::TensorFunctor<exatn::Identifiable>;
 // | exp-val-by-conjugate        | If true, expectation value of *large* circuits (exceed memory limit)   |    bool     | false                    |
 // |                             | is computed by closing the tensor network with its conjugate.          |             |                          |
 // +-----------------------------+------------------------------------------------------------------------+-------------+--------------------------+
+// | warm-mode                   | If true, gate tensors and qubit register tensors are kept alive between|    bool     | false                    |
+// |                             | executions, i.e. only the circuit network is rebuilt on each execute.  |             |                          |
+// +-----------------------------+------------------------------------------------------------------------+-------------+--------------------------+
+// | light-cone                  | observableExpValCalc: evaluate each term on the backward light cone of |    bool     | false                    |
+// |                             | its qubits only (terms with the same cone share the reduced network).  |             |                          |
+// +-----------------------------+------------------------------------------------------------------------+-------------+--------------------------+
+// | exatn-slice-lanes           | Number of slices of a *large* circuit exp-val-z evaluated concurrently |    int      | 1                        |
+// |                             | (single process). The lanes share the memory of one full-size slice.   |             |                          |
+// +-----------------------------+------------------------------------------------------------------------+-------------+--------------------------+
+// | memory-budget               | Memory budget (in MB) of the exp-val-z calculation. If set, the method |    int      | <unused>                 |
+// |                             | (full state vector, slicing or double-depth network) and the number of |             |                          |
+// |                             | slices are selected from the ExaTN contraction cost estimates: fewest  |             |                          |
+// |                             | flops within the budget. `exp-val-strategy` is added to the execution  |             |                          |
+// |                             | info. Otherwise, this is based on the `max-qubit` limit.               |             |                          |
+// +-----------------------------+------------------------------------------------------------------------+-------------+--------------------------+
+// | exatn-slice-selection       | Indices sliced to evaluate the exp-val-z of a *large* circuit:         |   string    | qubits                   |
+// |                             | "qubits" (project the highest-index qubits) or "cost" (greedy choice   |             |                          |
+// |                             | of output qubits and internal bonds based on the ExaTN contraction     |             |                          |
+// |                             | cost estimate, minimizing flops x slices within the memory budget).    |             |                          |
+// +-----------------------------+------------------------------------------------------------------------+-------------+--------------------------+
+// | exatn-slice-candidates      | Max number of candidate indices evaluated at each step of the "cost"   |    int      | 16                       |
+// |                             | slice selection.                                                       |             |                          |
+// +-----------------------------+------------------------------------------------------------------------+-------------+--------------------------+
+// | exatn-slice-schedule        | Distribution of the slices of a *large* circuit exp-val-z among MPI    |   string    | dynamic                  |
+// |                             | processes: "dynamic" (processes claim chunks of decreasing size from a |             |                          |
+// |                             | shared counter) or "static" (one contiguous block per process).        |             |                          |
+// +-----------------------------+------------------------------------------------------------------------+-------------+--------------------------+
+// | exatn-contract-seq-cache-dir| Directory of the persistent contraction sequence cache. Sequences are  |   string    | <unused>                 |
+// |                             | keyed by the network topology (tensor shapes and connectivity), hence  |             |                          |
+// |                             | reused by later runs of the same circuit with different parameters.    |             |                          |
+// +-----------------------------+------------------------------------------------------------------------+-------------+--------------------------+
+// | exatn-contract-seq-portfolio| Comma-separated list of contraction sequence optimizers run            |   string    | <unused>                 |
+// |                             | in turn, e.g. "metis,greed,cutnn,heuro", with restarts within the      |             |                          |
+// |                             | time limit. The cheapest sequence (flops) whose intermediate tensors   |             |                          |
+// |                             | fit in memory is used. `exatn-contract-seq-winner` (optimizer),        |             |                          |
+// |                             | `exatn-contract-seq-flops` and `exatn-contract-seq-peak-bytes` are     |             |                          |
+// |                             | added to the execution info.                                           |             |                          |
+// +-----------------------------+------------------------------------------------------------------------+-------------+--------------------------+
+// | exatn-contract-seq-timeout  | Wall-clock time limit (in seconds) of the portfolio search. Restarts   |   double    | 5.0                      |
+// |                             | are not started past the limit (the first run of each optimizer is).   |             |                          |
+// +-----------------------------+------------------------------------------------------------------------+-------------+--------------------------+
+// | exatn-contract-seq-restarts | Max number of runs of each optimizer of the portfolio search.          |    int      | 4                        |
+// +-----------------------------+------------------------------------------------------------------------+-------------+--------------------------+
 
 namespace tnqvm {
+    namespace slicing {
+        struct SliceCost;
+    }
     // Simple struct to identify a concrete quantum gate instance,
     // For example, parametric gates, e.g. Rx(theta), will have an instance for each value of theta
     // that is used to instantiate the gate matrix.
@@ -234,6 +306,7 @@ namespace tnqvm {
     public:
         // Constructor
         ExatnVisitor();
+        virtual ~ExatnVisitor();
         typedef typename TNQVM_COMPLEX_TYPE::value_type TNQVM_FLOAT_TYPE;
         virtual exatn::TensorElementType getExatnElementType() const = 0;
         // Virtual function impls:        
@@ -272,6 +345,18 @@ namespace tnqvm {
         virtual void visit(Measure& in_MeasureGate) override;
         virtual bool supportVqeMode() const override { return true; }
         virtual const double getExpectationValueZ(std::shared_ptr<CompositeInstruction> in_function) override;
+        // Observed sub-circuits which share the same change-of-basis are evaluated together:
+        // the probability vector is computed once per basis, then all Z-string expectations
+        // are read off its Walsh-Hadamard transform.
+        virtual std::vector<double> getExpectationValueZBatch(const std::vector<std::shared_ptr<CompositeInstruction>>& in_functions) override;
+        // State snapshot: the full state vector (if within the state-vector qubit limit).
+        virtual std::shared_ptr<TNQVMVisitorSnapshot> snapshotState() override;
+        virtual void restoreState(const std::shared_ptr<TNQVMVisitorSnapshot>& in_snapshot) override;
+        virtual bool supportsStateSnapshot() const override { return true; }
+        // Compiled instruction tape: append the precomputed gate matrix directly.
+        virtual bool visitTapeEntry(const TapeEntry& in_entry) override;
+        // Fused unitary: append a single gate tensor for the fused matrix.
+        virtual bool visitFusedUnitary(const FusedUnitary& in_gate) override;
 
         void subscribe(IExatnListener<TNQVM_COMPLEX_TYPE>* listener) { m_listeners.emplace_back(listener); }
         std::vector<TNQVM_COMPLEX_TYPE> retrieveStateVector();
@@ -310,17 +395,60 @@ namespace tnqvm {
         // Then, we contract the whole tensor network to get the RDM for that qubit.
         // Randomly select a binary (1/0) result based on the RDM, then close that tensor leg by projecting it onto the selected result.
         // Continue with the next qubit line (conditioned on the previous measurement result).
+        // The conditioned networks are built (and planned) by the first call and reused by the
+        // next calls (shots) with the same circuit and qubits, as are the marginals of the
+        // sampled prefixes.
         std::vector<uint8_t> getMeasureSample(std::shared_ptr<AcceleratorBuffer>& in_buffer, std::shared_ptr<CompositeInstruction>& in_function, const std::vector<size_t>& in_qubitIdx);
     private:
         template<tnqvm::CommonGates GateType, typename... GateParams>
         void appendGateTensor(const xacc::Instruction& in_gateInstruction, GateParams&&... in_params);
+        // Create (and register) the gate tensor body of a unique gate matrix.
+        void createGateTensor(const std::string& in_uniqueGateName, size_t in_nbQubits, std::vector<TNQVM_COMPLEX_TYPE>&& in_flatMatrix);
+        // Append a gate tensor (referencing a created gate tensor body) to the network.
+        void appendGateTensorToNetwork(const std::string& in_gateName, const std::string& in_uniqueGateName, bool in_isControlGate, std::vector<unsigned int> in_gatePairing);
         void evaluateNetwork(); 
         void resetExaTN(); 
         void resetNetwork();
+        // Reset the network to start from the given state vector (as the "RESET_" tensor).
+        void resetNetwork(std::vector<TNQVM_COMPLEX_TYPE> stateVec);
+        struct StateVectorSnapshot : public TNQVMVisitorSnapshot {
+            std::vector<TNQVM_COMPLEX_TYPE> stateVec;
+        };
+        // Warm mode: gate tensors and qubit register tensors are persistent.
+        bool isPersistentTensor(const std::string& in_tensorName) const;
+        // Destroy the persistent qubit register tensors (and gate tensors) of warm mode.
+        void releaseWarmTensors(bool in_releaseGateTensors);
         TNQVM_COMPLEX_TYPE expVal(const std::vector<ObservableTerm>& in_observableExpression); 
         TNQVM_COMPLEX_TYPE evaluateTerm(const std::vector<std::shared_ptr<Instruction>>& in_observableTerm); 
         void applyInverse();
+        // VQE mode: evaluate the base (ansatz) network and cache its state vector
+        // as the "RESET_" tensor (if not already done).
+        void cacheAnsatzStateVector();
+        // VQE mode: build the tensor network of the change-of-basis gates of the observed
+        // sub-circuit on top of the cached ansatz state.
+        // Measured qubits are collected to m_measureQbIdx.
+        // Returns the number of change-of-basis instructions.
+        size_t constructBasisChangeNetwork(std::shared_ptr<CompositeInstruction> in_function);
+        // getMeasureSample: build the conditioned networks (one per measured qubit) of the circuit.
+        void buildSamplingNetworkCache(std::shared_ptr<AcceleratorBuffer>& in_buffer, std::shared_ptr<CompositeInstruction>& in_function,
+                                       const std::vector<size_t>& in_qubitIdx, const std::string& in_circuitKey);
+        // Destroy the tensors owned by the conditioned networks of getMeasureSample.
+        void releaseSamplingNetworkCache();
         std::vector<uint8_t> generateMeasureSample(const TensorNetwork& in_tensorNetwork, const std::vector<int>& in_qubitIdx);
+        // Network of the RDM of a block of qubits, conditioned on the sampled
+        // bits of the first measured qubits (collapse tensors, listed in
+        // out_tensorsToDestroy).
+        TensorNetwork buildSamplingBlockNetwork(const TensorNetwork& in_tensorNetwork, const std::vector<int>& in_qubitIdx,
+                                                const std::vector<uint8_t>& in_sampledBits, const std::vector<TNQVM_FLOAT_TYPE>& in_sampledProbs,
+                                                const std::vector<int>& in_blockQubits, std::vector<std::string>& out_tensorsToDestroy) const;
+        // Number of qubits sampled at once by generateMeasureSample:
+        // "sampling-block-size" or the largest block that fits in memory.
+        size_t getSamplingBlockSize(const TensorNetwork& in_tensorNetwork, const std::vector<int>& in_qubitIdx);
+        // Generate measurement samples (bits of the measured qubits) by frugal
+        // rejection sampling of wave-function slice amplitudes
+        // ("sampling-method" = "frugal"). May return fewer samples if the
+        // distribution is far from Porter-Thomas.
+        std::vector<std::vector<uint8_t>> generateFrugalSamples(int in_nbSamples);
         // Calculate the flops and memory requirements to generate a full sample (all qubits) for the input tensor network.
         // Note: this doesn't actually contract the tensor network, just getting this data from the ExaTN optimizer.
         // Output: pairs of flops and memory (in bytes); one pair for each qubit.
@@ -336,26 +464,88 @@ namespace tnqvm {
         computeWaveFuncSlice(const TensorNetwork &in_tensorNetwork,
                              const std::vector<int> &in_bitString,
                              const exatn::ProcessGroup &in_processGroup) const;
+        // Asynchronous wave-function slice: submit the evaluation (returns the
+        // output tensor name, empty on failure), then collect its data.
+        // The lane tag makes the tensor names of slices in flight unique.
+        std::string submitWaveFuncSlice(const TensorNetwork &in_tensorNetwork,
+                                        const std::vector<int> &in_bitString,
+                                        const exatn::ProcessGroup &in_processGroup,
+                                        const std::string &in_laneTag) const;
+        std::vector<TNQVM_COMPLEX_TYPE>
+        collectWaveFuncSlice(const std::string &in_outputTensorName,
+                             const std::string &in_laneTag) const;
+        // Amplitudes of a batch of bit strings: one wave-function slice per
+        // group of bit strings that share most of their bits.
+        std::vector<TNQVM_COMPLEX_TYPE>
+        computeAmplitudes(const std::vector<std::vector<int>> &in_bitStrings);
         
+        // Indices sliced by the exp-val-z slicing: output qubits projected onto
+        // a bit value and internal bonds (between two tensors of the network)
+        // cut and closed on both sides by the same basis vector.
+        struct SlicedBond {
+            unsigned int tensorId;
+            unsigned int legId;
+            unsigned int otherTensorId;
+            unsigned int otherLegId;
+        };
+        struct SlicePlan {
+            std::vector<size_t> projectedQubits;
+            std::vector<SlicedBond> cutBonds;
+        };
+        // Internal bonds of the network, excluding the bonds of rank-1 tensors
+        // (e.g. qubit register tensors) which are cheap to contract.
+        std::vector<SlicedBond> getInternalBonds(const TensorNetwork& in_tensorNetwork) const;
+        // Copy of the network with the bonds cut: bit k of in_bondValues selects
+        // the cut tensor (basis vector) closing both sides of bond k.
+        TensorNetwork cutNetworkBonds(const TensorNetwork& in_tensorNetwork,
+                                      const std::vector<SlicedBond>& in_bonds,
+                                      int64_t in_bondValues,
+                                      const std::array<std::shared_ptr<exatn::Tensor>, 2>& in_cutTensors) const;
+        // Select the indices to slice so that the wave-function slice has at most
+        // in_maxOpenQubits qubits ("exatn-slice-selection" option).
+        SlicePlan getSlicePlan(size_t in_maxOpenQubits);
+        // MPI: replace the data by the one of process 0 (e.g. decisions based on
+        // the non-deterministic contraction sequence optimizer).
+        void shareFromProcess0(std::vector<double>& io_data) const;
+        // Contraction cost estimate (flops and peak volume) of a network from the
+        // ExaTN contraction sequence optimizer, without evaluating it.
+        // If "exatn-contract-seq-cache-dir" is set: import the cached contraction
+        // sequence of the network, or run the optimizer and save its result.
+        // Otherwise, no-op (the sequence is determined on evaluation).
+        void determineContractionSequence(TensorNetwork& io_tensorNetwork) const;
+        // Run the "exatn-contract-seq-portfolio" optimizers and import the best
+        // sequence into the network.
+        void searchContractionSequence(TensorNetwork& io_tensorNetwork) const;
+        slicing::SliceCost estimateContractionCost(TensorNetwork in_tensorNetwork) const;
+        // Cost estimate of a wave-function slice (see submitWaveFuncSlice).
+        slicing::SliceCost estimateSliceCost(const std::vector<int>& in_bitString,
+                                             const std::vector<SlicedBond>& in_cutBonds) const;
+
+        // Method to compute the exp-val-z of the measured qubits:
+        // - Without "memory-budget": slicing (or double-depth if
+        //   "exp-val-by-conjugate" is set) for circuits above the max number of
+        //   qubits, the full state vector otherwise.
+        // - With "memory-budget": the method with the fewest estimated flops
+        //   whose estimated peak memory is within the budget. For slicing, this
+        //   also sets the number of open qubits of a slice (the largest one
+        //   within the budget).
+        enum class ExpValStrategy { Direct, Slicing, Conjugate };
+        ExpValStrategy getExpValStrategy(const std::vector<int>& in_measureQubits);
+
         // Compute exp-val-z for large circuits:
-        // Select the appropriate method based on user config:
+        // Dispatch to the method selected by getExpValStrategy:
         double internalComputeExpectationValueZ(
+            ExpValStrategy in_strategy,
             std::shared_ptr<CompositeInstruction> in_function) {
-          // key 'exp-val-by-conjugate' is present and set to true
-          const bool useDoubleDepth =
-              options.keyExists<bool>("exp-val-by-conjugate") &&
-              options.get<bool>("exp-val-by-conjugate");
-          return useDoubleDepth
+          return (in_strategy == ExpValStrategy::Conjugate)
                      ? getExpectationValueZByAppendingConjugate(in_function)
                      : getExpectationValueZBySlicing(in_function);
         }
 
-        double internalComputeExpectationValueZ() {
-          const bool useDoubleDepth =
-              options.keyExists<bool>("exp-val-by-conjugate") &&
-              options.get<bool>("exp-val-by-conjugate");
-          return useDoubleDepth ? getExpectationValueZByAppendingConjugate()
-                                : getExpectationValueZBySlicing();
+        double internalComputeExpectationValueZ(ExpValStrategy in_strategy) {
+          return (in_strategy == ExpValStrategy::Conjugate)
+                     ? getExpectationValueZByAppendingConjugate()
+                     : getExpectationValueZBySlicing();
         }
 
         // Exp-val-z calculation implementations:
@@ -371,6 +561,9 @@ namespace tnqvm {
         double getExpectationValueZByAppendingConjugate();
 
       private:
+        // Prefix of all the ExaTN tensor names (and network names) of this
+        // instance, unique in the process.
+        std::string m_tensorPrefix;
         TensorNetwork m_tensorNetwork;
         unsigned int m_tensorIdCounter;
         bool m_hasEvaluated;
@@ -405,6 +598,11 @@ namespace tnqvm {
         std::vector<std::pair<std::string, std::vector<unsigned int>>>
             m_appendedGateTensors;
         bool m_isAppendingCircuitGates;
+        // Warm mode ("warm-mode" option): gate tensor bodies and qubit register
+        // tensors persist across initialize()/finalize() of this visitor instance.
+        bool m_warmMode = false;
+        // Number of (zero-state) qubit register tensors kept alive in warm mode.
+        int m_warmNbQubits = 0;
         // Tensor network of the qubit register (to close the tensor network for
         // expectation calculation)
         TensorNetwork m_qubitRegTensor;
@@ -412,6 +610,52 @@ namespace tnqvm {
         std::vector<TNQVM_COMPLEX_TYPE> m_cacheStateVec;
         // Max number of qubits that we allow full wave function contraction.
         size_t m_maxQubit;
+        // Number of open qubits of a wave-function slice (exp-val-z by slicing).
+        size_t m_sliceOpenQubits;
+        // "memory-budget" option in bytes (0 if not set).
+        int64_t m_memoryBudgetBytes = 0;
+        // Exp-val-z method (and slice open qubits) for each list of measured
+        // qubits, selected with a memory budget.
+        std::map<std::vector<int>, std::pair<ExpValStrategy, size_t>> m_expValStrategyCache;
+        // "exatn-contract-seq-cache-dir" option (empty if not set).
+        std::string m_contrSeqCacheDir;
+        // Sequences already loaded or computed by this process, by cache file.
+        mutable std::map<std::string, std::pair<std::vector<contraction::ContractionTriple>, double>> m_contrSeqCache;
+        // Number of networks whose sequence was taken from the cache (hits) or
+        // computed by the optimizer (misses) during this execution.
+        mutable int m_contrSeqCacheHits = 0;
+        mutable int m_contrSeqCacheMisses = 0;
+        // Portfolio search options: optimizers, time limit (seconds) and max
+        // number of runs of each optimizer.
+        std::vector<std::string> m_contrSeqPortfolio;
+        double m_contrSeqTimeLimit = 5.0;
+        int m_contrSeqRestarts = 4;
+        // Peak volume (elements) of the intermediate tensors allowed for a
+        // contraction sequence: memory budget or ExaTN buffer size.
+        double m_maxPeakVolume = 0.0;
+        // Conditioned networks of getMeasureSample, reused across shots: network k
+        // has the projectors of the first k measured qubits on the ket side and
+        // leaves the k-th measured qubit open.
+        struct SamplingNetworkCache {
+            // Circuit (text), number of qubits and measured qubits
+            std::string circuitKey;
+            size_t nbQubits = 0;
+            std::vector<size_t> qubitIdx;
+            std::vector<TensorNetwork> conditionedNetworks;
+            // Projector tensors, updated in place.
+            std::vector<std::string> projectorNames;
+            std::vector<sampling::ProjectorState> projectorStates;
+            // Tensors owned by the cache (gate, qubit and projector tensors),
+            // destroyed on release.
+            std::vector<std::string> tensorNames;
+            sampling::MarginalCache marginals;
+        };
+        SamplingNetworkCache m_samplingNetworkCache;
+        // Block size of generateMeasureSample (0 if not yet determined).
+        size_t m_samplingBlockSize = 0;
+        // Portfolio search winner of the most expensive network (negative flops
+        // if none).
+        mutable contraction::PathCandidate m_contrSeqWinner{"", 0, -1.0, 0.0};
         // Make the debug logger friend, e.g. retrieve internal states for
         // logging purposes.
         friend class ExatnDebugLogger<TNQVM_COMPLEX_TYPE>;
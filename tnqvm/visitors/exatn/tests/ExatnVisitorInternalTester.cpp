@@ -269,6 +269,47 @@ TEST(ExatnVisitorInternalTester, testSequentialCollapse)
   EXPECT_TRUE(areAllBitsEqual);
 }
 
+// Shots reuse the conditioned networks and the marginals of sampled prefixes
+TEST(ExatnVisitorInternalTester, testSequentialCollapseShots)
+{
+  auto xasmCompiler = xacc::getCompiler("xasm");
+  auto ir = xasmCompiler->compile(R"(__qpu__ void test3(qbit q) {
+    H(q[0]);
+    CNOT(q[0], q[1]);
+    CNOT(q[0], q[2]);
+    CNOT(q[0], q[3]);
+    CNOT(q[0], q[4]);
+  })");
+  auto program = ir->getComposite("test3");
+  auto exatnVisitor = std::make_shared<DefaultExatnVisitor>();
+  auto buffer = xacc::qalloc(5);
+  const int nbShots = 20;
+  for (int i = 0; i < nbShots; ++i) {
+    const auto sampleBitString = exatnVisitor->getMeasureSample(buffer, program, { 1, 3, 4 });
+    EXPECT_EQ(sampleBitString.size(), 3);
+    const bool areAllBitsEqual = std::adjacent_find(sampleBitString.cbegin(), sampleBitString.cend(), std::not_equal_to<>()) == sampleBitString.cend();
+    EXPECT_TRUE(areAllBitsEqual);
+  }
+  // At most 5 distinct prefixes: {}, {0}, {1}, {0, 0}, {1, 1}
+  const auto info = exatnVisitor->getExecutionInfo();
+  const int nbContractions = info.get<int>("sampling-marginal-cache-misses");
+  EXPECT_LE(nbContractions, 5);
+  EXPECT_EQ(info.get<int>("sampling-marginal-cache-hits") + nbContractions, 3 * nbShots);
+
+  // Other measured qubits: the conditioned networks and the marginals are
+  // rebuilt, the projectors condition on the new prefixes.
+  for (int i = 0; i < nbShots; ++i) {
+    const auto sampleBitString = exatnVisitor->getMeasureSample(buffer, program, { 4, 0 });
+    EXPECT_EQ(sampleBitString.size(), 2);
+    EXPECT_EQ(sampleBitString[0], sampleBitString[1]);
+  }
+  const auto rebuiltInfo = exatnVisitor->getExecutionInfo();
+  const int nbRebuiltContractions = rebuiltInfo.get<int>("sampling-marginal-cache-misses");
+  // {}, {0} and {1}
+  EXPECT_LE(nbRebuiltContractions, 3);
+  EXPECT_EQ(rebuiltInfo.get<int>("sampling-marginal-cache-hits") + nbRebuiltContractions, 2 * nbShots);
+}
+
 int main(int argc, char **argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
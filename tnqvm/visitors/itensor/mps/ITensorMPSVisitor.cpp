@@ -29,12 +29,14 @@
  *
  **********************************************************************************/
 #include "ITensorMPSVisitor.hpp"
+#include "FusedUnitary.hpp"
 #include "AllGateVisitor.hpp"
 #include "itensor/all.h"
 #include <complex>
 #include <cstdlib>
 #include <ctime>
 #include <cassert>
+#include <random>
 #include "Eigen/Dense"
 
 namespace tnqvm {
@@ -64,7 +66,7 @@ void ITensorMPSVisitor::initialize(
   n_qbits = accbuffer_in->size();
   snapped = false;
   initWavefunc(n_qbits);
-  std::srand(std::time(0));
+  m_randomEngine.seed(std::random_device()());
   cbits.resize(n_qbits);
   execTime = 0.0;
   if (xacc::optionExists("tnqvm-one-qubit-gatetime")) {
@@ -86,6 +88,52 @@ void ITensorMPSVisitor::initialize(
   }
 }
 
+bool ITensorMPSVisitor::isThreadSafe() const {
+#ifdef _OPENMP
+  return true;
+#else
+  return false;
+#endif
+}
+
+namespace {
+struct ITensorMPSSnapshot : public TNQVMVisitorSnapshot {
+  itensor::ITensor wavefunc;
+  std::vector<int> iqbit2iind;
+  std::vector<int> cbits;
+  std::vector<itensor::ITensor> bondMats;
+  std::vector<itensor::ITensor> legMats;
+  itensor::IndexSet legs;
+  double execTime;
+};
+} // namespace
+
+std::shared_ptr<TNQVMVisitorSnapshot> ITensorMPSVisitor::snapshotState() {
+  auto snapshot = std::make_shared<ITensorMPSSnapshot>();
+  snapshot->wavefunc = wavefunc;
+  snapshot->iqbit2iind = iqbit2iind;
+  snapshot->cbits = cbits;
+  snapshot->bondMats = bondMats;
+  snapshot->legMats = legMats;
+  snapshot->legs = legs;
+  snapshot->execTime = execTime;
+  return snapshot;
+}
+
+void ITensorMPSVisitor::restoreState(
+    const std::shared_ptr<TNQVMVisitorSnapshot> &in_snapshot) {
+  auto snapshot = std::dynamic_pointer_cast<ITensorMPSSnapshot>(in_snapshot);
+  assert(snapshot && snapshot->legMats.size() == legMats.size());
+  wavefunc = snapshot->wavefunc;
+  iqbit2iind = snapshot->iqbit2iind;
+  cbits = snapshot->cbits;
+  bondMats = snapshot->bondMats;
+  legMats = snapshot->legMats;
+  legs = snapshot->legs;
+  execTime = snapshot->execTime;
+  snapped = false;
+}
+
 void ITensorMPSVisitor::visit(Hadamard &gate) {
   auto iqbit_in = gate.bits()[0];
   if (verbose) {
@@ -111,8 +159,63 @@ void ITensorMPSVisitor::visit(CZ &gate) {
 }
 
 void ITensorMPSVisitor::visit(CNOT &gate) {
-  auto iqbit_in0_ori = (int) gate.bits()[0];
-  auto iqbit_in1_ori = (int) gate.bits()[1];
+  applyTwoQubitGate(gate.name(), gate.bits()[0], gate.bits()[1],
+                    [](ITensor &tGate, const Index &ind_in0, const Index &ind_in1,
+                       const Index &ind_out0, const Index &ind_out1) {
+                      tGate.set(ind_out0(1), ind_out1(1), ind_in0(1), ind_in1(1), 1.);
+                      tGate.set(ind_out0(1), ind_out1(2), ind_in0(1), ind_in1(2), 1.);
+                      tGate.set(ind_out0(2), ind_out1(1), ind_in0(2), ind_in1(2), 1.);
+                      tGate.set(ind_out0(2), ind_out1(2), ind_in0(2), ind_in1(1), 1.);
+                    });
+}
+
+bool ITensorMPSVisitor::visitFusedUnitary(const FusedUnitary &in_gate) {
+  auto qubits = const_cast<FusedUnitary &>(in_gate).bits();
+  const auto &matrix = in_gate.getMatrix();
+  if (qubits.size() == 1) {
+    auto iqbit_in = qubits[0];
+    if (verbose) {
+      std::cout << "applying " << in_gate.name() << " @ " << iqbit_in << std::endl;
+    }
+    auto ind_in = ind_for_qbit(iqbit_in);
+    auto ind_out = itensor::Index(in_gate.name(), 2);
+    auto tGate = itensor::ITensor(ind_in, ind_out);
+    for (int row = 0; row < 2; ++row) {
+      for (int col = 0; col < 2; ++col) {
+        if (matrix[2 * row + col] != 0.0) {
+          tGate.set(ind_out(row + 1), ind_in(col + 1), matrix[2 * row + col]);
+        }
+      }
+    }
+    legMats[iqbit_in] = tGate * legMats[iqbit_in];
+    printWavefunc();
+    execTime += singleQubitTime;
+    return true;
+  }
+
+  // Two-qubit unitary: the first qubit is the MSB of the row/column index.
+  applyTwoQubitGate(in_gate.name(), qubits[0], qubits[1],
+                    [&matrix](ITensor &tGate, const Index &ind_in0,
+                              const Index &ind_in1, const Index &ind_out0,
+                              const Index &ind_out1) {
+                      for (int row = 0; row < 4; ++row) {
+                        for (int col = 0; col < 4; ++col) {
+                          const auto &val = matrix[4 * row + col];
+                          if (val != 0.0) {
+                            tGate.set(ind_out0(row / 2 + 1), ind_out1(row % 2 + 1),
+                                      ind_in0(col / 2 + 1), ind_in1(col % 2 + 1),
+                                      val);
+                          }
+                        }
+                      }
+                    });
+  return true;
+}
+
+void ITensorMPSVisitor::applyTwoQubitGate(
+    const std::string &gateName, int iqbit_in0_ori, int iqbit_in1_ori,
+    const std::function<void(ITensor &, const Index &, const Index &,
+                             const Index &, const Index &)> &setGateElements) {
   int iqbit_in0, iqbit_in1;
   if (iqbit_in0_ori < iqbit_in1_ori - 1) {
     permute_to(iqbit_in0_ori, iqbit_in1_ori - 1);
@@ -127,13 +230,13 @@ void ITensorMPSVisitor::visit(CNOT &gate) {
     iqbit_in1 = iqbit_in1_ori;
   }
   if (verbose) {
-    std::cout << "applying " << gate.name() << " @ " << iqbit_in0 << " , "
+    std::cout << "applying " << gateName << " @ " << iqbit_in0 << " , "
               << iqbit_in1 << std::endl;
   }
   auto ind_in0 = ind_for_qbit(iqbit_in0); // control
   auto ind_in1 = ind_for_qbit(iqbit_in1);
-  auto ind_out0 = itensor::Index(gate.name(), 2);
-  auto ind_out1 = itensor::Index(gate.name(), 2);
+  auto ind_out0 = itensor::Index(gateName, 2);
+  auto ind_out1 = itensor::Index(gateName, 2);
   Index ind_lower;
   if (iqbit_in0 < iqbit_in1) {
     ind_lower = ind_out0;
@@ -141,10 +244,7 @@ void ITensorMPSVisitor::visit(CNOT &gate) {
     ind_lower = ind_out1;
   }
   auto tGate = itensor::ITensor(ind_in0, ind_in1, ind_out0, ind_out1);
-  tGate.set(ind_out0(1), ind_out1(1), ind_in0(1), ind_in1(1), 1.);
-  tGate.set(ind_out0(1), ind_out1(2), ind_in0(1), ind_in1(2), 1.);
-  tGate.set(ind_out0(2), ind_out1(1), ind_in0(2), ind_in1(2), 1.);
-  tGate.set(ind_out0(2), ind_out1(2), ind_in0(2), ind_in1(1), 1.);
+  setGateElements(tGate, ind_in0, ind_in1, ind_out0, ind_out1);
   int min_iqbit = std::min(iqbit_in0, iqbit_in1);
   int max_iqbit = std::max(iqbit_in0, iqbit_in1);
   // itensor::PrintData(tGate);
@@ -398,7 +498,7 @@ void ITensorMPSVisitor::visit(Measure &gate) {
   double p0 = average(iqbit_measured, tMeasure0) / wavefunc_inner();
   // accbuffer->aver_from_wavefunc *= (2*p0-1);
 
-  double rv = (std::rand() % 1000000) / 1000000.;
+  double rv = std::uniform_real_distribution<double>(0.0, 1.0)(m_randomEngine);
   // std::cout<<"rv= "<<rv<<"   p0= "<<p0<<std::endl;
 
   if (rv < p0) {
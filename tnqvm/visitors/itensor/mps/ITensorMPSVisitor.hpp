@@ -32,6 +32,8 @@
 #define QUANTUM_GATE_ACCELERATORS_TNQVM_ITensorMPSVisitor_HPP_
 
 #include <cstdlib>
+#include <functional>
+#include <random>
 #include "TNQVMVisitor.hpp"
 #include "Cloneable.hpp"
 #include "itensor/all.h"
@@ -63,6 +65,17 @@ public:
 
   virtual const std::string description() const { return ""; }
 
+  // Each instance only works on its own MPS tensors, but the (global) ITensor
+  // index ID generator is only guarded when built with OpenMP.
+  virtual bool isThreadSafe() const override;
+
+  // MPS tensors are copy-on-write, hence snapshots are cheap.
+  virtual std::shared_ptr<TNQVMVisitorSnapshot> snapshotState() override;
+  virtual void restoreState(const std::shared_ptr<TNQVMVisitorSnapshot> &in_snapshot) override;
+  virtual bool supportsStateSnapshot() const override { return true; }
+  // Fused unitaries are applied as a single (one- or two-qubit) gate tensor.
+  virtual bool visitFusedUnitary(const FusedUnitary &in_gate) override;
+
   /**
    * Return all relevant TNQVM runtime options.
    */
@@ -116,6 +129,8 @@ private:
   bool snapped;
 
   bool verbose = false;
+  // Per-instance random engine (measurement sampling)
+  std::mt19937 m_randomEngine;
 
   /// init the wave function tensor
   void initWavefunc(int n_qbits);
@@ -124,6 +139,12 @@ private:
   Index ind_for_qbit(int iqbit) const;
   void printWavefunc() const;
   void permute_to(int iqbit, int iqbit_to);
+  // Apply a two-qubit gate (setGateElements fills the gate tensor elements
+  // given the input and output indices of the two qubits), then SVD.
+  void applyTwoQubitGate(
+      const std::string &gateName, int iqbit_in0_ori, int iqbit_in1_ori,
+      const std::function<void(ITensor &, const Index &, const Index &,
+                               const Index &, const Index &)> &setGateElements);
   void kickback_ind(ITensor &tensor, const Index &ind);
   double wavefunc_inner();
   double average(int iqbit, const ITensor &op_tensor);